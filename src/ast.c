@@ -1,54 +1,248 @@
 #include "includes/ast.h"
+#include "includes/string.h"
 
 ast_unit *new_ast_unit() {
 	ast_unit *ast = malloc(sizeof(ast_unit));
 	ast->dcl_pool = new_pool(sizeof(Dcl), 128);
 	ast->smt_pool = new_pool(sizeof(Smt), 128);
 	ast->exp_pool = new_pool(sizeof(Exp), 128);
+	ast->slab = new_slab();
+	ast->exp_table = NULL;
 	ast->dcls = malloc(0);
 	ast->dclCount = 0;
 
 	return ast;
 }
 
-Exp *new_ident_exp(ast_unit *ast, char *ident) {
+// ast_unit_handoff gives up the calling threads ownership of the ast's pools so the
+// finished ast can be passed to another thread.
+void ast_unit_handoff(ast_unit *ast) {
+	pool_handoff(ast->dcl_pool);
+	pool_handoff(ast->smt_pool);
+	pool_handoff(ast->exp_pool);
+	slab_handoff(ast->slab);
+}
+
+// ast_unit_adopt makes the calling thread the owner of an ast that was handed off
+void ast_unit_adopt(ast_unit *ast) {
+	pool_adopt(ast->dcl_pool);
+	pool_adopt(ast->smt_pool);
+	pool_adopt(ast->exp_pool);
+	slab_adopt(ast->slab);
+}
+
+// ast_unit_enable_hash_consing makes the pure expression constructors return an
+// existing node when a structurally identical one was already created
+void ast_unit_enable_hash_consing(ast_unit *ast) {
+	exp_table *table = malloc(sizeof(exp_table));
+	table->capacity = 256;
+	table->slots = calloc(table->capacity, sizeof(Exp *));
+	table->count = 0;
+	table->shared = 0;
+	ast->exp_table = table;
+}
+
+// is_assignment_op returns true for the operators parse_statement turns into statements
+bool is_assignment_op(TokenType type) {
+	switch(type) {
+		case ASSIGN:
+		case DEFINE:
+		case ADD_ASSIGN:
+		case SUB_ASSIGN:
+		case MUL_ASSIGN:
+		case QUO_ASSIGN:
+		case REM_ASSIGN:
+		case XOR_ASSIGN:
+		case SHL_ASSIGN:
+		case SHR_ASSIGN:
+		case AND_ASSIGN:
+		case AND_NOT_ASSIGN:
+		case OR_ASSIGN:
+			return true;
+		default:
+			return false;
+	}
+}
+
+// exp_is_pure returns true if the expression has no side effects and denotes a
+// value, so identical copies can share a node
+bool exp_is_pure(Exp *e) {
+	switch(e->type) {
+		case literalExp:
+		case identExp:
+			return true;
+		case unaryExp:
+			return e->unary.right != NULL;
+		case binaryExp:
+			return e->binary.left != NULL && e->binary.right != NULL && 
+				!is_assignment_op(e->binary.op.type);
+		case indexExp:
+			return e->index.exp != NULL && e->index.index != NULL;
+		default:
+			return false;
+	}
+}
+
+// hash_combine mixes value into the hash h
+unsigned long hash_combine(unsigned long h, unsigned long value) {
+	return string_hash_append(h, &value, sizeof(value));
+}
+
+// hash_string mixes a null terminated string into the hash h
+unsigned long hash_string(unsigned long h, char *str) {
+	return string_hash_append(h, str, strlen(str));
+}
+
+// exp_hash hashes a pure expression, children are already hash consed so they
+// are hashed by pointer
+unsigned long exp_hash(Exp *e) {
+	unsigned long h = hash_combine(STRING_HASH_SEED, e->type);
+	switch(e->type) {
+		case literalExp:
+			h = hash_combine(h, e->literal.type);
+			return hash_string(h, e->literal.value);
+		case identExp:
+			h = hash_combine(h, (unsigned long)e->ident.obj);
+			return hash_string(h, e->ident.name);
+		case unaryExp:
+			h = hash_combine(h, e->unary.op.type);
+			return hash_combine(h, (unsigned long)e->unary.right);
+		case binaryExp:
+			h = hash_combine(h, (unsigned long)e->binary.left);
+			h = hash_combine(h, e->binary.op.type);
+			return hash_combine(h, (unsigned long)e->binary.right);
+		case indexExp:
+			h = hash_combine(h, (unsigned long)e->index.exp);
+			return hash_combine(h, (unsigned long)e->index.index);
+		default:
+			ASSERT(false, "Cannot hash impure expression");
+	}
+	return h;
+}
+
+// exp_equal returns true if two pure expressions have the same structure
+bool exp_equal(Exp *a, Exp *b) {
+	if (a->type != b->type) return false;
+	switch(a->type) {
+		case literalExp:
+			return a->literal.type == b->literal.type && 
+				strcmp(a->literal.value, b->literal.value) == 0;
+		case identExp:
+			return a->ident.obj == b->ident.obj && strcmp(a->ident.name, b->ident.name) == 0;
+		case unaryExp:
+			return a->unary.op.type == b->unary.op.type && a->unary.right == b->unary.right;
+		case binaryExp:
+			return a->binary.left == b->binary.left && 
+				a->binary.op.type == b->binary.op.type && 
+				a->binary.right == b->binary.right;
+		case indexExp:
+			return a->index.exp == b->index.exp && a->index.index == b->index.index;
+		default:
+			return false;
+	}
+}
+
+// ast_unit_forget_shared_exps empties the hash consing table so nodes of the
+// declarations built so far are never handed out again. The pipelined parser
+// calls it before a declaration crosses to the checker thread, which writes
+// resolvedType into those nodes
+void ast_unit_forget_shared_exps(ast_unit *ast) {
+	exp_table *table = ast->exp_table;
+	if (table == NULL || table->count == 0) return;
+	memset(table->slots, 0, table->capacity * sizeof(Exp *));
+	table->count = 0;
+}
+
+// exp_table_grow doubles the capacity of the table and reinserts the nodes
+void exp_table_grow(exp_table *table) {
+	Exp **old_slots = table->slots;
+	int old_capacity = table->capacity;
+	table->capacity *= 2;
+	table->slots = calloc(table->capacity, sizeof(Exp *));
+
+	for (int i = 0; i < old_capacity; i++) {
+		if (old_slots[i] == NULL) continue;
+		int slot = exp_hash(old_slots[i]) & (table->capacity - 1);
+		while (table->slots[slot] != NULL) slot = (slot + 1) & (table->capacity - 1);
+		table->slots[slot] = old_slots[i];
+	}
+	free(old_slots);
+}
+
+// share_exp returns an existing node identical to e (releasing e) if hash consing
+// is enabled and e is pure and resolved, otherwise e is returned
+Exp *share_exp(ast_unit *ast, Exp *e) {
+	exp_table *table = ast->exp_table;
+	if (table == NULL || !exp_is_pure(e)) return e;
+
+	// unresolved identifiers are bound later by the resolution pass, so they cant
+	// be shared between declarations
+	if (e->type == identExp && e->ident.obj == NULL) return e;
+
+	// linear probe for an identical node
+	int slot = exp_hash(e) & (table->capacity - 1);
+	while (table->slots[slot] != NULL) {
+		if (exp_equal(table->slots[slot], e)) {
+			table->shared++;
+			pool_release(ast->exp_pool, e);
+			return table->slots[slot];
+		}
+		slot = (slot + 1) & (table->capacity - 1);
+	}
+
+	table->slots[slot] = e;
+	table->count++;
+	if (table->count * 2 > table->capacity) exp_table_grow(table);
+	return e;
+}
+
+// new_exp gets an expression node from the pool, the node has no type until the
+// semantic pass annotates it
+Exp *new_exp(ast_unit *ast) {
 	Exp *e = pool_get(ast->exp_pool);
+	e->resolvedType = NULL;
+	return e;
+}
+
+Exp *new_ident_exp(ast_unit *ast, Token token, Object *obj) {
+	Exp *e = new_exp(ast);
 	e->type = identExp;
-	e->ident.name = ident;
-	e->ident.obj = NULL;
+	e->ident.name = token.value;
+	e->ident.obj = obj;
+	e->ident.token = token;
 
-	return e;
+	return share_exp(ast, e);
 }
 
 Exp *new_literal_exp(ast_unit *ast, Token lit) {
-	Exp *e = pool_get(ast->exp_pool);
+	Exp *e = new_exp(ast);
 	e->type = literalExp;
 	e->literal = lit;
 
-	return e;
+	return share_exp(ast, e);
 }
 
 Exp *new_unary_exp(ast_unit *ast, Token op, Exp *right) {
-	Exp *e = pool_get(ast->exp_pool);
+	Exp *e = new_exp(ast);
 	e->type = unaryExp;
 	e->unary.op = op;
 	e->unary.right = right;
 
-	return e;
+	return share_exp(ast, e);
 }
 
 Exp *new_binary_exp(ast_unit *ast, Exp *left, Token op, Exp *right) {
-	Exp *e = pool_get(ast->exp_pool);
+	Exp *e = new_exp(ast);
 	e->type = binaryExp;
 	e->binary.left = left;
 	e->binary.op = op;
 	e->binary.right = right;
 
-	return e;
+	return share_exp(ast, e);
 }
 
 Exp *new_selector_exp(ast_unit *ast, Exp *exp, Exp* selector) {
-	Exp *e = pool_get(ast->exp_pool);
+	Exp *e = new_exp(ast);
 	e->type = selectorExp;
 	e->selector.exp = exp;
 	e->selector.selector = selector;
@@ -57,16 +251,16 @@ Exp *new_selector_exp(ast_unit *ast, Exp *exp, Exp* selector) {
 }
 
 Exp *new_index_exp(ast_unit *ast, Exp *exp, Exp *index) {
-	Exp *e = pool_get(ast->exp_pool);
+	Exp *e = new_exp(ast);
 	e->type = indexExp;
 	e->index.exp = exp;
 	e->index.index = index;
 
-	return e;
+	return share_exp(ast, e);
 }
 
 Exp *new_slice_exp(ast_unit *ast, Exp *exp, Exp *low, Exp *high) {
-	Exp *e = pool_get(ast->exp_pool);
+	Exp *e = new_exp(ast);
 	e->type = sliceExp;
 	e->slice.exp = exp;
 	e->slice.low = low;
@@ -76,7 +270,7 @@ Exp *new_slice_exp(ast_unit *ast, Exp *exp, Exp *low, Exp *high) {
 }
 
 Exp *new_star_exp(ast_unit *ast, Exp *exp) {
-	Exp *e = pool_get(ast->exp_pool);
+	Exp *e = new_exp(ast);
 	e->type = starExp;
 	e->star = exp;
 
@@ -84,7 +278,7 @@ Exp *new_star_exp(ast_unit *ast, Exp *exp) {
 }
 
 Exp *new_call_exp(ast_unit *ast, Exp *function, Exp *args, int argCount) {
-	Exp *e = pool_get(ast->exp_pool);
+	Exp *e = new_exp(ast);
 	e->type = callExp;
 	e->call.function = function;
 	e->call.args = args;
@@ -94,7 +288,7 @@ Exp *new_call_exp(ast_unit *ast, Exp *function, Exp *args, int argCount) {
 }
 
 Exp *new_key_value_exp(ast_unit *ast, Exp *key, Exp *value) {
-	Exp *e = pool_get(ast->exp_pool);
+	Exp *e = new_exp(ast);
 	e->type = keyValueExp;
 	e->keyValue.key = key;
 	e->keyValue.value = value;
@@ -103,7 +297,7 @@ Exp *new_key_value_exp(ast_unit *ast, Exp *key, Exp *value) {
 }
 
 Exp *new_key_value_list_exp(ast_unit *ast, Exp *values, int keyCount) {
-	Exp *e = pool_get(ast->exp_pool);
+	Exp *e = new_exp(ast);
 	e->type = keyValueListExp;
 	e->keyValueList.keyValues = values;
 	e->keyValueList.keyCount = keyCount;
@@ -112,7 +306,7 @@ Exp *new_key_value_list_exp(ast_unit *ast, Exp *values, int keyCount) {
 }
 
 Exp *new_struct_exp(ast_unit *ast, Exp *type, Exp *list) {
-	Exp *e = pool_get(ast->exp_pool);
+	Exp *e = new_exp(ast);
 	e->type = structValueExp;
 	e->structValue.type = type;
 	e->structValue.list = list;
@@ -121,7 +315,7 @@ Exp *new_struct_exp(ast_unit *ast, Exp *type, Exp *list) {
 }
 
 Exp *new_array_exp(ast_unit *ast, Exp *values, int valueCount) {
-	Exp *e = pool_get(ast->exp_pool);
+	Exp *e = new_exp(ast);
 	e->type = arrayExp;
 	e->array.values = values;
 	e->array.valueCount = valueCount;
@@ -130,7 +324,7 @@ Exp *new_array_exp(ast_unit *ast, Exp *values, int valueCount) {
 }
 
 Exp *new_array_type_exp(ast_unit *ast, Exp *type, Exp *length) {
-	Exp *e = pool_get(ast->exp_pool);
+	Exp *e = new_exp(ast);
 	e->type = arrayTypeExp;
 	e->arrayType.type = type;
 	e->arrayType.length = length;
@@ -139,7 +333,7 @@ Exp *new_array_type_exp(ast_unit *ast, Exp *type, Exp *length) {
 }
 
 Exp *new_feild_type_exp(ast_unit *ast, Exp *type, Exp *name) {
-	Exp *e = pool_get(ast->exp_pool);
+	Exp *e = new_exp(ast);
 	e->type = fieldTypeExp;
 	e->fieldType.type = type;
 	e->fieldType.name = name;
@@ -148,7 +342,7 @@ Exp *new_feild_type_exp(ast_unit *ast, Exp *type, Exp *name) {
 }
 
 Exp *new_struct_type_exp(ast_unit *ast, Exp *fields, int count) {
-	Exp *e = pool_get(ast->exp_pool);
+	Exp *e = new_exp(ast);
 	e->type = structTypeExp;
 	e->structType.fields = fields;
 	e->structType.feildCount = count;
@@ -193,15 +387,30 @@ Smt *new_binary_assignment_smt(ast_unit *ast, Exp *left, TokenType op, Exp *righ
 		case MUL_ASSIGN:
 			t.type = MUL;
 			break;
+		case QUO_ASSIGN:
+			t.type = QUO;
+			break;
 		case REM_ASSIGN:
 			t.type = REM;
 			break;
+		case AND_ASSIGN:
+			t.type = AND;
+			break;
 		case OR_ASSIGN:
 			t.type = OR; 
 			break;
+		case XOR_ASSIGN:
+			t.type = XOR;
+			break;
 		case SHL_ASSIGN:
 			t.type = SHL;
 			break;
+		case SHR_ASSIGN:
+			t.type = SHR;
+			break;
+		case AND_NOT_ASSIGN:
+			t.type = AND_NOT;
+			break;
 		default:
 			ASSERT(false, "Expected an assignment token");
 	}
@@ -210,10 +419,11 @@ Smt *new_binary_assignment_smt(ast_unit *ast, Exp *left, TokenType op, Exp *righ
 	return e; 
 }
 
-Smt *new_ret_smt(ast_unit *ast, Exp *result) {
+Smt *new_ret_smt(ast_unit *ast, Token token, Exp *result) {
 	Smt *s = pool_get(ast->smt_pool);
 	s->type = returnSmt;
 	s->ret.result = result;
+	s->ret.token = token;
 	
 	return s;
 }
@@ -248,9 +458,42 @@ Smt *new_for_smt(ast_unit *ast, Dcl *index, Exp *cond, Smt *inc, Smt *body) {
 	return s;
 }
 
+Smt *new_branch_smt(ast_unit *ast, Token token) {
+	Smt *s = pool_get(ast->smt_pool);
+	s->type = branchSmt;
+	s->branch.token = token;
+
+	return s;
+}
+
+Smt *new_switch_smt(ast_unit *ast, Exp *tag, Smt *clauses, int clauseCount) {
+	Smt *s = pool_get(ast->smt_pool);
+	s->type = switchSmt;
+	s->switchs.tag = tag;
+	s->switchs.clauses = clauses;
+	s->switchs.clauseCount = clauseCount;
+
+	return s;
+}
+
+Smt *new_case_smt(ast_unit *ast, Token token, Exp *exps, int expCount, Smt *body, bool fallthrough) {
+	Smt *s = pool_get(ast->smt_pool);
+	s->type = caseSmt;
+	s->cases.token = token;
+	s->cases.exps = exps;
+	s->cases.expCount = expCount;
+	s->cases.body = body;
+	s->cases.fallthrough = fallthrough;
+
+	return s;
+}
+
 Dcl *new_varible_dcl(ast_unit *ast, char *name, Exp *type, Exp *value) {
 	Dcl *d = pool_get(ast->dcl_pool);
 	d->type = varibleDcl;
+	d->llvmValue = NULL;
+	d->written = false;
+	d->token = (Token){0};
 	d->varible.name = name;
 	d->varible.type = type;
 	d->varible.value = value;
@@ -261,6 +504,9 @@ Dcl *new_varible_dcl(ast_unit *ast, char *name, Exp *type, Exp *value) {
 Dcl *new_argument_dcl(ast_unit *ast, Exp *type, char *name) {
 	Dcl *d = pool_get(ast->dcl_pool);
 	d->type = argumentDcl;
+	d->llvmValue = NULL;
+	d->written = false;
+	d->token = (Token){0};
 	d->argument.type = type;
 	d->argument.name = name;
 
@@ -270,6 +516,9 @@ Dcl *new_argument_dcl(ast_unit *ast, Exp *type, char *name) {
 Dcl *new_function_dcl(ast_unit *ast, char *name, Dcl *args, int argCount, Exp *returnType, Smt *body) {
 	Dcl *d = pool_get(ast->dcl_pool);
 	d->type = functionDcl;
+	d->llvmValue = NULL;
+	d->written = false;
+	d->token = (Token){0};
 	d->function.name = name;
 	d->function.args = args;
 	d->function.argCount = argCount;
@@ -1,62 +1,132 @@
 #include "includes/error.h"
+#include <unistd.h>
+#include <time.h>
 
-void verror(char *src, int line, int start, int end, char *msg, va_list args) {
-    ASSERT(start >= 0, "start underflows the line");
-    
-    // print message
-    printf("\e[31m\e[1mERROR:\e[0m "); 
-    vprintf(msg, args);
-    printf("\n\n");
-
-    // get the position of line withing the source code
-    char *src_ptr = src;
-    int line_end = 0;
-    int line_start = 0;
-    int current_line = 0;
-    while(true) {
-        if(*src_ptr == '\n') {
-            line_end = src_ptr - src;
-            if(current_line != line - 1) {
-                line_start = src_ptr - src;
-            } else {
-                break;
-            }
-            current_line++;
+#define DIAGNOSTIC_TAB_WIDTH 4
+
+// new_line_index finds the start of every line in src
+line_index *new_line_index(char *src) {
+    line_index *index = malloc(sizeof(line_index));
+    index->src = src;
+
+    int capacity = 64;
+    index->starts = malloc(capacity * sizeof(int));
+    index->starts[0] = 0;
+    index->count = 1;
+    for (char *c = src; *c != '\0'; c++) {
+        if (*c != '\n') continue;
+        if (index->count == capacity) {
+            capacity *= 2;
+            index->starts = realloc(index->starts, capacity * sizeof(int));
         }
-        src_ptr++;
+        index->starts[index->count++] = c - src + 1;
     }
-    int line_length = line_end - line_start;
-    
-    // print line number
-    printf("\e[2m%5d|\e[0m ", line);
-    
-    // print source code
-    char *src_line = malloc(line_length);
-    memcpy(src_line, src + line_start, line_length * sizeof(char));
-    if(src_line[0] == '\n') {
-        // remove leading newline
-        src_line++;
-        line_length--;
+
+    return index;
+}
+
+// line_index_line returns the start of line (not null terminated) and sets length to its
+// length without the newline, returns NULL if the line is not in the source
+char *line_index_line(line_index *index, int line, int *length) {
+    if (line < 1 || line > index->count) return NULL;
+    char *start = index->src + index->starts[line - 1];
+    char *end = line < index->count ? index->src + index->starts[line] - 1 : start + strlen(start);
+    if (end > start && end[-1] == '\r') end--;
+    *length = end - start;
+    return start;
+}
+
+void line_index_destroy(line_index *index) {
+    free(index->starts);
+    free(index);
+}
+
+// diagnostic_begin appends the start of an error message to out, the message follows
+string diagnostic_begin(string out) {
+    return string_append_cstring(out, "\e[31m\e[1mERROR:\e[0m ");
+}
+
+// diagnostic_source ends the message and appends the source line with columns start
+// to end (1 based, inclusive) underlined
+string diagnostic_source(string out, char *line_src, int line_length, int line, int start, int end) {
+    ASSERT(start >= 1, "start underflows the line");
+    out = string_append_format(out, "\n\n\e[2m%5d|\e[0m ", line);
+
+    // print leading tabs as spaces (since we dont start on a column boundry), moving the underline with them
+    int tabs = 0;
+    while (tabs < line_length && line_src[tabs] == '\t') {
+        out = string_append_cstring(out, "    ");
+        tabs++;
     }
-    while(src_line[0] == '\t') {
-        // print tabs as 4 spaces (since we dont start on a column boundry)
-        printf("    ");
-        src_line++;
-        line_length += 4;
+    out = string_append_length(out, line_src + tabs, line_length - tabs);
+    out = string_append_cstring(out, "\n       \e[91m\e[1m");
+
+    int shift = tabs * (DIAGNOSTIC_TAB_WIDTH - 1);
+    for (int column = 1; column <= end + shift; column++) {
+        out = string_append_char(out, column < start + shift ? ' ' : '^');
     }
-    printf("%s\n", src_line);
+    return string_append_cstring(out, "\e[0m\n\n");
+}
 
-    // print error underlining
-    char *buff = malloc(line_length * sizeof(char));
-    for (int i = 0; i < line_length; i++) {
-        if (i >= start - 1 && i < end) {
-            buff[i] = '^';
+// diagnostic_write writes out to f with a single write, after flushing anything
+// already buffered in f so the output stays in order
+void diagnostic_write(string out, FILE *f) {
+    fflush(f);
+    char *data = out;
+    int remaining = string_length(out);
+    while (remaining > 0) {
+        ssize_t written = write(fileno(f), data, remaining);
+        if (written < 0) return;
+        data += written;
+        remaining -= written;
+    }
+}
+
+// diagnostic_now returns a monotonic time in seconds, used to time compile phases
+double diagnostic_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// diagnostic_json_string appends str to out as a quoted JSON string
+string diagnostic_json_string(string out, char *str) {
+    out = string_append_char(out, '"');
+    for (char *c = str; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            out = string_append_char(out, '\\');
+            out = string_append_char(out, *c);
+        } else if ((unsigned char)*c < 0x20) {
+            out = string_append_format(out, "\\u%04x", *c);
         } else {
-            buff[i] = ' ';
+            out = string_append_char(out, *c);
         }
     }
-    buff[line_length-1] = '\0';
-    printf("       \e[91m\e[1m%s\e[0m\n\n", buff);
+    return string_append_char(out, '"');
+}
+
+// diagnostic_json_phase appends a JSON line recording the time taken by a compile phase
+string diagnostic_json_phase(string out, char *phase, double seconds) {
+    out = string_append_cstring(out, "{\"kind\":\"phase\",\"phase\":");
+    out = diagnostic_json_string(out, phase);
+    return string_append_format(out, ",\"seconds\":%.6f}\n", seconds);
+}
+
+void verror(char *src, int line, int start, int end, char *msg, va_list args) {
+    string out = string_new_capacity(256);
+    out = diagnostic_begin(out);
+    out = string_append_vformat(out, msg, args);
+
+    // find the line without copying it
+    char *line_src = src;
+    for (int current_line = 1; current_line < line && *line_src != '\0'; line_src++) {
+        if (*line_src == '\n') current_line++;
+    }
+    int line_length = strcspn(line_src, "\r\n");
+
+    out = diagnostic_source(out, line_src, line_length, line, start, end);
+    diagnostic_write(out, stdout);
+    string_free(out);
 }
 
 void error(char *src, int line, int start, int end, char *msg, ...) {
@@ -64,4 +134,4 @@ void error(char *src, int line, int start, int end, char *msg, ...) {
     va_start(args, msg);
     verror(src, line, start, end, msg, args);
     va_end(args);
-}
\ No newline at end of file
+}
@@ -2,6 +2,7 @@
 
 #include "all.h"
 #include "pool.h"
+#include "slab.h"
 #include <llvm-c/Core.h>
 
 struct Exp;
@@ -13,15 +14,32 @@ typedef struct Dcl Dcl;
 struct Smt;
 typedef struct Smt Smt;
 
+struct _Type; // types.h
+
+// exp_table hash conses pure expressions, so structurally identical subtrees
+// share a single node
+typedef struct {
+	Exp **slots;
+	int capacity;
+	int count;
+	int shared; // amount of nodes that were replaced by an existing node
+} exp_table;
+
 typedef struct {
 	pool *dcl_pool;
 	pool *smt_pool;
 	pool *exp_pool;
+	slab *slab; // variable sized payloads (argument/element arrays, objects)
+	exp_table *exp_table; // NULL unless hash consing is enabled
 	Dcl **dcls;
 	int dclCount;
 } ast_unit;
 
 ast_unit *new_ast_unit();
+void ast_unit_enable_hash_consing(ast_unit *ast);
+void ast_unit_forget_shared_exps(ast_unit *ast);
+void ast_unit_handoff(ast_unit *ast);
+void ast_unit_adopt(ast_unit *ast);
 
 typedef enum {
 	badObj,
@@ -51,6 +69,8 @@ typedef enum {
 struct Dcl {
 	DclType type;
 	LLVMValueRef llvmValue;
+	bool written; // set by the semantic pass when the varible or argument is assigned to
+	Token token;  // name of the declaration, errors about it are located here
 	union {
 		struct { char *name; Exp *type; Exp *value; } 									varible;
 		struct { Exp *type; char *name; } 												argument;
@@ -71,6 +91,9 @@ typedef enum {
 	blockSmt,
 	ifSmt,
 	forSmt,
+	switchSmt,
+	caseSmt,
+	branchSmt,
 } SmtType;
 
 struct Smt {
@@ -78,20 +101,29 @@ struct Smt {
 	union {
 		Dcl *													declare;
 		struct { Exp *left; Exp *right; } 						assignment;
-		struct { Exp *result; } 								ret;
+		struct { Exp *result; Token token; } 					ret;
 		struct { Smt *smts; int count; } 						block;
 		struct { Exp *cond; Smt *body; Smt *elses; } 			ifs;
 		struct { Dcl *index; Exp *cond; Smt *inc; Smt *body; } 	fors;
+		struct { Exp *tag; Smt *clauses; int clauseCount; } 		switchs;
+		// a clause with no expressions is the default clause
+		// token is the case or default keyword
+		struct { Exp *exps; int expCount; Smt *body; bool fallthrough; Token token; } cases;
+		// token is BREAK or CONTINUE
+		struct { Token token; } 								branch;
 	};
 };
 
 Smt *new_declare_smt(ast_unit *ast, Dcl *dcl);
 Smt *new_assignment_smt(ast_unit *ast, Exp *left, Exp *right);
 Smt *new_binary_assignment_smt(ast_unit *ast, Exp *left, TokenType op, Exp *right);
-Smt *new_ret_smt(ast_unit *ast, Exp *result);
+Smt *new_ret_smt(ast_unit *ast, Token token, Exp *result);
 Smt *new_block_smt(ast_unit *ast, Smt *smts, int smtCount);
 Smt *new_if_smt(ast_unit *ast, Exp *cond, Smt *body, Smt *elses);
 Smt *new_for_smt(ast_unit *ast, Dcl *index, Exp *cond, Smt *inc, Smt *body);
+Smt *new_branch_smt(ast_unit *ast, Token token);
+Smt *new_switch_smt(ast_unit *ast, Exp *tag, Smt *clauses, int clauseCount);
+Smt *new_case_smt(ast_unit *ast, Token token, Exp *exps, int expCount, Smt *body, bool fallthrough);
 
 // ============ Expressions ============
 
@@ -120,8 +152,9 @@ typedef enum {
 
 struct Exp {
 	ExpType type;
+	struct _Type *resolvedType; // set by the semantic pass
 	union {
-		struct { char *name; Object *obj; } 				ident;
+		struct { char *name; Object *obj; Token token; } 	ident;
 		Token 												literal;
 		struct { Token op; Exp *right; } 					unary;
 		struct { Exp *left; Token op; Exp *right; } 		binary;
@@ -140,7 +173,9 @@ struct Exp {
 	};
 };
 
-Exp *new_ident_exp(ast_unit *ast, char *ident);
+bool exp_is_pure(Exp *e);
+Exp *new_exp(ast_unit *ast);
+Exp *new_ident_exp(ast_unit *ast, Token token, Object *obj);
 Exp *new_literal_exp(ast_unit *ast, Token lit);
 Exp *new_unary_exp(ast_unit *ast, Token op, Exp *right);
 Exp *new_binary_exp(ast_unit *ast, Exp *left, Token op, Exp *right);
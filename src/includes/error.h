@@ -1,9 +1,31 @@
 #pragma once
 
 #include "all.h"
+#include "string.h"
 #include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
-void error(char *src, int line, int start, int end, char *msg, ...);
\ No newline at end of file
+// line_index maps line numbers to where they start in the source, so any
+// amount of diagnostics can be located with one pass over the source
+typedef struct {
+    char *src;
+    int *starts; // offset of each line, starts[0] is line 1
+    int count;
+} line_index;
+
+line_index *new_line_index(char *src);
+char *line_index_line(line_index *index, int line, int *length);
+void line_index_destroy(line_index *index);
+
+string diagnostic_begin(string out);
+string diagnostic_source(string out, char *line_src, int line_length, int line, int start, int end);
+void diagnostic_write(string out, FILE *f);
+
+double diagnostic_now();
+string diagnostic_json_string(string out, char *str);
+string diagnostic_json_phase(string out, char *phase, double seconds);
+
+void verror(char *src, int line, int start, int end, char *msg, va_list args);
+void error(char *src, int line, int start, int end, char *msg, ...);
@@ -1,14 +1,86 @@
 #pragma once
 
 #include "all.h"
+#include "uthash.h"
+#include "types.h"
 
 #include <llvm-c/Core.h>
 
+// exp_value caches the value of a (hash consed) expression node
+typedef struct {
+    Exp *exp;
+    LLVMValueRef value;
+    LLVMBasicBlockRef block;
+    int generation;
+    UT_hash_handle hh;
+} exp_value;
+
+// ssa_def is the value of a register variable at the end of a block
+typedef struct {
+    struct { Dcl *var; LLVMBasicBlockRef block; } key;
+    LLVMValueRef value;
+    UT_hash_handle hh;
+} ssa_def;
+
+// ssa_phi is a phi in a block whose predecessors are not all known yet, its
+// operands are added when the block is sealed
+typedef struct ssa_phi {
+    Dcl *var;
+    LLVMValueRef phi;
+    struct ssa_phi *next;
+} ssa_phi;
+
+// ssa_block records whether all the predecessors of a block have been built
+typedef struct {
+    LLVMBasicBlockRef block;
+    bool sealed;
+    ssa_phi *incomplete;
+    UT_hash_handle hh;
+} ssa_block;
+
+// ssa_removed maps a trivial phi that was removed to the value that replaced it,
+// the phi is erased once the function is compiled
+typedef struct {
+    LLVMValueRef phi;
+    LLVMValueRef value;
+    UT_hash_handle hh;
+} ssa_removed;
+
 struct _Irgen {
     LLVMModuleRef module;
     LLVMBuilderRef builder;
     LLVMValueRef function;
     LLVMBasicBlockRef block;
+
+    // targets of break and continue in the innermost loop or switch, a switch
+    // only changes the break target
+    LLVMBasicBlockRef breakBlock;
+    LLVMBasicBlockRef continueBlock;
+
+    // locals are allocated in the entry block before allocaPoint, a placeholder
+    // removed once the function is compiled, so a local declared in a loop gets
+    // one stack slot per call that mem2reg can promote
+    LLVMBuilderRef allocaBuilder;
+    LLVMValueRef allocaPoint;
+
+    // when reuse_values is set, pure expressions compiled earlier in the same block
+    // are reused until memory is written (which increments generation)
+    bool reuse_values;
+    exp_value *values;
+    int generation;
+
+    // when direct_ssa is set scalar variables and arguments live in registers, their
+    // phis are placed while compiling (Braun et al. 2013) rather than by mem2reg.
+    // Arrays are indexed through their address so they are still allocated.
+    bool direct_ssa;
+    ssa_def *defs;
+    ssa_block *blocks;
+    ssa_removed *removed;
+
+    // types resolved in this module, expressions are annotated with their types
+    // by the semantic pass before they are compiled
+    TypeTable *types;
+    Type *returnType; // return type of the function being compiled
 };
 
 typedef struct _Irgen Irgen;
@@ -16,13 +88,30 @@ typedef struct _Irgen Irgen;
 Irgen *NewIrgen();
 
 LLVMValueRef CompileExp(Irgen *irgen, Exp *e);
-LLVMTypeRef CompileType(Exp *e);
+LLVMValueRef CompileExpAs(Irgen *irgen, Exp *e, Type *type);
+LLVMTypeRef CompileType(Irgen *irgen, Exp *e);
 LLVMValueRef CompileLiteralExp(Irgen *irgen, Exp *e);
+LLVMValueRef CompileLiteralAs(Irgen *irgen, Exp *e, LLVMTypeRef type);
+LLVMValueRef CompileArrayLiteral(Irgen *irgen, Exp *e, bool copy);
 
 void CompileDcl(Irgen *irgen, Dcl *d);
+LLVMValueRef DeclareFunction(Irgen *irgen, Dcl *d);
 LLVMValueRef CompileFunction(Irgen *i, Dcl *d);
+LLVMValueRef BuildEntryAlloca(Irgen *irgen, LLVMTypeRef type, char *name);
+void BuildArrayCopy(Irgen *irgen, LLVMValueRef dest, LLVMValueRef src, LLVMTypeRef type);
+bool ReturnsArray(Irgen *irgen, Dcl *d);
 
 void CompileSmt(Irgen *i, Smt *s);
 void CompileBlock(Irgen *i, Smt *s);
 
+void InvalidateValues(Irgen *irgen);
+
+void WriteVariable(Irgen *irgen, Dcl *var, LLVMBasicBlockRef block, LLVMValueRef value);
+LLVMValueRef ReadVariable(Irgen *irgen, Dcl *var, LLVMBasicBlockRef block);
+LLVMValueRef ReadVariableRecursive(Irgen *irgen, Dcl *var, LLVMBasicBlockRef block);
+LLVMValueRef ReadPredecessors(Irgen *irgen, Dcl *var, LLVMBasicBlockRef block);
+LLVMValueRef AddPhiOperands(Irgen *irgen, Dcl *var, LLVMValueRef phi);
+LLVMValueRef TryRemoveTrivialPhi(Irgen *irgen, LLVMValueRef phi);
+void SealBlock(Irgen *irgen, LLVMBasicBlockRef block);
+void FinishSSA(Irgen *irgen);
 LLVMValueRef Cast(Irgen *irgen, LLVMValueRef value, LLVMTypeRef type);
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "all.h"
+#include "slab.h"
+#include "spsc_queue.h"
 #include <string.h>
 #include <stdlib.h>
 
@@ -102,9 +104,15 @@ typedef struct {
 	int line;
 	int column;
 	bool semi;
+	slab *slab;
+	char *line_start; // start of the current line, used to find columns
 } Lexer;
 
 Token *Lex(char *source);
+Token *LexSlab(char *source, slab *s);
+Token LexNext(Lexer *lexer);
+void LexQueue(char *source, slab *s, spsc_queue *q);
+int LexMaxTokens(char *source);
 char *TokenName(TokenType type);
 char *GetLine(char *src, int line);
 int get_binding_power(TokenType type);
\ No newline at end of file
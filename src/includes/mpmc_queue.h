@@ -0,0 +1,40 @@
+#pragma once
+
+#include "all.h"
+#include <stddef.h>
+
+// Bounded lock-free multi-producer multi-consumer queue (Dmitry Vyukov's design).
+// Every cell has a sequence number which tells producers and consumers whether
+// the cell is free for the current lap of the ring, so each push/pop is a
+// single compare and swap on the enqueue or dequeue position. Elements are
+// copied in and out of the ring so no memory is allocated after creation.
+//
+// Fields are accessed with atomic builtins and must not be touched directly.
+
+#define MPMC_CACHE_LINE 64
+
+typedef struct {
+    char *cells;
+    size_t cell_size;    // sequence + element, rounded to pointer alignment
+    size_t element_size;
+    size_t mask;         // capacity - 1, capacity is a power of two
+    char pad0[MPMC_CACHE_LINE - 4 * sizeof(size_t)];
+
+    size_t enqueue_pos;
+    char pad1[MPMC_CACHE_LINE - sizeof(size_t)];
+
+    size_t dequeue_pos;
+    char pad2[MPMC_CACHE_LINE - sizeof(size_t)];
+
+    bool closed;
+} mpmc_queue;
+
+mpmc_queue *new_mpmc_queue(size_t element_size, int capacity);
+int mpmc_queue_capacity(mpmc_queue *q);
+bool mpmc_queue_try_push(mpmc_queue *q, void *element);
+void mpmc_queue_push(mpmc_queue *q, void *element);
+bool mpmc_queue_try_pop(mpmc_queue *q, void *element);
+bool mpmc_queue_pop(mpmc_queue *q, void *element);
+void mpmc_queue_close(mpmc_queue *q);
+bool mpmc_queue_closed(mpmc_queue *q);
+void mpmc_queue_destroy(mpmc_queue *q);
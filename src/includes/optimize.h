@@ -0,0 +1,16 @@
+#pragma once
+
+#include "all.h"
+
+#include <llvm-c/Core.h>
+
+// OptLevel mirrors the driver flags, speed is 0-3 for -O0 to -O3 and size is 1
+// for -Os (which optimizes like -O2 but keeps code from growing)
+typedef struct {
+    int speed;
+    int size;
+} OptLevel;
+
+bool ParseOptLevel(char *flag, OptLevel *level);
+int InlineThreshold(OptLevel level);
+void OptimizeModule(LLVMModuleRef module, OptLevel level);
@@ -3,6 +3,8 @@
 #include "uthash.h"
 #include "all.h"
 #include "queue.h"
+#include "spsc_queue.h"
+#include "error.h"
 
 #define ERROR_QUEUE_SIZE 10
 #define MAX_ERRORS 10
@@ -24,6 +26,12 @@ typedef struct {
     Token *tokens;
 	ast_unit *ast;
 	queue *error_queue;
+
+	// streaming, token_queue and dcl_queue are NULL when not pipelined
+	Token *token_end;         // one past the last token pulled from token_queue
+	Token *token_max;         // end of the token buffer
+	spsc_queue *token_queue;  // tokens from the lexer thread
+	spsc_queue *dcl_queue;    // finished declarations for the irgen thread
 } parser;
 
 typedef enum {
@@ -36,6 +44,7 @@ typedef enum {
 	parser_error_expect_block,
 	parser_error_expect_prefix,
 	parser_error_expect_infix,
+	parser_error_misplaced_fallthrough,
 } parser_error_type;
 
 typedef struct {
@@ -52,6 +61,7 @@ typedef struct {
 
 // Parser interface
 parser *new_parser(Token *tokens);
+parser *new_stream_parser(spsc_queue *token_queue, int max_tokens);
 ast_unit *parse_file(parser *parser);
 
 // Scope
@@ -63,20 +73,32 @@ Object *parser_find_scope(parser *parser, char *name);
 
 // Helpers
 void parser_next(parser *parser);
+void parser_pull_token(parser *parser);
 Token *parser_expect(parser *parser, TokenType type);
 void parser_expect_semi(parser *parser);
 parser_error *new_error(parser *p, parser_error_type type, int length);
 parser_error *new_error_token(parser *p, TokenType token_type);
 
+// Diagnostics
+string format_error(string out, parser_error *error);
+string parser_render_errors(parser *p, char *src, string out, int *count);
+int parser_report_errors(parser *p, char *src);
+char *token_text(Token *token);
+void parser_error_span(parser_error *error, int *line, int *column, int *length);
+char *parser_error_kind(parser_error_type type);
+string parser_render_errors_json(parser *p, string out, int *count);
+
 // Declarations
 Dcl *parse_declaration(parser *parser);
 Dcl *parse_function_dcl(parser *parser);
+Dcl *parse_global_variable_dcl(parser *parser);
 Dcl *parse_variable_dcl(parser *parser);
 
 // Statements
 Smt *parse_statement(parser *parser);
 Smt *parse_statement_from_string(char *src);
 Smt *parse_block_smt(parser *p);
+Smt *parse_case_clause(parser *p);
 Smt *smtd(parser *p, Token *token);
 
 // Expressions
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "all.h"
+#include "lexer.h"
+#include "parser.h"
+#include "irgen.h"
+#include "semantic.h"
+#include "spsc_queue.h"
+#include <pthread.h>
+
+#define PIPELINE_TOKEN_QUEUE_SIZE 4096
+#define PIPELINE_DCL_QUEUE_SIZE 256
+
+// pipeline_dcl follows a top level declaration from the parser to irgen. It is
+// checked once every name it uses is declared and compiled once every declaration
+// it uses has been checked, so irgen never sees a type the checker hasnt accepted.
+typedef struct {
+    Dcl *dcl;
+    int undeclared; // names used by dcl that arent declared yet
+    int unchecked;  // declarations used by dcl that arent checked yet
+    bool checked;
+    bool compiled;
+} pipeline_dcl;
+
+// pipeline_name is a top level name and the declarations that use it, which are
+// the ones to update when it is declared or its declaration is checked
+typedef struct {
+    char *name;
+    pipeline_dcl *dcl; // NULL until the name is declared
+    pipeline_dcl **users;
+    int userCount;
+    UT_hash_handle hh;
+} pipeline_name;
+
+// pipeline runs the lexer and parser on their own threads and the semantic pass
+// and irgen on the calling thread. Tokens stream from the lexer to the parser and finished top
+// level declarations stream from the parser to irgen, so compile time approaches
+// the slowest stage instead of the sum of all three.
+typedef struct {
+    char *source;
+    bool share_exps;
+
+    slab *token_slab;
+    spsc_queue *token_queue; // lexer -> parser
+    spsc_queue *dcl_queue;   // parser -> irgen
+    parser *parser;
+
+    // declaration ordering, only used by the calling thread
+    Irgen *irgen;
+    Checker *checker;
+    pipeline_name *names; // keyed by name
+    int errors;
+
+    pthread_t lexer_thread;
+    pthread_t parser_thread;
+} pipeline;
+
+ast_unit *pipeline_compile(pipeline *pl, char *source, Irgen *irgen, Checker *checker, bool share_exps);
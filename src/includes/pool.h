@@ -1,5 +1,7 @@
 #pragma once
 
+#include <pthread.h>
+
 struct pool_element;
 typedef struct pool_element pool_element;
 
@@ -7,15 +9,45 @@ struct pool_element {
     pool_element *next;
 };
 
+// pool_chunk is a block of elements, chunks are never moved once allocated so
+// pointers into the pool stay valid when the pool grows
+struct pool_chunk;
+typedef struct pool_chunk pool_chunk;
+
+struct pool_chunk {
+    pool_chunk *next;
+    int element_count;
+    size_t mapped_size; // size of the mapping if the chunk was mmap'd, 0 if malloc'd
+};
+
+// Chunks of at least POOL_HUGE_PAGE_SIZE can be backed by huge pages to reduce
+// TLB misses on large compilations. The mode is process wide and should be set
+// before any pools are created.
+#define POOL_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+typedef enum {
+    pool_pages_default,     // malloc
+    pool_pages_transparent, // mmap + madvise(MADV_HUGEPAGE)
+    pool_pages_explicit,    // mmap(MAP_HUGETLB), falling back to transparent
+} pool_page_mode;
+
+// A pool is owned by a single thread, only the owner may get/release elements.
+// To move a pool to another thread the owner calls pool_handoff and the new
+// thread calls pool_adopt after receiving it.
 typedef struct {
-    void *pool_memory;
+    pool_chunk *chunks;
     size_t element_size;
     int element_count;
 
     pool_element *head;
     pool_element *tail;
+
+    pthread_t owner;
+    bool owned;
 } pool;
 
+void pool_set_page_mode(pool_page_mode mode);
+pool_page_mode pool_get_page_mode();
 pool *new_pool(size_t element_size, int element_count);
 bool pool_full(pool *p);
 int pool_size(pool *p);
@@ -23,4 +55,6 @@ int pool_count(pool *p);
 void pool_extend(pool *p, int new_count);
 void *pool_get(pool *p);
 void pool_release(pool *p, void *element);
-void pool_destroy(pool *p);
\ No newline at end of file
+void pool_handoff(pool *p);
+void pool_adopt(pool *p);
+void pool_destroy(pool *p);
@@ -1,16 +1,24 @@
 #pragma once
 
 #include "all.h"
+#include "pool.h"
 
+struct queue;
+
+// queue_item is the header in front of every item. Items come from the queues
+// pool and freed items go onto the queues free list, so pushing and popping
+// does no heap allocation once the queue has reached its high water mark.
 struct queue_item {
     struct queue_item *prev;
     struct queue_item *next;
+    struct queue *queue; // queue the item belongs to, used by queue_free_item
 };
 
 typedef struct queue_item queue_item;
 
-typedef struct {
-    void *memory;
+typedef struct queue {
+    pool *item_pool;
+    queue_item *free_items;
     size_t element_size;
     int size;
     queue_item *first;
@@ -24,4 +32,4 @@ void *queue_push_back(queue *q);
 void *queue_pop_front(queue *q);
 void *queue_pop_back(queue *q);
 void queue_free_item(void *item);
-void queue_destroy(queue *q);
\ No newline at end of file
+void queue_destroy(queue *q);
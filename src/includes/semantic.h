@@ -0,0 +1,63 @@
+#pragma once
+
+#include "all.h"
+#include "ast.h"
+#include "types.h"
+#include "queue.h"
+#include "string.h"
+#include "error.h"
+#include "uthash.h"
+
+// CheckError is a type error found by the semantic pass, line is 0 when the
+// expression has no position in the source
+typedef struct {
+    string message;
+    int line;
+    int column;
+    int length;
+} CheckError;
+
+// Symbol is a top level declaration in the modules symbol table, identifiers bound
+// to it point at obj so the checker must outlive any use of the ast
+typedef struct {
+    Object obj;
+    UT_hash_handle hh;
+} Symbol;
+
+// CaseValue is a constant listed by a case clause, sorted to find duplicates
+typedef struct {
+    int64_t value;
+    int index; // position in the switch, the first of equal values is not a duplicate
+    Exp *exp;
+} CaseValue;
+
+// Checker runs the semantic passes before irgen. Resolution binds the identifiers
+// the parser left unbound (top level names) through the symbol table, so
+// declarations can refer to each other in any order. Type checking then annotates
+// every expression with its resolved type so irgen never has to infer or widen
+// types itself.
+typedef struct {
+    TypeTable *types;
+    Symbol *globals;  // keyed by name
+    Type *returnType; // return type of the function being checked
+    int loops;        // for loops around the statement being checked
+    int switches;     // switches around the statement being checked
+    queue *names;     // when set, resolution appends every top level name it looks up
+    queue *errors;
+} Checker;
+
+Checker *NewChecker(TypeTable *types);
+int CheckUnit(Checker *c, ast_unit *ast);
+int DeclareGlobal(Checker *c, Dcl *d);
+Object *LookupGlobal(Checker *c, char *name);
+int ResolveDcl(Checker *c, Dcl *d, bool report);
+int CheckDcl(Checker *c, Dcl *d);
+void CheckSmt(Checker *c, Smt *s);
+Type *CheckExp(Checker *c, Exp *e);
+Type *CheckType(Checker *c, Exp *e);
+Type *TypeOfDcl(Checker *c, Dcl *d);
+
+string RenderCheckErrors(Checker *c, char *src, string out, int *count);
+string RenderCheckErrorsJson(Checker *c, string out, int *count);
+int ReportCheckErrors(Checker *c, char *src);
+void DestroyChecker(Checker *c);
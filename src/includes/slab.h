@@ -0,0 +1,39 @@
+#pragma once
+
+#include "all.h"
+#include "pool.h"
+
+// Size classes are powers of two from SLAB_MIN_SIZE to SLAB_MAX_SIZE, each backed
+// by a pool. Larger allocations fall back to malloc.
+#define SLAB_MIN_SIZE 16
+#define SLAB_MAX_SIZE 256
+#define SLAB_CLASS_COUNT 5
+#define SLAB_CLASS_ELEMENTS 64
+
+struct slab_large;
+typedef struct slab_large slab_large;
+
+// slab_large is the header placed before a malloc'd (large) allocation
+struct slab_large {
+    slab_large *prev;
+    slab_large *next;
+};
+
+typedef struct {
+    pool *classes[SLAB_CLASS_COUNT];
+    slab_large *large;
+
+    // statistics
+    int alloc_count;
+    int large_count;
+} slab;
+
+slab *new_slab();
+void *slab_alloc(slab *s, size_t size);
+void *slab_realloc(slab *s, void *ptr, size_t old_size, size_t new_size);
+void slab_free(slab *s, void *ptr, size_t size);
+char *slab_strndup(slab *s, char *str, int length);
+int slab_chunk_count(slab *s);
+void slab_handoff(slab *s);
+void slab_adopt(slab *s);
+void slab_destroy(slab *s);
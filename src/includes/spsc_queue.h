@@ -0,0 +1,42 @@
+#pragma once
+
+#include "all.h"
+#include <stddef.h>
+
+// Bounded lock-free single-producer single-consumer ring, used to stream data
+// between pipeline stages running on different threads. The producer and
+// consumer positions live on separate cache lines and each side keeps a cached
+// copy of the other sides position, so the shared lines are only read when
+// the ring looks full or empty.
+//
+// Fields are accessed with atomic builtins and must not be touched directly.
+
+#define SPSC_CACHE_LINE 64
+
+typedef struct {
+    char *elements;
+    size_t element_size;
+    size_t mask; // capacity - 1, capacity is a power of two
+    char pad0[SPSC_CACHE_LINE - 3 * sizeof(size_t)];
+
+    // written by the producer
+    size_t tail;
+    size_t cached_head;
+    bool closed;
+    char pad1[SPSC_CACHE_LINE - 2 * sizeof(size_t) - sizeof(bool)];
+
+    // written by the consumer
+    size_t head;
+    size_t cached_tail;
+    char pad2[SPSC_CACHE_LINE - 2 * sizeof(size_t)];
+} spsc_queue;
+
+spsc_queue *new_spsc_queue(size_t element_size, int capacity);
+int spsc_queue_capacity(spsc_queue *q);
+bool spsc_queue_try_push(spsc_queue *q, void *element);
+void spsc_queue_push(spsc_queue *q, void *element);
+bool spsc_queue_try_pop(spsc_queue *q, void *element);
+bool spsc_queue_pop(spsc_queue *q, void *element);
+void spsc_queue_close(spsc_queue *q);
+bool spsc_queue_closed(spsc_queue *q);
+void spsc_queue_destroy(spsc_queue *q);
@@ -1,8 +1,20 @@
 #pragma once
 
+#include "all.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdint.h>
+
+// capacity is the amount of characters that fit without reallocating, not
+// counting the null terminator. Appends grow the capacity geometrically so
+// building a string by repeated appends is amortized linear.
+//
+// hash caches string_hash, 0 until it is first computed. Every operation that
+// changes the characters resets it.
 typedef struct {
     int length;
     int capacity;
+    uint64_t hash;
 } string_header;
 
 typedef char *string;
@@ -10,6 +22,7 @@ typedef char *string;
 string string_new(const char *str);
 string string_new_length(const char *str, int len);
 string string_new_file(FILE *f);
+string string_new_capacity(int capacity);
 
 void string_free(string s);
 
@@ -20,13 +33,64 @@ int string_capacity(string s);
 int string_avalible(string s);
 
 string string_expand(string s, int capacity);
+string string_reserve(string s, int length);
 
 string string_clear(string s);
 
 string string_append(string s1, string s2);
 string string_append_length(string s1, char *s2, int length);
 string string_append_cstring(string s, char *str);
+string string_append_char(string s, char c);
+string string_append_format(string s, const char *format, ...);
+string string_append_vformat(string s, const char *format, va_list args);
 
 string string_slice(string s, int start, int end);
 
-bool string_equals(string s1, string s2);
\ No newline at end of file
+bool string_equals(string s1, string s2);
+
+// STRING_HASH_SEED is the FNV-1a offset basis, the hash of no bytes
+#define STRING_HASH_SEED 14695981039346656037ULL
+
+uint64_t string_hash_append(uint64_t h, const void *data, int length);
+uint64_t string_hash_bytes(const char *data, int length);
+uint64_t string_hash(string s);
+int string_allocation_count();
+
+// small_string is a 24 byte value holding strings of up to SMALL_STRING_INLINE
+// characters inline, longer strings are kept in a heap allocated string. The
+// last byte is the inline length, or SMALL_STRING_HEAP for heap strings.
+#define SMALL_STRING_INLINE 22
+#define SMALL_STRING_HEAP 0x80
+
+typedef union {
+    struct {
+        char data[SMALL_STRING_INLINE + 1];
+        unsigned char length;
+    } small;
+    struct {
+        string str;
+        char pad[15];
+        unsigned char flag;
+    } heap;
+} small_string;
+
+small_string small_string_new(const char *str);
+small_string small_string_new_length(const char *str, int len);
+small_string small_string_copy(small_string *s);
+void small_string_free(small_string *s);
+
+bool small_string_is_inline(small_string *s);
+int small_string_length(small_string *s);
+int small_string_capacity(small_string *s);
+char *small_string_cstring(small_string *s);
+string small_string_to_string(small_string *s);
+
+void small_string_reserve(small_string *s, int length);
+void small_string_append(small_string *s1, small_string *s2);
+void small_string_append_length(small_string *s1, const char *s2, int length);
+void small_string_append_cstring(small_string *s, const char *str);
+void small_string_append_format(small_string *s, const char *format, ...);
+
+void small_string_slice(small_string *s, int start, int end);
+bool small_string_equals(small_string *s1, small_string *s2);
+uint64_t small_string_hash(small_string *s);
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "all.h"
+#include "ast.h"
+#include "string.h"
+#include "uthash.h"
+
+#include <llvm-c/Core.h>
+
+typedef enum {
+    IntType,
+    FloatType,
+    BoolType,
+    ArrayType,
+} TypeKind;
+
+// Type is the canonical descriptor of a type, every distinct type is created
+// once per TypeTable so types can be compared by pointer
+typedef struct _Type Type;
+
+// ArrayTypeKey identifies an array type by its element type and length
+typedef struct {
+    Type *element;
+    int length;
+} ArrayTypeKey;
+
+struct _Type {
+    TypeKind kind;
+    int bits;           // width of int, float and bool types
+    bool untyped;       // type of a literal whose width is decided by where it is used
+    char *name;         // name of named types, NULL for arrays
+    ArrayTypeKey array; // element and length of array types
+    LLVMTypeRef llvm;
+    UT_hash_handle hh;
+};
+
+// TypeExp maps a type expression node to its resolved type
+typedef struct {
+    Exp *exp;
+    Type *type;
+    UT_hash_handle hh;
+} TypeExp;
+
+// TypeTable resolves type expressions to types, memoizing by type name, array
+// shape and expression node so each type expression is only resolved once
+typedef struct {
+    Type *named;    // keyed by name
+    Type *arrays;   // keyed by ArrayTypeKey
+    TypeExp *exps;  // keyed by expression node
+
+    Type *boolean;
+    Type *untypedInt;   // integer literals, int when nothing narrows them
+    Type *untypedFloat; // float literals, float when nothing narrows them
+} TypeTable;
+
+TypeTable *NewTypeTable();
+Type *LookupType(TypeTable *table, Exp *e);
+Type *ResolveType(TypeTable *table, Exp *e);
+Type *LookupNamedType(TypeTable *table, char *name);
+Type *InternArrayType(TypeTable *table, Type *element, int length);
+int TypeTableCount(TypeTable *table);
+bool IsScalarType(Type *type);
+Type *DefaultType(TypeTable *table, Type *type);
+Type *UnifyTypes(TypeTable *table, Type *a, Type *b);
+Type *ShiftType(TypeTable *table, Type *left, Type *right);
+bool IsConvertible(Type *from, Type *to);
+string AppendTypeName(string out, Type *type);
+void DestroyTypeTable(TypeTable *table);
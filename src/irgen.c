@@ -1,96 +1,180 @@
 #include "includes/irgen.h"
 
+#include <math.h>
+#include <llvm-c/DebugInfo.h>
+
 Irgen *NewIrgen() {
 	Irgen *irgen = malloc(sizeof(Irgen));
     irgen->module = LLVMModuleCreateWithName("module");
+    irgen->reuse_values = false;
+    irgen->values = NULL;
+    irgen->generation = 0;
+    irgen->types = NewTypeTable();
+    irgen->returnType = NULL;
+    irgen->allocaBuilder = LLVMCreateBuilder();
+    irgen->allocaPoint = NULL;
+    irgen->direct_ssa = false;
+    irgen->defs = NULL;
+    irgen->blocks = NULL;
+    irgen->removed = NULL;
+    irgen->breakBlock = NULL;
+    irgen->continueBlock = NULL;
 
     return irgen;
 }
 
-LLVMTypeRef CompileType(Exp *e) {
-    switch(e->type) {
-        case identExp:
-            if (strcmp(e->ident.name, "int") == 0) return LLVMInt64Type();
-            if (strcmp(e->ident.name, "i64") == 0) return LLVMInt64Type();
-            if (strcmp(e->ident.name, "i32") == 0) return LLVMInt32Type();
-            if (strcmp(e->ident.name, "i16") == 0) return LLVMInt16Type();
-            if (strcmp(e->ident.name, "i8") == 0) return LLVMInt8Type();
-
-            if (strcmp(e->ident.name, "float") == 0) return LLVMFloatType();
-            if (strcmp(e->ident.name, "f32") == 0) return LLVMFloatType();
-            if (strcmp(e->ident.name, "f64") == 0) return LLVMDoubleType();
-        case arrayTypeExp: {
-            LLVMTypeRef elementType = CompileType(e->arrayType.type);
-            int length = atoi(e->arrayType.length->literal.value);
-            return LLVMArrayType(elementType, length);
-        }
-        default:
-            ASSERT(false, "Expected a type");
-    }
+// CompileType returns the llvm type of the type expression e, resolved through
+// the modules type table
+LLVMTypeRef CompileType(Irgen *irgen, Exp *e) {
+    return ResolveType(irgen->types, e)->llvm;
 }
 
-LLVMValueRef CompileFunction(Irgen *irgen, Dcl *d) {
+// AddParamAttribute adds the enum attribute name to the parameter at index
+void AddParamAttribute(LLVMValueRef function, int index, const char *name) {
+    unsigned kind = LLVMGetEnumAttributeKindForName(name, strlen(name));
+    LLVMAttributeRef attribute = LLVMCreateEnumAttribute(LLVMGetGlobalContext(), kind, 0);
+    LLVMAddAttributeAtIndex(function, index + 1, attribute);
+}
+
+// ReturnsArray returns true if the function d returns an array, which it writes to
+// storage the caller passes as its first parameter
+bool ReturnsArray(Irgen *irgen, Dcl *d) {
+    return ResolveType(irgen->types, d->function.returnType)->kind == ArrayType;
+}
+
+// DeclareFunction adds the prototype of d to the module the first time it is needed,
+// so calls can be compiled before the body of the function they call. Arrays are
+// passed by reference, a callee copies an array argument before writing to it so
+// the pointer is readonly and cant alias the callers other arrays.
+LLVMValueRef DeclareFunction(Irgen *irgen, Dcl *d) {
     ASSERT(d->type == functionDcl, "Expected function declaration");
-    
+    if (d->llvmValue != NULL) return d->llvmValue;
+
+    // an array result is returned through an sret pointer
+    Type *returnType = ResolveType(irgen->types, d->function.returnType);
+    int sret = returnType->kind == ArrayType;
+
     // compile argument types
     int argCount = d->function.argCount;
-    LLVMTypeRef *argTypes = malloc(argCount * sizeof(LLVMTypeRef));
+    LLVMTypeRef *argTypes = alloca((argCount + sret) * sizeof(LLVMTypeRef));
+    if (sret) argTypes[0] = LLVMPointerType(returnType->llvm, 0);
     for (int i = 0; i < argCount; i++) {
-        argTypes[i] = CompileType(d->function.args[i].argument.type);
+        Type *argType = ResolveType(irgen->types, d->function.args[i].argument.type);
+        argTypes[i + sret] = argType->kind == ArrayType ? LLVMPointerType(argType->llvm, 0) : argType->llvm;
     }
 
-    // compile return type
-    LLVMTypeRef returnType = CompileType(d->function.returnType);
-
     // make function type
-    LLVMTypeRef functionType = LLVMFunctionType(returnType, argTypes, argCount, 0); 
+    LLVMTypeRef functionType = LLVMFunctionType(
+        sret ? LLVMVoidType() : returnType->llvm, argTypes, argCount + sret, 0);
 
-    // add function to module
-    irgen->function = LLVMAddFunction(
+    // add function to module and node
+    d->llvmValue = LLVMAddFunction(
         irgen->module, 
         d->function.name,
         functionType);
 
-    // add function to node
-    d->llvmValue = irgen->function;
+    if (sret) {
+        unsigned kind = LLVMGetEnumAttributeKindForName("sret", 4);
+        LLVMAddAttributeAtIndex(d->llvmValue, 1,
+            LLVMCreateTypeAttribute(LLVMGetGlobalContext(), kind, returnType->llvm));
+        AddParamAttribute(d->llvmValue, 0, "noalias");
+        AddParamAttribute(d->llvmValue, 0, "nocapture");
+    }
+    for (int i = 0; i < argCount; i++) {
+        if (LLVMGetTypeKind(argTypes[i + sret]) != LLVMPointerTypeKind) continue;
+        AddParamAttribute(d->llvmValue, i + sret, "readonly");
+        AddParamAttribute(d->llvmValue, i + sret, "noalias");
+        AddParamAttribute(d->llvmValue, i + sret, "nocapture");
+    }
+    return d->llvmValue;
+}
+
+LLVMValueRef CompileFunction(Irgen *irgen, Dcl *d) {
+    ASSERT(d->type == functionDcl, "Expected function declaration");
+    
+    irgen->function = DeclareFunction(irgen, d);
+    irgen->returnType = ResolveType(irgen->types, d->function.returnType);
+    InvalidateValues(irgen);
+    int argCount = d->function.argCount;
 
     // create entry block and builder
     LLVMBasicBlockRef entry = LLVMAppendBasicBlock(irgen->function, "entry");
     irgen->block = entry;
     irgen->builder = LLVMCreateBuilder();
     LLVMPositionBuilderAtEnd(irgen->builder, entry);
+    irgen->allocaPoint = LLVMBuildAlloca(irgen->builder, LLVMInt1Type(), "allocapt");
+    SealBlock(irgen, entry);
 
-    // allocate arguments in entry block
+    // allocate arguments in entry block, after the sret pointer if there is one
+    int sret = ReturnsArray(irgen, d);
     for (int i = 0; i < argCount; i++) {
         // get argument node
         Dcl *argNode = d->function.args + i;
         char *argName = argNode->argument.name;
+        LLVMValueRef argValue = LLVMGetParam(irgen->function, i + sret);
+        Type *argType = ResolveType(irgen->types, argNode->argument.type);
+
+        // arrays are used through the callers pointer unless they are written
+        if (argType->kind == ArrayType) {
+            LLVMSetValueName(argValue, argName);
+            if (argNode->written) {
+                argNode->llvmValue = BuildEntryAlloca(irgen, argType->llvm, argName);
+                BuildArrayCopy(irgen, argNode->llvmValue, argValue, argType->llvm);
+            } else {
+                argNode->llvmValue = argValue;
+            }
+            continue;
+        }
+
+        // scalar arguments are used directly in direct ssa mode
+        if (irgen->direct_ssa) {
+            LLVMSetValueName(argValue, argName);
+            WriteVariable(irgen, argNode, entry, argValue);
+            argNode->llvmValue = NULL;
+            continue;
+        }
 
         // allocate space for argument
-        LLVMValueRef argAlloc = LLVMBuildAlloca(
-            irgen->builder, 
-            argTypes[i], 
+        LLVMValueRef argAlloc = BuildEntryAlloca(
+            irgen, 
+            CompileType(irgen, argNode->argument.type), 
             argName);
         
         // store alloc in node
         argNode->llvmValue = argAlloc;
 
         // store argument in allocated space
-        LLVMValueRef argValue = LLVMGetParam(irgen->function, i);
         LLVMBuildStore(irgen->builder, argValue, argAlloc);
     }
 
     CompileBlock(irgen, d->function.body);
+    FinishSSA(irgen);
 
     // remove last block if empty
     if (LLVMGetFirstInstruction(irgen->block) == NULL) {
         LLVMDeleteBasicBlock(irgen->block);
     }
 
+    LLVMInstructionEraseFromParent(irgen->allocaPoint);
+    irgen->allocaPoint = NULL;
     irgen->block = NULL;
     return irgen->function;
 }
 
+// BuildArrayCopy copies the array of type at src to dest
+void BuildArrayCopy(Irgen *irgen, LLVMValueRef dest, LLVMValueRef src, LLVMTypeRef type) {
+    LLVMBuildMemCpy(irgen->builder, dest, 0, src, 0, LLVMSizeOf(type));
+    InvalidateValues(irgen);
+}
+
+// BuildEntryAlloca allocates a local in the entry block of the function being
+// compiled, the caller stores its value at the declaration site
+LLVMValueRef BuildEntryAlloca(Irgen *irgen, LLVMTypeRef type, char *name) {
+    ASSERT(irgen->allocaPoint != NULL, "Alloca outside of a function");
+    LLVMPositionBuilderBefore(irgen->allocaBuilder, irgen->allocaPoint);
+    return LLVMBuildAlloca(irgen->allocaBuilder, type, name);
+}
+
 // Sets the current block to the given basic block.
 void SetBlock(Irgen *irgen, LLVMBasicBlockRef block) {
     irgen->block = block;
@@ -101,8 +185,9 @@ void SetBlock(Irgen *irgen, LLVMBasicBlockRef block) {
 void CompileBlock(Irgen *irgen, Smt *s) {
     ASSERT(s->type == blockSmt, "Expected block statment");
     
-    // Compile all statements in block
+    // Compile all statements in block, statements after a return or branch are unreachable
     for (int i = 0; i < s->block.count; i++) {
+        if (LLVMGetBasicBlockTerminator(irgen->block) != NULL) break;
         CompileSmt(irgen, &s->block.smts[i]);
     }
 }
@@ -127,13 +212,24 @@ LLVMBasicBlockRef CompileBlockAt(Irgen *irgen, Smt *s, LLVMBasicBlockRef block)
 void CompileReturn(Irgen *irgen, Smt *s) {
     ASSERT(s->type == returnSmt, "Expected a return statement");
 
-    LLVMTypeRef functionType = LLVMTypeOf(irgen->function);
-    LLVMTypeRef returnType = LLVMGetReturnType(LLVMGetReturnType(functionType));
+    // arrays are copied to the callers storage
+    if (irgen->returnType->kind == ArrayType) {
+        LLVMValueRef result = CompileExpAs(irgen, s->ret.result, irgen->returnType);
+        BuildArrayCopy(irgen, LLVMGetParam(irgen->function, 0), result, irgen->returnType->llvm);
+        LLVMBuildRetVoid(irgen->builder);
+        return;
+    }
 
     // build return instruction
     LLVMBuildRet(
         irgen->builder, 
-        Cast(irgen, CompileExp(irgen, s->ret.result), returnType));
+        CompileExpAs(irgen, s->ret.result, irgen->returnType));
+}
+
+// IsRegisterVariable returns true if the variable or argument d is kept in registers,
+// which is every scalar in direct ssa mode
+bool IsRegisterVariable(Irgen *irgen, Dcl *d) {
+    return irgen->direct_ssa && d->type != functionDcl && d->llvmValue == NULL;
 }
 
 // Gets the allocation for an expression
@@ -143,6 +239,8 @@ LLVMValueRef GetAlloc(Irgen *irgen, Exp *e) {
             ASSERT(e->ident.obj != NULL, "Identifier doesnt have object");
             
             Dcl *dcl = e->ident.obj->node;
+            if (dcl->type == functionDcl) return DeclareFunction(irgen, dcl);
+            ASSERT(!IsRegisterVariable(irgen, dcl), "Register variables dont have an alloc");
             return dcl->llvmValue;
         }
         case indexExp: {
@@ -164,9 +262,22 @@ LLVMValueRef GetAlloc(Irgen *irgen, Exp *e) {
 void CompileAssignment(Irgen *irgen, Smt *s) {
     ASSERT(s->type == assignmentSmt, "Expected an assignment statement");
 
-    LLVMValueRef alloc = GetAlloc(irgen, s->assignment.left);
-    LLVMValueRef exp = CompileExp(irgen, s->assignment.right);
+    Exp *left = s->assignment.left;
+    if (left->type == identExp && IsRegisterVariable(irgen, left->ident.obj->node)) {
+        LLVMValueRef exp = CompileExpAs(irgen, s->assignment.right, left->resolvedType);
+        WriteVariable(irgen, left->ident.obj->node, irgen->block, exp);
+        InvalidateValues(irgen);
+        return;
+    }
+
+    LLVMValueRef alloc = GetAlloc(irgen, left);
+    LLVMValueRef exp = CompileExpAs(irgen, s->assignment.right, left->resolvedType);
+    if (left->resolvedType->kind == ArrayType) {
+        BuildArrayCopy(irgen, alloc, exp, left->resolvedType->llvm);
+        return;
+    }
     LLVMBuildStore(irgen->builder, exp, alloc);
+    InvalidateValues(irgen);
 }
 
 void CompileIfBranch(Irgen *irgen, Smt *s, LLVMBasicBlockRef block, LLVMBasicBlockRef endBlock) {
@@ -206,6 +317,13 @@ void CompileIfBranch(Irgen *irgen, Smt *s, LLVMBasicBlockRef block, LLVMBasicBlo
         falseBlock = endBlock;
     }
 
+    // Add the conditional branch, the parent is the only predecessor of the if
+    // and else blocks
+    LLVMValueRef condition = CompileExp(irgen, cond);
+    LLVMBuildCondBr(irgen->builder, condition, block, falseBlock);
+    SealBlock(irgen, block);
+    if (falseBlock != endBlock) SealBlock(irgen, falseBlock);
+
     // compile if block
     LLVMBasicBlockRef outBlock = CompileBlockAt(irgen, s->ifs.body, block);
     if (LLVMGetBasicBlockTerminator(outBlock) == NULL) {
@@ -214,10 +332,6 @@ void CompileIfBranch(Irgen *irgen, Smt *s, LLVMBasicBlockRef block, LLVMBasicBlo
         LLVMBuildBr(irgen->builder, endBlock);
         SetBlock(irgen, parent);
     }
-    
-    // Add the conditional branch
-    LLVMValueRef condition = CompileExp(irgen, cond);
-    LLVMBuildCondBr(irgen->builder, condition, block, falseBlock);
 
     // if their is a chaining elseif/else set its parent to the falseBlock
     SetBlock(irgen, falseBlock);
@@ -232,31 +346,125 @@ void CompileIfBranch(Irgen *irgen, Smt *s, LLVMBasicBlockRef block, LLVMBasicBlo
 void CompileIf(Irgen *irgen, Smt *s) {
     LLVMBasicBlockRef endBlock = LLVMAppendBasicBlock(irgen->function, "endBlock");
     CompileIfBranch(irgen, s, NULL, endBlock);
+    SealBlock(irgen, endBlock);
+}
+
+// LoopID creates the self referencing llvm.loop node that identifies a loop, the
+// unroller and vectorizer record what they did to the loop on it
+LLVMValueRef LoopID() {
+    LLVMContextRef context = LLVMGetGlobalContext();
+    LLVMMetadataRef placeholder = LLVMTemporaryMDNode(context, NULL, 0);
+    LLVMMetadataRef id = LLVMMDNodeInContext2(context, &placeholder, 1);
+    LLVMMetadataReplaceAllUsesWith(placeholder, id);
+    return LLVMMetadataAsValue(context, id);
 }
 
+// CompileFor lowers a for loop to the canonical loop shape, the current block is
+// the preheader, the header holds the only copy of the condition, the latch holds
+// the increment and is the only block branching back to the header, and the exit
+// is only reached from the header
 void CompileFor(Irgen *irgen, Smt *s) {
     ASSERT(s->type == forSmt, "Expected for statement");
 
     // Compile loop varible
     CompileDcl(irgen, s->fors.index);
 
-    // compile for body
-    LLVMBasicBlockRef block = LLVMAppendBasicBlock(irgen->function, "for");
-    LLVMBasicBlockRef outBlock = CompileBlockAt(irgen, s->fors.body, block);
+    LLVMBasicBlockRef header = LLVMAppendBasicBlock(irgen->function, "for");
+    LLVMBasicBlockRef body = LLVMAppendBasicBlock(irgen->function, "forbody");
+    LLVMBasicBlockRef latch = LLVMAppendBasicBlock(irgen->function, "forinc");
+    LLVMBasicBlockRef exit = LLVMAppendBasicBlock(irgen->function, "endfor");
+    LLVMBuildBr(irgen->builder, header);
+
+    // the header is unsealed until the back edge from the latch is built
+    SetBlock(irgen, header);
+    LLVMValueRef cond = CompileExp(irgen, s->fors.cond);
+    LLVMBuildCondBr(irgen->builder, cond, body, exit);
+    SealBlock(irgen, body);
+
+    // compile for body, blocks nested in it come before the latch and exit. break
+    // branches to the exit and continue to the latch
+    LLVMBasicBlockRef outerBreak = irgen->breakBlock;
+    LLVMBasicBlockRef outerContinue = irgen->continueBlock;
+    irgen->breakBlock = exit;
+    irgen->continueBlock = latch;
+    LLVMBasicBlockRef outBlock = CompileBlockAt(irgen, s->fors.body, body);
+    irgen->breakBlock = outerBreak;
+    irgen->continueBlock = outerContinue;
+    LLVMMoveBasicBlockAfter(latch, LLVMGetLastBasicBlock(irgen->function));
+    LLVMMoveBasicBlockAfter(exit, latch);
+    if (LLVMGetBasicBlockTerminator(outBlock) == NULL) {
+        SetBlock(irgen, outBlock);
+        LLVMBuildBr(irgen->builder, latch);
+    }
+
+    // a body that always returns never loops
+    if (LLVMGetFirstUse(LLVMBasicBlockAsValue(latch)) == NULL) {
+        LLVMDeleteBasicBlock(latch);
+    } else {
+        SetBlock(irgen, latch);
+        SealBlock(irgen, latch);
+        CompileSmt(irgen, s->fors.inc);
+        LLVMValueRef backEdge = LLVMBuildBr(irgen->builder, header);
+        LLVMSetMetadata(backEdge, LLVMGetMDKindID("llvm.loop", 9), LoopID());
+    }
+    SealBlock(irgen, header);
+    SealBlock(irgen, exit);
+
+    // continue from the exit
+    SetBlock(irgen, exit);
+}
+
+// CompileSwitch lowers a switch to a single switch instruction so the backend
+// can dispatch through a jump table. Each clause gets a block, the tag is only
+// compiled once and clauses without fallthrough branch to the end of the switch
+void CompileSwitch(Irgen *irgen, Smt *s) {
+    ASSERT(s->type == switchSmt, "Expected switch statement");
+
+    Type *tagType = DefaultType(irgen->types, s->switchs.tag->resolvedType);
+    LLVMValueRef tag = CompileExpAs(irgen, s->switchs.tag, tagType);
+
+    int clauseCount = s->switchs.clauseCount;
+    LLVMBasicBlockRef *blocks = malloc(sizeof(LLVMBasicBlockRef) * clauseCount);
+    int caseCount = 0;
+    for (int i = 0; i < clauseCount; i++) {
+        blocks[i] = LLVMAppendBasicBlock(irgen->function, "case");
+        caseCount += s->switchs.clauses[i].cases.expCount;
+    }
+    LLVMBasicBlockRef endBlock = LLVMAppendBasicBlock(irgen->function, "endswitch");
+
+    LLVMBasicBlockRef defaultBlock = endBlock;
+    for (int i = 0; i < clauseCount; i++) {
+        if (s->switchs.clauses[i].cases.expCount == 0) defaultBlock = blocks[i];
+    }
 
-    // branch into for loop
-    LLVMValueRef outerCond = CompileExp(irgen, s->fors.cond);
-    LLVMBasicBlockRef continueBlock = LLVMAppendBasicBlock(irgen->function, "endfor");
-    LLVMBuildCondBr(irgen->builder, outerCond, block, continueBlock);
+    // the checker has made sure every value fits the tag and is listed once
+    LLVMValueRef inst = LLVMBuildSwitch(irgen->builder, tag, defaultBlock, caseCount);
+    for (int i = 0; i < clauseCount; i++) {
+        Smt *clause = s->switchs.clauses + i;
+        for (int j = 0; j < clause->cases.expCount; j++) {
+            LLVMAddCase(inst, CompileExpAs(irgen, clause->cases.exps + j, tagType), blocks[i]);
+        }
+    }
 
-    // branch to loop or exit
-    SetBlock(irgen, outBlock);
-    CompileSmt(irgen, s->fors.inc);
-    LLVMValueRef innerCond = CompileExp(irgen, s->fors.cond);
-    LLVMBuildCondBr(irgen->builder, innerCond, block, continueBlock);
+    // a clause is sealed once the clause before it, which can fall into it, is built
+    LLVMBasicBlockRef outerBreak = irgen->breakBlock;
+    irgen->breakBlock = endBlock;
+    for (int i = 0; i < clauseCount; i++) {
+        Smt *clause = s->switchs.clauses + i;
+        SealBlock(irgen, blocks[i]);
+        LLVMBasicBlockRef outBlock = CompileBlockAt(irgen, clause->cases.body, blocks[i]);
+        if (LLVMGetBasicBlockTerminator(outBlock) == NULL) {
+            SetBlock(irgen, outBlock);
+            LLVMBuildBr(irgen->builder, clause->cases.fallthrough ? blocks[i + 1] : endBlock);
+        }
+    }
+    free(blocks);
+    irgen->breakBlock = outerBreak;
 
-    // continue from continueBlock
-    SetBlock(irgen, continueBlock);
+    // continue from the end of the switch
+    LLVMMoveBasicBlockAfter(endBlock, LLVMGetLastBasicBlock(irgen->function));
+    SealBlock(irgen, endBlock);
+    SetBlock(irgen, endBlock);
 }
 
 void CompileSmt(Irgen *irgen, Smt *s) {
@@ -284,6 +492,14 @@ void CompileSmt(Irgen *irgen, Smt *s) {
         case forSmt:
             CompileFor(irgen, s);
             break;
+
+        case switchSmt:
+            CompileSwitch(irgen, s);
+            break;
+
+        case branchSmt:
+            LLVMBuildBr(irgen->builder, s->branch.token.type == BREAK ? irgen->breakBlock : irgen->continueBlock);
+            break;
         
         default:
             ASSERT(false, "TODO");
@@ -296,30 +512,44 @@ void CompileVarible(Irgen *irgen, Dcl *d) {
     // get argument node
     char *varName = d->varible.name;
 
-    // compile expression
-    LLVMValueRef exp = CompileExp(irgen, d->varible.value);
-
-    // get the type of the varible declaration
-    LLVMTypeRef varType;
+    // get the type of the varible declaration, untyped values take their default type
+    Type *varType;
     if (d->varible.type != NULL) {
-        varType = CompileType(d->varible.type);
-        exp = Cast(irgen, exp, varType);
+        varType = ResolveType(irgen->types, d->varible.type);
     } else {
-        varType = LLVMTypeOf(exp);
+        varType = DefaultType(irgen->types, d->varible.value->resolvedType);
     }
 
-    LLVMValueRef varAlloc;
+    // compile expression, an array literal is only copied if the varible is written
+    LLVMValueRef exp;
     if (d->varible.value->type == arrayExp) {
+        exp = CompileArrayLiteral(irgen, d->varible.value, d->written);
+    } else {
+        exp = CompileExpAs(irgen, d->varible.value, varType);
+    }
+
+    LLVMValueRef varAlloc;
+    if (irgen->direct_ssa && varType->kind != ArrayType) {
+        // kept in a register
+        WriteVariable(irgen, d, irgen->block, exp);
+        InvalidateValues(irgen);
+        varAlloc = NULL;
+    } else if (varType->kind == ArrayType && (d->varible.value->type == arrayExp || d->varible.value->type == callExp)) {
+        // literals and call results are already in storage of their own
         varAlloc = exp;
+    } else if (varType->kind == ArrayType) {
+        varAlloc = BuildEntryAlloca(irgen, varType->llvm, varName);
+        BuildArrayCopy(irgen, varAlloc, exp, varType->llvm);
     } else {
         // allocate space for varible
-        varAlloc = LLVMBuildAlloca(
-            irgen->builder, 
-            varType, 
+        varAlloc = BuildEntryAlloca(
+            irgen, 
+            varType->llvm, 
             varName);
             
         // store argument in allocated space
         LLVMBuildStore(irgen->builder, exp, varAlloc);
+        InvalidateValues(irgen);
     }
         
     // store alloc in node
@@ -343,11 +573,18 @@ LLVMValueRef Cast(Irgen *irgen, LLVMValueRef value, LLVMTypeRef type) {
 
     if(LLVMTypeOf(value) == type) return value;
 
+    // bools convert to 0 or 1
+    if (valueType == LLVMInt1Type() && LLVMGetTypeKind(type) == LLVMIntegerTypeKind) {
+        return LLVMBuildZExt(irgen->builder, value, type, "tmp");
+    }
+    if (valueType == LLVMInt1Type()) {
+        return LLVMBuildUIToFP(irgen->builder, value, type, "tmp");
+    }
+
     // create name base on value name + "_cast"
     char *valueName = (char *)LLVMGetValueName(value);
-    char castName[(strlen(valueName) + 5) * sizeof(char)];
-    strcpy(castName, valueName);
-    strcpy(castName, "_cast");
+    char castName[strlen(valueName) + sizeof("_cast")];
+    snprintf(castName, sizeof(castName), "%s_cast", valueName);
 
     switch (LLVMGetTypeKind(valueType)) {
         // float type    
@@ -380,63 +617,197 @@ LLVMValueRef Cast(Irgen *irgen, LLVMValueRef value, LLVMTypeRef type) {
     }
 }
 
-LLVMValueRef CompileLiteralExp(Irgen *irgen, Exp *e) {
+// CompileLiteralAs builds the literal e as a constant of type
+LLVMValueRef CompileLiteralAs(Irgen *irgen, Exp *e, LLVMTypeRef type) {
     ASSERT(e->type == literalExp, "Expected literal expression");
-    
+
+    LLVMTypeKind kind = LLVMGetTypeKind(type);
+    bool isFloat = kind == LLVMFloatTypeKind || kind == LLVMDoubleTypeKind;
+
+    int radix;
     switch (e->literal.type) {
         case INT:
-            return LLVMConstIntOfString(LLVMInt64Type(), e->literal.value, 10);
-        case FLOAT:
-            return LLVMConstRealOfString(LLVMFloatType(), e->literal.value);
+            radix = 10;
+            break;
         case HEX:
-            return LLVMConstIntOfString(LLVMInt64Type(), e->literal.value, 16);
+            radix = 16;
+            break;
         case OCTAL:
-            return LLVMConstIntOfString(LLVMInt64Type(), e->literal.value, 8);
+            radix = 8;
+            break;
+        case FLOAT:
+            if (isFloat) return LLVMConstRealOfString(type, e->literal.value);
+            return LLVMConstFPToSI(LLVMConstRealOfString(LLVMDoubleType(), e->literal.value), type);
         case STRING:
             ASSERT(false, "Strings not implemented yet");
         default:
             ASSERT(false, "Unexpected literal type");
     }
+
+    if (isFloat) return LLVMConstSIToFP(LLVMConstIntOfString(LLVMInt64Type(), e->literal.value, radix), type);
+    return LLVMConstIntOfString(type, e->literal.value, radix);
 }
 
-LLVMValueRef CompileBinaryExp(Irgen *irgen, Exp *e) {
-    ASSERT(e->type == binaryExp, "Expected binary expression");
+// CompileLiteralExp builds the literal e at its default type
+LLVMValueRef CompileLiteralExp(Irgen *irgen, Exp *e) {
+    ASSERT(e->type == literalExp, "Expected literal expression");
+    
+    LLVMTypeRef type = e->literal.type == FLOAT ? LLVMFloatType() : LLVMInt64Type();
+    return CompileLiteralAs(irgen, e, type);
+}
 
-    LLVMValueRef left = CompileExp(irgen, e->binary.left);
-    LLVMValueRef right = CompileExp(irgen, e->binary.right);
+// IsConstantInt returns true if value is the integer constant n
+bool IsConstantInt(LLVMValueRef value, long long n) {
+    return LLVMIsAConstantInt(value) != NULL && LLVMConstIntGetSExtValue(value) == n;
+}
 
-    LLVMTypeRef leftType = LLVMTypeOf(left);
-    LLVMTypeRef rightType = LLVMTypeOf(right);
-    LLVMTypeRef nodeType;    
+// IsConstantFloat returns true if value is the float constant n, +0.0 and -0.0
+// are told apart
+bool IsConstantFloat(LLVMValueRef value, double n) {
+    if (LLVMIsAConstantFP(value) == NULL) return false;
+    LLVMBool losesInfo;
+    double d = LLVMConstRealGetDouble(value, &losesInfo);
+    return d == n && signbit(d) == signbit(n);
+}
 
-    // Check for unequal types
-    if (leftType != rightType) {
-        LLVMTypeKind leftKind = LLVMGetTypeKind(leftType);
-        LLVMTypeKind rightKind = LLVMGetTypeKind(rightType);
-        
-        if(leftKind == LLVMIntegerTypeKind && rightKind == LLVMIntegerTypeKind) {
-            nodeType = LLVMInt64Type();
-            left = Cast(irgen, left, nodeType);
-            right = Cast(irgen, right, nodeType);
-        } else {
-            // one or more sides are float so premote both sides to float
-            nodeType = LLVMDoubleType();
-            left = Cast(irgen, left, nodeType);
-            right = Cast(irgen, right, nodeType);
+// SimplifyBinary folds the identities of op where one operand is a constant,
+// returns NULL if there isnt one. Operands are already compiled so any side
+// effects are kept. Floats only fold identities that hold for -0.0, infinities
+// and nans (x - 0.0, x * 1.0, x / 1.0), so x + 0.0 and x * 0.0 are left alone.
+LLVMValueRef SimplifyBinary(TokenType op, LLVMValueRef left, LLVMValueRef right, bool isFloat) {
+    if (isFloat) {
+        switch (op) {
+            case SUB:
+                if (IsConstantFloat(right, 0.0)) return left;
+                return NULL;
+            case MUL:
+                if (IsConstantFloat(right, 1.0)) return left;
+                if (IsConstantFloat(left, 1.0)) return right;
+                return NULL;
+            case QUO:
+                if (IsConstantFloat(right, 1.0)) return left;
+                return NULL;
+            default:
+                return NULL;
         }
+    }
+
+    switch (op) {
+        case ADD:
+            if (IsConstantInt(right, 0)) return left;
+            if (IsConstantInt(left, 0)) return right;
+            return NULL;
+        case SUB:
+            if (IsConstantInt(right, 0)) return left;
+            return NULL;
+        case MUL:
+            if (IsConstantInt(right, 1) || IsConstantInt(left, 0)) return left;
+            if (IsConstantInt(left, 1) || IsConstantInt(right, 0)) return right;
+            return NULL;
+        case QUO:
+            if (IsConstantInt(right, 1)) return left;
+            return NULL;
+        case REM:
+            if (IsConstantInt(right, 1)) return LLVMConstNull(LLVMTypeOf(left));
+            return NULL;
+        case OR:
+        case XOR:
+            if (IsConstantInt(right, 0)) return left;
+            if (IsConstantInt(left, 0)) return right;
+            return NULL;
+        case AND:
+            if (IsConstantInt(right, 0)) return right;
+            if (IsConstantInt(left, 0)) return left;
+            return NULL;
+        case AND_NOT:
+        case SHL:
+        case SHR:
+            if (IsConstantInt(right, 0)) return left;
+            return NULL;
+        default:
+            return NULL;
+    }
+}
+
+// CanSpeculate returns true if e can be evaluated when the program wouldnt, it has
+// no side effects and cant trap. Calls may have side effects, division may be by
+// zero and an index may be out of bounds.
+bool CanSpeculate(Exp *e) {
+    switch(e->type) {
+        case literalExp:
+        case identExp:
+            return true;
+        case unaryExp:
+            return CanSpeculate(e->unary.right);
+        case binaryExp:
+            if (e->binary.op.type == QUO || e->binary.op.type == REM) return false;
+            return CanSpeculate(e->binary.left) && CanSpeculate(e->binary.right);
+        default:
+            return false;
+    }
+}
+
+// CompileLogicalExp compiles && and ||, which only evaluate their right operand if
+// the left one doesnt decide the result. A right operand that can be speculated is
+// always evaluated and the result selected, which avoids a branch.
+LLVMValueRef CompileLogicalExp(Irgen *irgen, Exp *e) {
+    Type *boolean = irgen->types->boolean;
+    bool isAnd = e->binary.op.type == LAND;
+    LLVMValueRef shortCircuit = LLVMConstInt(LLVMInt1Type(), !isAnd, false);
+    LLVMValueRef left = CompileExpAs(irgen, e->binary.left, boolean);
+
+    if (CanSpeculate(e->binary.right)) {
+        LLVMValueRef right = CompileExpAs(irgen, e->binary.right, boolean);
+        if (isAnd) return LLVMBuildSelect(irgen->builder, left, right, shortCircuit, "and");
+        return LLVMBuildSelect(irgen->builder, left, shortCircuit, right, "or");
+    }
+
+    // branch to the right operand only when it decides the result
+    LLVMBasicBlockRef leftBlock = irgen->block;
+    LLVMBasicBlockRef rightBlock = LLVMAppendBasicBlock(irgen->function, isAnd ? "and" : "or");
+    LLVMBasicBlockRef endBlock = LLVMAppendBasicBlock(irgen->function, isAnd ? "endand" : "endor");
+    if (isAnd) {
+        LLVMBuildCondBr(irgen->builder, left, rightBlock, endBlock);
     } else {
-        nodeType = leftType;
+        LLVMBuildCondBr(irgen->builder, left, endBlock, rightBlock);
     }
+    SealBlock(irgen, rightBlock);
 
-    LLVMTypeKind nodeTypeKind = LLVMGetTypeKind(nodeType);
+    SetBlock(irgen, rightBlock);
+    LLVMValueRef right = CompileExpAs(irgen, e->binary.right, boolean);
+    LLVMBasicBlockRef rightOut = irgen->block;
+    LLVMBuildBr(irgen->builder, endBlock);
+    SealBlock(irgen, endBlock);
+
+    SetBlock(irgen, endBlock);
+    LLVMValueRef phi = LLVMBuildPhi(irgen->builder, LLVMInt1Type(), isAnd ? "and" : "or");
+    LLVMValueRef values[] = { shortCircuit, right };
+    LLVMBasicBlockRef blocks[] = { leftBlock, rightOut };
+    LLVMAddIncoming(phi, values, blocks, 2);
+    return phi;
+}
+
+// CompileBinaryAs compiles the binary expression e with both operands converted to
+// operand, the type the semantic pass unified them to
+LLVMValueRef CompileBinaryAs(Irgen *irgen, Exp *e, Type *operand) {
+    ASSERT(e->type == binaryExp, "Expected binary expression");
+    if (e->binary.op.type == LAND || e->binary.op.type == LOR) return CompileLogicalExp(irgen, e);
+
+    LLVMValueRef left = CompileExpAs(irgen, e->binary.left, operand);
+    LLVMValueRef right = CompileExpAs(irgen, e->binary.right, operand);
+    LLVMTypeKind nodeTypeKind = LLVMGetTypeKind(operand->llvm);
+
+    // constant operands are evaluated by the builder, identities are folded here
+    bool isFloat = nodeTypeKind == LLVMFloatTypeKind || nodeTypeKind == LLVMDoubleTypeKind;
+    LLVMValueRef simplified = SimplifyBinary(e->binary.op.type, left, right, isFloat);
+    if (simplified != NULL) return simplified;
 
     // build name
     char *leftName = (char *)LLVMGetValueName(left);
     char *rightName = (char *)LLVMGetValueName(right);
-    char name[strlen(leftName) + 1 + strlen(rightName)];
-    strcpy(name, leftName);
-    strcpy(name, TokenName(e->binary.op.type));
-    strcpy(name, rightName);
+    char *opName = TokenName(e->binary.op.type);
+    char name[strlen(leftName) + strlen(opName) + strlen(rightName) + 1];
+    snprintf(name, sizeof(name), "%s%s%s", leftName, opName, rightName);
 
     switch (e->binary.op.type) {
         case ADD:
@@ -554,16 +925,22 @@ LLVMValueRef CompileBinaryExp(Irgen *irgen, Exp *e) {
                     ASSERT(false, "Cannot not equal non float/int type");
             }
 
-        case LAND:
-        case LOR:
+        // bitwise operators, bools are one bit ints
+        case AND:
+            return LLVMBuildAnd(irgen->builder, left, right, name);
+        case OR:
+            return LLVMBuildOr(irgen->builder, left, right, name);
         case XOR:
+            return LLVMBuildXor(irgen->builder, left, right, name);
+        case AND_NOT:
+            return LLVMBuildAnd(irgen->builder, left, LLVMBuildNot(irgen->builder, right, "not"), name);
+
+        // shifts by at least the width of the operand are undefined like in c, ints
+        // are signed so right shifts are arithmetic
         case SHL:
+            return LLVMBuildShl(irgen->builder, left, right, name);
         case SHR:
-        case AND_NOT:
-        case AND:
-        case OR:
-            ASSERT(false, "TODO");
-            break;
+            return LLVMBuildAShr(irgen->builder, left, right, name);
         default:
             ASSERT(false, "Unknown binary operator");
             break;
@@ -577,38 +954,50 @@ LLVMValueRef CompileIdentExp(Irgen *irgen, Exp *e) {
     if(strcmp(ident, "true") == 0) return LLVMConstInt(LLVMInt1Type(), 1, false);
     if(strcmp(ident, "false") == 0) return LLVMConstInt(LLVMInt1Type(), 0, false);
 
+    Dcl *dcl = e->ident.obj->node;
+    if (IsRegisterVariable(irgen, dcl)) return ReadVariable(irgen, dcl, irgen->block);
+
+    // arrays compile to their storage
     LLVMValueRef alloc = GetAlloc(irgen, e);
+    if (e->resolvedType->kind == ArrayType) return alloc;
     return LLVMBuildLoad(irgen->builder, alloc, e->ident.name);
 }
 
-LLVMValueRef CompileUnaryExp(Irgen *irgen, Exp *e) {
+LLVMValueRef CompileBinaryExp(Irgen *irgen, Exp *e) {
+    Type *left = e->binary.left->resolvedType;
+    Type *right = e->binary.right->resolvedType;
+    Type *operand;
+    if (e->binary.op.type == SHL || e->binary.op.type == SHR) {
+        operand = ShiftType(irgen->types, left, right);
+    } else {
+        operand = UnifyTypes(irgen->types, left, right);
+    }
+    return CompileBinaryAs(irgen, e, DefaultType(irgen->types, operand));
+}
+
+// CompileUnaryAs compiles the unary expression e with its operand converted to type
+LLVMValueRef CompileUnaryAs(Irgen *irgen, Exp *e, Type *type) {
     ASSERT(e->type == unaryExp, "Expected unary expression");
 
-    LLVMValueRef exp = CompileExp(irgen, e->unary.right);
+    LLVMValueRef exp = CompileExpAs(irgen, e->unary.right, type);
     switch(e->unary.op.type) {
         case ADD:
             return exp;
         case SUB: {
             // build name
             char *expName = (char *)LLVMGetValueName(exp);
-            char *name = alloca(sizeof(char) * (strlen(expName) + 1));
-            strcpy(name, "-");
-            strcpy(name, expName);
+            char name[strlen(expName) + 2];
+            snprintf(name, sizeof(name), "-%s", expName);
 
-            // insert "-1 * exp" instruction 
-            LLVMTypeRef expType = LLVMTypeOf(exp);
-            switch(LLVMGetTypeKind(expType)) {
+            // insert a neg/fneg instruction, constants are negated by the builder
+            switch(LLVMGetTypeKind(LLVMTypeOf(exp))) {
                 case LLVMFloatTypeKind:
-                case LLVMDoubleTypeKind: {
-                    LLVMValueRef minusOne = LLVMConstReal(expType, -1);
-                    return LLVMBuildFMul(irgen->builder, minusOne, exp, name);
-                }
-                case LLVMIntegerTypeKind: {
-                    LLVMValueRef minusOne = LLVMConstInt(expType, -1, true);
-                    return LLVMBuildMul(irgen->builder, minusOne, exp, name);
-                }
+                case LLVMDoubleTypeKind:
+                    return LLVMBuildFNeg(irgen->builder, exp, name);
+                case LLVMIntegerTypeKind:
+                    return LLVMBuildNeg(irgen->builder, exp, name);
                 default:
-                    ASSERT(false, "Cannot multiply non float/int type by -1");
+                    ASSERT(false, "Cannot negate non float/int type");
             } 
         }
         default:
@@ -616,45 +1005,92 @@ LLVMValueRef CompileUnaryExp(Irgen *irgen, Exp *e) {
     }
 }
 
+LLVMValueRef CompileUnaryExp(Irgen *irgen, Exp *e) {
+    return CompileUnaryAs(irgen, e, e->resolvedType);
+}
+
 LLVMValueRef CompileCallExp(Irgen *irgen, Exp *e) {
     ASSERT(e->type == callExp, "Expected call expression");
     
     LLVMValueRef function = GetAlloc(irgen, e->call.function);
+    Dcl *dcl = e->call.function->ident.obj->node;
 
-    // compile arguments
+    // an array result is written to a new local the call returns
+    int sret = ReturnsArray(irgen, dcl);
     int argCount = e->call.argCount;
-    LLVMValueRef *args = malloc(argCount * sizeof(LLVMValueRef));
+    LLVMValueRef *args = malloc((argCount + sret) * sizeof(LLVMValueRef));
+    if (sret) args[0] = BuildEntryAlloca(irgen, e->resolvedType->llvm, "tmp");
+
+    // compile arguments, arrays are passed by their address and the callee never
+    // writes through it so literals are passed without a copy
     for(int i = 0; i < argCount; i++) {
-        args[i] = CompileExp(irgen, e->call.args + i);
+        Type *argType = ResolveType(irgen->types, dcl->function.args[i].argument.type);
+        Exp *arg = e->call.args + i;
+        if (arg->type == arrayExp) {
+            args[i + sret] = CompileArrayLiteral(irgen, arg, false);
+        } else {
+            args[i + sret] = CompileExpAs(irgen, arg, argType);
+        }
     }
 
-    return LLVMBuildCall(irgen->builder, function, args, argCount, "tmp");
+    // the callee may write to memory
+    InvalidateValues(irgen);
+    LLVMValueRef call = LLVMBuildCall(irgen->builder, function, args, argCount + sret, sret ? "" : "tmp");
+    LLVMValueRef result = sret ? args[0] : call;
+    free(args);
+    return result;
 } 
 
 LLVMValueRef CompileArrayExp(Irgen *irgen, Exp *e) {
+    return CompileArrayLiteral(irgen, e, true);
+}
+
+// ConstantArrayGlobal puts the constant array value in a private global, which
+// llvm can merge with equal tables since its address is never compared
+LLVMValueRef ConstantArrayGlobal(Irgen *irgen, Type *type, LLVMValueRef *values, int valueCount) {
+    LLVMValueRef global = LLVMAddGlobal(irgen->module, type->llvm, "array");
+    LLVMSetInitializer(global, LLVMConstArray(type->array.element->llvm, values, valueCount));
+    LLVMSetGlobalConstant(global, true);
+    LLVMSetLinkage(global, LLVMPrivateLinkage);
+    LLVMSetUnnamedAddress(global, LLVMGlobalUnnamedAddr);
+    return global;
+}
+
+// CompileArrayLiteral compiles the array literal e to its storage. When every
+// element is constant the values come from a constant global, copied to the stack
+// with one memcpy if copy is set or used in place if the array is never written.
+// Otherwise each element is stored separately.
+LLVMValueRef CompileArrayLiteral(Irgen *irgen, Exp *e, bool copy) {
     assert(e->type == arrayExp);
 
+    // the element type was decided by the semantic pass
+    Type *type = e->resolvedType;
     int valueCount = e->array.valueCount;
-    bool isFloat = false;
-    LLVMValueRef *values = alloca(valueCount * sizeof(LLVMValueRef));
+    LLVMValueRef *values = malloc(valueCount * sizeof(LLVMValueRef));
+    bool constant = true;
     for (int i = 0; i < valueCount; i++) {
-        values[i] = CompileExp(irgen, e->array.values + i);
-        if (LLVMGetTypeKind(LLVMTypeOf(values[i])) == LLVMFloatTypeKind) {
-            isFloat = true;
-        }
+        values[i] = CompileExpAs(irgen, e->array.values + i, type->array.element);
+        constant = constant && LLVMIsConstant(values[i]);
     }
 
-    LLVMTypeRef castType = isFloat ? LLVMFloatType() : LLVMInt64Type();
-    LLVMTypeRef arrayType = LLVMArrayType(castType, valueCount);
+    LLVMTypeRef arrayType = type->llvm;
 
-    LLVMValueRef arrayAlloc = LLVMBuildAlloca(
-        irgen->builder, 
+    if (constant) {
+        LLVMValueRef global = ConstantArrayGlobal(irgen, type, values, valueCount);
+        free(values);
+        if (!copy) return global;
+
+        LLVMValueRef arrayAlloc = BuildEntryAlloca(irgen, arrayType, "tmp");
+        BuildArrayCopy(irgen, arrayAlloc, global, arrayType);
+        return arrayAlloc;
+    }
+
+    LLVMValueRef arrayAlloc = BuildEntryAlloca(
+        irgen, 
         arrayType,
         "tmp");
 
     for (int i = 0; i < valueCount; i++) {
-        values[i] = Cast(irgen, values[i], castType);
-        
         LLVMValueRef indices[2] = { 
             LLVMConstInt(LLVMInt64Type(), 0, false),
             LLVMConstInt(LLVMInt64Type(), i, false), 
@@ -671,6 +1107,8 @@ LLVMValueRef CompileArrayExp(Irgen *irgen, Exp *e) {
             values[i],
             indexAlloc);
     }
+    InvalidateValues(irgen);
+    free(values);
 
     return arrayAlloc;
 }
@@ -679,10 +1117,17 @@ LLVMValueRef CompileIndexExp(Irgen *irgen, Exp *e) {
     assert(e->type == indexExp);
 
     LLVMValueRef alloc = GetAlloc(irgen, e);
+    if (e->resolvedType->kind == ArrayType) return alloc;
     return LLVMBuildLoad(irgen->builder, alloc, "tmp");
 }
 
-LLVMValueRef CompileExp(Irgen *irgen, Exp *e) {
+// InvalidateValues stops previously compiled expressions being reused, called
+// whenever memory may have been written
+void InvalidateValues(Irgen *irgen) {
+    irgen->generation++;
+}
+
+LLVMValueRef CompileExpValue(Irgen *irgen, Exp *e) {
     switch(e->type) {
         case literalExp:
             return CompileLiteralExp(irgen, e);
@@ -703,4 +1148,330 @@ LLVMValueRef CompileExp(Irgen *irgen, Exp *e) {
     }
 
     return NULL;
-}
\ No newline at end of file
+}
+
+// CompileUntyped builds the untyped constant expression e directly at type, so
+// literals are never widened and then narrowed again
+LLVMValueRef CompileUntyped(Irgen *irgen, Exp *e, Type *type) {
+    switch(e->type) {
+        case literalExp:
+            return CompileLiteralAs(irgen, e, type->llvm);
+        case unaryExp:
+            return CompileUnaryAs(irgen, e, type);
+        case binaryExp:
+            return CompileBinaryAs(irgen, e, type);
+        default:
+            ASSERT(false, "Unexpected untyped expression");
+    }
+
+    return NULL;
+}
+
+// CompileExpAs compiles e as a value of type. Untyped literals are built at type,
+// typed values are converted only if their type differs.
+LLVMValueRef CompileExpAs(Irgen *irgen, Exp *e, Type *type) {
+    Type *from = e->resolvedType;
+    ASSERT(from != NULL, "Expression has not been type checked");
+
+    if (from->untyped) {
+        if (e->type == literalExp) return CompileLiteralAs(irgen, e, type->llvm);
+
+        // other untyped constants are evaluated at full width, ints with integer
+        // semantics (7 / 2 is 3 even when stored in a float), then converted
+        Type *wide = from->kind == FloatType ? LookupNamedType(irgen->types, "f64") : DefaultType(irgen->types, from);
+        return Cast(irgen, CompileUntyped(irgen, e, wide), type->llvm);
+    }
+
+    // arrays only convert to their own type (array literals compile to their storage)
+    if (from->kind == ArrayType) return CompileExp(irgen, e);
+
+    return Cast(irgen, CompileExp(irgen, e), type->llvm);
+}
+
+LLVMValueRef CompileExp(Irgen *irgen, Exp *e) {
+    // untyped constants take their default type when nothing else decides it
+    if (e->resolvedType != NULL && e->resolvedType->untyped) {
+        return CompileExpAs(irgen, e, DefaultType(irgen->types, e->resolvedType));
+    }
+
+    if (!irgen->reuse_values || e->type == literalExp || !exp_is_pure(e)) {
+        return CompileExpValue(irgen, e);
+    }
+
+    // reuse the value if the node was already compiled in this block and memory
+    // hasnt been written since
+    exp_value *cached;
+    HASH_FIND_PTR(irgen->values, &e, cached);
+    if (cached != NULL && cached->block == irgen->block && cached->generation == irgen->generation) {
+        return cached->value;
+    }
+
+    int generation = irgen->generation;
+    LLVMValueRef value = CompileExpValue(irgen, e);
+
+    if (cached == NULL) {
+        cached = malloc(sizeof(exp_value));
+        cached->exp = e;
+        HASH_ADD_PTR(irgen->values, exp, cached);
+    }
+    cached->value = value;
+    cached->block = irgen->block;
+    cached->generation = generation;
+
+    return value;
+}
+
+// VariableType gets the llvm type of the variable or argument d
+LLVMTypeRef VariableType(Irgen *irgen, Dcl *d) {
+    if (d->type == argumentDcl) return CompileType(irgen, d->argument.type);
+    if (d->varible.type != NULL) return CompileType(irgen, d->varible.type);
+    return DefaultType(irgen->types, d->varible.value->resolvedType)->llvm;
+}
+
+// FindSSABlock gets the sealing state of block, creating it if it doesnt exist
+ssa_block *FindSSABlock(Irgen *irgen, LLVMBasicBlockRef block) {
+    ssa_block *info;
+    HASH_FIND_PTR(irgen->blocks, &block, info);
+    if (info == NULL) {
+        info = malloc(sizeof(ssa_block));
+        info->block = block;
+        info->sealed = false;
+        info->incomplete = NULL;
+        HASH_ADD_PTR(irgen->blocks, block, info);
+    }
+    return info;
+}
+
+// CountPredecessors counts the branches into block
+int CountPredecessors(LLVMBasicBlockRef block) {
+    int count = 0;
+    for (LLVMUseRef use = LLVMGetFirstUse(LLVMBasicBlockAsValue(block)); use != NULL; use = LLVMGetNextUse(use)) {
+        count++;
+    }
+    return count;
+}
+
+// ResolveRemoved follows value through the trivial phis that were replaced
+LLVMValueRef ResolveRemoved(Irgen *irgen, LLVMValueRef value) {
+    while (LLVMIsAPHINode(value)) {
+        ssa_removed *removed;
+        HASH_FIND_PTR(irgen->removed, &value, removed);
+        if (removed == NULL) break;
+        value = removed->value;
+    }
+    return value;
+}
+
+// FindDef gets the definition of var in block, NULL if it isnt defined there
+ssa_def *FindDef(Irgen *irgen, Dcl *var, LLVMBasicBlockRef block) {
+    ssa_def key;
+    memset(&key, 0, sizeof(ssa_def));
+    key.key.var = var;
+    key.key.block = block;
+
+    ssa_def *def;
+    HASH_FIND(hh, irgen->defs, &key.key, sizeof(key.key), def);
+    return def;
+}
+
+// WriteVariable sets the value of var at the end of block
+void WriteVariable(Irgen *irgen, Dcl *var, LLVMBasicBlockRef block, LLVMValueRef value) {
+    ssa_def *def = FindDef(irgen, var, block);
+    if (def == NULL) {
+        def = malloc(sizeof(ssa_def));
+        memset(def, 0, sizeof(ssa_def));
+        def->key.var = var;
+        def->key.block = block;
+        HASH_ADD(hh, irgen->defs, key, sizeof(def->key), def);
+    }
+    def->value = value;
+}
+
+// BuildPhi adds an empty phi for var at the start of block
+LLVMValueRef BuildPhi(Irgen *irgen, Dcl *var, LLVMBasicBlockRef block) {
+    LLVMValueRef first = LLVMGetFirstInstruction(block);
+    if (first != NULL) {
+        LLVMPositionBuilderBefore(irgen->allocaBuilder, first);
+    } else {
+        LLVMPositionBuilderAtEnd(irgen->allocaBuilder, block);
+    }
+
+    char *name = var->type == argumentDcl ? var->argument.name : var->varible.name;
+    return LLVMBuildPhi(irgen->allocaBuilder, VariableType(irgen, var), name);
+}
+
+// ReadVariable gets the value of var at the end of block, looking through the
+// predecessors of block when it is not defined in it
+LLVMValueRef ReadVariable(Irgen *irgen, Dcl *var, LLVMBasicBlockRef block) {
+    ssa_def *def = FindDef(irgen, var, block);
+    if (def == NULL) return ReadVariableRecursive(irgen, var, block);
+
+    if (def->value == NULL) {
+        // a loop led back to a block whose predecessors are being read, it needs a phi
+        def->value = BuildPhi(irgen, var, block);
+    }
+    return ResolveRemoved(irgen, def->value);
+}
+
+// ReadVariableRecursive finds the value of var in block from its predecessors
+LLVMValueRef ReadVariableRecursive(Irgen *irgen, Dcl *var, LLVMBasicBlockRef block) {
+    ssa_block *info = FindSSABlock(irgen, block);
+    LLVMValueRef value;
+    if (!info->sealed) {
+        // more predecessors may be added so the operands are filled in when it is sealed
+        value = BuildPhi(irgen, var, block);
+        ssa_phi *incomplete = malloc(sizeof(ssa_phi));
+        incomplete->var = var;
+        incomplete->phi = value;
+        incomplete->next = info->incomplete;
+        info->incomplete = incomplete;
+    } else {
+        LLVMUseRef use = LLVMGetFirstUse(LLVMBasicBlockAsValue(block));
+        if (use == NULL) {
+            // unreachable block
+            value = LLVMGetUndef(VariableType(irgen, var));
+        } else if (LLVMGetNextUse(use) == NULL) {
+            // a single predecessor doesnt need a phi
+            value = ReadVariable(irgen, var, LLVMGetInstructionParent(LLVMGetUser(use)));
+        } else {
+            value = ReadPredecessors(irgen, var, block);
+        }
+    }
+
+    WriteVariable(irgen, var, block, value);
+    return value;
+}
+
+// ReadPredecessors merges the values of var from the predecessors of the sealed
+// block. The phi is only built if they differ or a loop leads back to block, which
+// finds the empty definition written here and builds it.
+LLVMValueRef ReadPredecessors(Irgen *irgen, Dcl *var, LLVMBasicBlockRef block) {
+    int count = CountPredecessors(block);
+    LLVMValueRef *values = malloc(count * sizeof(LLVMValueRef));
+    LLVMBasicBlockRef *preds = malloc(count * sizeof(LLVMBasicBlockRef));
+
+    WriteVariable(irgen, var, block, NULL);
+    LLVMValueRef same = NULL;
+    bool trivial = true;
+    int i = 0;
+    for (LLVMUseRef use = LLVMGetFirstUse(LLVMBasicBlockAsValue(block)); use != NULL; use = LLVMGetNextUse(use)) {
+        preds[i] = LLVMGetInstructionParent(LLVMGetUser(use));
+        values[i] = ReadVariable(irgen, var, preds[i]);
+        if (same != NULL && values[i] != same) trivial = false;
+        same = values[i];
+        i++;
+    }
+
+    LLVMValueRef phi = FindDef(irgen, var, block)->value;
+    LLVMValueRef value;
+    if (phi == NULL && trivial) {
+        value = same;
+    } else {
+        if (phi == NULL) phi = BuildPhi(irgen, var, block);
+        LLVMAddIncoming(phi, values, preds, count);
+        value = TryRemoveTrivialPhi(irgen, phi);
+    }
+
+    free(values);
+    free(preds);
+    return value;
+}
+
+// AddPhiOperands adds the value of var from every predecessor of the phis block,
+// returns the value that replaces the phi if it turns out to be trivial
+LLVMValueRef AddPhiOperands(Irgen *irgen, Dcl *var, LLVMValueRef phi) {
+    LLVMBasicBlockRef block = LLVMGetInstructionParent(phi);
+    for (LLVMUseRef use = LLVMGetFirstUse(LLVMBasicBlockAsValue(block)); use != NULL; use = LLVMGetNextUse(use)) {
+        LLVMBasicBlockRef pred = LLVMGetInstructionParent(LLVMGetUser(use));
+        LLVMValueRef value = ReadVariable(irgen, var, pred);
+        LLVMAddIncoming(phi, &value, &pred, 1);
+    }
+
+    return TryRemoveTrivialPhi(irgen, phi);
+}
+
+// TryRemoveTrivialPhi replaces phi with its only operand (other than itself) if
+// it has one, then retries the phis that used it
+LLVMValueRef TryRemoveTrivialPhi(Irgen *irgen, LLVMValueRef phi) {
+    LLVMValueRef same = NULL;
+    int count = LLVMCountIncoming(phi);
+    for (int i = 0; i < count; i++) {
+        LLVMValueRef op = LLVMGetIncomingValue(phi, i);
+        if (op == same || op == phi) continue;
+        if (same != NULL) return phi; // merges at least two values
+        same = op;
+    }
+    if (same == NULL) same = LLVMGetUndef(LLVMTypeOf(phi));
+
+    // collect the phis using phi before their operands are replaced
+    int userCount = 0;
+    for (LLVMUseRef use = LLVMGetFirstUse(phi); use != NULL; use = LLVMGetNextUse(use)) userCount++;
+    LLVMValueRef *users = malloc(userCount * sizeof(LLVMValueRef));
+    userCount = 0;
+    for (LLVMUseRef use = LLVMGetFirstUse(phi); use != NULL; use = LLVMGetNextUse(use)) {
+        LLVMValueRef user = LLVMGetUser(use);
+        // phis still being filled in are checked once they are complete
+        if (user == phi || !LLVMIsAPHINode(user)) continue;
+        if (LLVMCountIncoming(user) < CountPredecessors(LLVMGetInstructionParent(user))) continue;
+        users[userCount++] = user;
+    }
+
+    // the phi is erased after the function is compiled, until then reads of
+    // definitions that still refer to it are forwarded to same
+    LLVMReplaceAllUsesWith(phi, same);
+    ssa_removed *removed = malloc(sizeof(ssa_removed));
+    removed->phi = phi;
+    removed->value = same;
+    HASH_ADD_PTR(irgen->removed, phi, removed);
+
+    for (int i = 0; i < userCount; i++) {
+        ssa_removed *found;
+        HASH_FIND_PTR(irgen->removed, &users[i], found);
+        if (found == NULL) TryRemoveTrivialPhi(irgen, users[i]);
+    }
+    free(users);
+
+    return ResolveRemoved(irgen, same);
+}
+
+// SealBlock marks that all the predecessors of block have been built and completes
+// the phis added to it while they were unknown
+void SealBlock(Irgen *irgen, LLVMBasicBlockRef block) {
+    if (!irgen->direct_ssa) return;
+
+    ssa_block *info = FindSSABlock(irgen, block);
+    ASSERT(!info->sealed, "Block sealed twice");
+    ssa_phi *incomplete = info->incomplete;
+    while (incomplete != NULL) {
+        AddPhiOperands(irgen, incomplete->var, incomplete->phi);
+        ssa_phi *next = incomplete->next;
+        free(incomplete);
+        incomplete = next;
+    }
+    info->incomplete = NULL;
+    info->sealed = true;
+}
+
+// FinishSSA erases the removed phis and clears the variable definitions of the
+// function that was compiled
+void FinishSSA(Irgen *irgen) {
+    ssa_removed *removed, *nextRemoved;
+    HASH_ITER(hh, irgen->removed, removed, nextRemoved) {
+        LLVMInstructionEraseFromParent(removed->phi);
+        free(removed);
+    }
+    HASH_CLEAR(hh, irgen->removed);
+
+    ssa_def *def, *nextDef;
+    HASH_ITER(hh, irgen->defs, def, nextDef) {
+        free(def);
+    }
+    HASH_CLEAR(hh, irgen->defs);
+
+    ssa_block *block, *nextBlock;
+    HASH_ITER(hh, irgen->blocks, block, nextBlock) {
+        ASSERT(block->incomplete == NULL, "Block was never sealed");
+        free(block);
+    }
+    HASH_CLEAR(hh, irgen->blocks);
+}
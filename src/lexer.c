@@ -7,6 +7,10 @@ void clearWhitespace(Lexer *lexer) {
 		(*lexer->source == '\n' && !lexer->semi) ||
 		*lexer->source == '\r') {
 
+		if (*lexer->source == '\n') {
+			lexer->line++;
+			lexer->line_start = lexer->source + 1;
+		}
 		lexer->source++;
 		lexer->column++;
 	}
@@ -36,29 +40,27 @@ int asDigit(char *input) {
 	return -1; // unrecognised digit
 }
 
+// copies length characters into a new null-terminated string, allocated from
+// the lexers slab if it has one
+char *lexer_strndup(Lexer *lexer, char *str, int length) {
+	if (lexer->slab != NULL) return slab_strndup(lexer->slab, str, length);
+
+	char *copy = (char *)malloc(length + 1);
+	memcpy(copy, str, length);
+	copy[length] = '\0';
+	return copy;
+}
+
 // returns the word at the start of the string
 char *word(Lexer *lexer) {
-	// token is an ident
-	char *word = (char *)malloc(1024);
-
-	// copy all letter characters
-	char *wordPtr = word;
-	int length = 0;
+	// find the end of the word
+	char *start = lexer->source;
 	do {
-		*wordPtr++ = *lexer->source;
 		lexer->source++;
 		lexer->column++;
-		length++;
 	} while (isLetter(lexer->source) || isDigit(lexer->source));
 
-	// null-terminate
-	*wordPtr = '\0';
-	length++;
-
-	// shrink string to ident length
-	word = realloc(word, length);
-
-	return word;
+	return lexer_strndup(lexer, start, lexer->source - start);
 }
 
 // Extracts the mantiass from input into number, returning the characters written.
@@ -76,7 +78,7 @@ int extractMantissa(char **input, char **number, int base) {
 
 // extracts the number at the start of the input string, returns error code
 char *number(Lexer *lexer, TokenType *type) {
-	char *number = (char *)malloc(1024 * sizeof(char));
+	char number[1024];
 	char *numberPtr = number;
 	
 	*type = INT;
@@ -140,8 +142,7 @@ exit:
 	length++;
 	*numberPtr = '\0';
 
-	number = realloc(number, length * sizeof(char));
-	return number;
+	return lexer_strndup(lexer, number, length - 1);
 }
 
 char *escape(char **input, char quote) {
@@ -354,204 +355,242 @@ TokenType keyword(char *word) {
 }
 
 Token *Lex(char *source) {
-	Lexer lexer = {source, 1, 1, false};
-
-	Token *tokens = (Token *)malloc(0);
-
-	int i = 0;
-	while (*lexer.source) {
-		i++;
-		clearWhitespace(&lexer);
+	return LexSlab(source, NULL);
+}
 
+// LexNext lexes the next token from lexer, returning an END token once the
+// whole source has been lexed
+Token LexNext(Lexer *lexer) {
+	if (!*lexer->source) {
+		// End of file token
 		Token token;
-		token.line = lexer.line;
-		token.column = lexer.column;
+		token.line = lexer->line;
+		token.column = lexer->source - lexer->line_start + 1;
 		token.value = "";
+		token.type = END;
+		return token;
+	}
 
-		if (isLetter(lexer.source)) {
-			// token is an identifier
-			token.value = word(&lexer);
-			token.type = keyword(token.value);
-			if (token.type == IDENT || 
-				token.type == BREAK || 
-				token.type == CONTINUE || 
-				token.type == FALLTHROUGH || 
-				token.type == RETURN) {
-			
-				lexer.semi = true;
-			}
+	clearWhitespace(lexer);
+
+	// columns are measured from the start of the line since the symbol lexers
+	// move the source without updating the column
+	lexer->column = lexer->source - lexer->line_start + 1;
+
+	Token token;
+	token.line = lexer->line;
+	token.column = lexer->column;
+	token.value = "";
+
+	if (isLetter(lexer->source)) {
+		// token is an identifier
+		token.value = word(lexer);
+		token.type = keyword(token.value);
+		if (token.type == IDENT || 
+			token.type == BREAK || 
+			token.type == CONTINUE || 
+			token.type == FALLTHROUGH || 
+			token.type == RETURN) {
+		
+			lexer->semi = true;
 		}
-		else if (isDigit(lexer.source)) {
-			// token is a number
-			lexer.semi = true;
-			token.type = INT;
-			token.value = number(&lexer, &token.type);
-		} else {
-			// token is a symbol
-			switch (*lexer.source) {
-				case '\n':
-					token.type = SEMI;
-					lexer.semi = false;
-					lexer.column = 1;
-					lexer.line++;
-					next(&lexer);
-					break;
-
-				case '"':
-					lexer.semi = true;
-					token.type = STRING;
-					token.value = lex_string(&lexer.source);
-					break;
-
-				case ':':
-					token.type = switch3(&lexer.source, COLON, DEFINE, ':', DOUBLE_COLON);
-					break;
-
-				case '.':
-					token.type = PERIOD;
-					next(&lexer);
-					if (*lexer.source == '.') {
-						next(&lexer);
-						if (*lexer.source == '.') {
-							next(&lexer);
-							token.type = ELLIPSE;
-						}
-					}
-					break;
-
-				case ',':
-					token.type = COMMA;
-					next(&lexer);
-					break;
-
-				case ';':
-					token.type = SEMI;
-					next(&lexer);
-					break;
-
-				case '(':
-					token.type = LPAREN;
-					next(&lexer);
-					break;
-
-				case ')':
-					lexer.semi = true;
-					token.type = RPAREN;
-					next(&lexer);
-					break;
-
-				case '[':
-					token.type = LBRACK;
-					next(&lexer);
-					break;
-
-				case ']':
-					lexer.semi = true;
-					token.type = RBRACK;
-					next(&lexer);
-					break;
-
-				case '{':
-					lexer.semi = false;
-					token.type = LBRACE;
-					next(&lexer);
-					break;
-
-				case '}':
-					lexer.semi = true;
-					token.type = RBRACE;
-					next(&lexer);
-					break;
-
-				case '+':
-					token.type = switch3(&lexer.source, ADD, ADD_ASSIGN, '+', INC);
-					if (token.type == INC) lexer.semi = true;
-					break;
-
-				case '-':
-					if (peek(lexer.source) == '>') {
-						token.type = ARROW;
-						lexer.source += 2;
-					} else {
-						token.type = switch3(&lexer.source, SUB, SUB_ASSIGN, '-', DEC);
-						if (token.type == DEC) lexer.semi = true;
-					}
-					break;
-
-				case '*':
-					token.type = switch2(&lexer.source, MUL, MUL_ASSIGN);
-					break;
-
-				case '/':
-					token.type = switch2(&lexer.source, QUO, QUO_ASSIGN);
-					break;
-
-				case '%':
-					token.type = switch2(&lexer.source, REM, REM_ASSIGN);
-					break;
-
-				case '^':
-					token.type = switch2(&lexer.source, XOR, XOR_ASSIGN);
-					break;
-
-				case '<':
-					token.type = switch4(&lexer.source, LSS, LEQ, '<', SHL, SHL_ASSIGN);
-					break;
-
-				case '>':
-					token.type = switch4(&lexer.source, GTR, GEQ, '>', SHR, SHR_ASSIGN);
-					break;
-
-				case '=':
-					token.type = switch2(&lexer.source, ASSIGN, EQL);
-					break;
-
-				case '!':
-					token.type = switch2(&lexer.source, NOT, NEQ);
-					break;
-
-				case '&':
-					if (peek(lexer.source) == '^') {
-						next(&lexer);
-						token.type = switch2(&lexer.source, AND_NOT, AND_NOT_ASSIGN);
-					} else {
-						token.type = switch3(&lexer.source, AND, AND_ASSIGN, '&', LAND);
+	}
+	else if (isDigit(lexer->source)) {
+		// token is a number
+		lexer->semi = true;
+		token.type = INT;
+		token.value = number(lexer, &token.type);
+	} else {
+		// token is a symbol
+		switch (*lexer->source) {
+			case '\n':
+				token.type = SEMI;
+				lexer->semi = false;
+				next(lexer);
+				lexer->line++;
+				lexer->line_start = lexer->source;
+				break;
+
+			case '"':
+				lexer->semi = true;
+				token.type = STRING;
+				token.value = lex_string(&lexer->source);
+				break;
+
+			case ':':
+				lexer->semi = false;
+				token.type = switch3(&lexer->source, COLON, DEFINE, ':', DOUBLE_COLON);
+				break;
+
+			case '.':
+				token.type = PERIOD;
+				next(lexer);
+				if (*lexer->source == '.') {
+					next(lexer);
+					if (*lexer->source == '.') {
+						next(lexer);
+						token.type = ELLIPSE;
 					}
-					break;
+				}
+				break;
+
+			case ',':
+				token.type = COMMA;
+				next(lexer);
+				break;
+
+			case ';':
+				token.type = SEMI;
+				next(lexer);
+				break;
+
+			case '(':
+				token.type = LPAREN;
+				next(lexer);
+				break;
+
+			case ')':
+				lexer->semi = true;
+				token.type = RPAREN;
+				next(lexer);
+				break;
+
+			case '[':
+				token.type = LBRACK;
+				next(lexer);
+				break;
+
+			case ']':
+				lexer->semi = true;
+				token.type = RBRACK;
+				next(lexer);
+				break;
+
+			case '{':
+				lexer->semi = false;
+				token.type = LBRACE;
+				next(lexer);
+				break;
+
+			case '}':
+				lexer->semi = true;
+				token.type = RBRACE;
+				next(lexer);
+				break;
+
+			case '+':
+				token.type = switch3(&lexer->source, ADD, ADD_ASSIGN, '+', INC);
+				if (token.type == INC) lexer->semi = true;
+				break;
+
+			case '-':
+				if (peek(lexer->source) == '>') {
+					token.type = ARROW;
+					lexer->source += 2;
+				} else {
+					token.type = switch3(&lexer->source, SUB, SUB_ASSIGN, '-', DEC);
+					if (token.type == DEC) lexer->semi = true;
+				}
+				break;
+
+			case '*':
+				token.type = switch2(&lexer->source, MUL, MUL_ASSIGN);
+				break;
+
+			case '/':
+				token.type = switch2(&lexer->source, QUO, QUO_ASSIGN);
+				break;
+
+			case '%':
+				token.type = switch2(&lexer->source, REM, REM_ASSIGN);
+				break;
+
+			case '^':
+				token.type = switch2(&lexer->source, XOR, XOR_ASSIGN);
+				break;
+
+			case '<':
+				token.type = switch4(&lexer->source, LSS, LEQ, '<', SHL, SHL_ASSIGN);
+				break;
+
+			case '>':
+				token.type = switch4(&lexer->source, GTR, GEQ, '>', SHR, SHR_ASSIGN);
+				break;
+
+			case '=':
+				token.type = switch2(&lexer->source, ASSIGN, EQL);
+				break;
+
+			case '!':
+				token.type = switch2(&lexer->source, NOT, NEQ);
+				break;
+
+			case '&':
+				if (peek(lexer->source) == '^') {
+					next(lexer);
+					token.type = switch2(&lexer->source, AND_NOT, AND_NOT_ASSIGN);
+				} else {
+					token.type = switch3(&lexer->source, AND, AND_ASSIGN, '&', LAND);
+				}
+				break;
+
+			case '|':
+				token.type = switch3(&lexer->source, OR, OR_ASSIGN, '|', LOR);
+				break;
+
+			default:
+				token.type = ILLEGAL;
+				if (*lexer->source) next(lexer); // dont move past the end of trailing whitespace
+				break;
+		}
+	}
 
-				case '|':
-					token.type = switch3(&lexer.source, OR, OR_ASSIGN, '|', LOR);
-					break;
+	if (token.value == NULL) token.value = TokenName(token.type);
 
-				default:
-					token.type = ILLEGAL;
-					next(&lexer);
-					break;
-			}
-		}
+	return token;
+}
 
-		if (token.value == NULL) token.value = TokenName(token.type);
+// LexSlab lexes source, allocating identifier and number values from s
+Token *LexSlab(char *source, slab *s) {
+	Lexer lexer = {source, 1, 1, false, s, source};
 
-		// Add the token to the array
-		tokens = (Token *)realloc(tokens, (i + 1) * sizeof(Token));
-		tokens[i - 1] = token;
+	int capacity = 64;
+	Token *tokens = (Token *)malloc(capacity * sizeof(Token));
+
+	int i = 0;
+	Token token;
+	do {
+		token = LexNext(&lexer);
 
-		// Check for newline
-		if (*lexer.source == '\n') {
-			lexer.line++;
+		// Add the token to the array
+		if (i == capacity) {
+			capacity *= 2;
+			tokens = (Token *)realloc(tokens, capacity * sizeof(Token));
 		}
+		tokens[i++] = token;
+	} while (token.type != END);
 
-	}
+	return tokens;
+}
+
+// LexQueue lexes source on the calling thread, pushing each token into q as
+// it is produced and closing q after the END token
+void LexQueue(char *source, slab *s, spsc_queue *q) {
+	Lexer lexer = {source, 1, 1, false, s, source};
 
-	// End of file token
 	Token token;
-	token.column = 321;
-	token.line = 321;
-	token.value = "";
-	token.type = END;
-	tokens[i] = token;
+	do {
+		token = LexNext(&lexer);
+		spsc_queue_push(q, &token);
+	} while (token.type != END);
 
-	return tokens;
+	spsc_queue_close(q);
+}
+
+// LexMaxTokens returns an upper bound on the amount of tokens in source, every
+// token except END consumes at least one character
+int LexMaxTokens(char *source) {
+	return strlen(source) + 2;
 }
 
 char *TokenName(TokenType type) {
@@ -677,15 +716,21 @@ int get_binding_power(TokenType type) {
 	case ADD_ASSIGN:
 	case SUB_ASSIGN:
 	case MUL_ASSIGN:
+	case QUO_ASSIGN:
 	case REM_ASSIGN:
+	case AND_ASSIGN:
 	case OR_ASSIGN:
+	case XOR_ASSIGN:
+	case SHL_ASSIGN:
 	case SHR_ASSIGN:
+	case AND_NOT_ASSIGN:
 	case DEFINE:
 		return 10;
-	// Logical operators
-	case LAND:
+	// Logical operators, && binds tighter than ||
 	case LOR:
 		return 20;
+	case LAND:
+		return 25;
 	// Equality operators
 	case EQL:
 	case NEQ:
@@ -697,10 +742,16 @@ int get_binding_power(TokenType type) {
 	// Math operators
 	case ADD:
 	case SUB:
+	case OR:
+	case XOR:
 		return 40;
 	case MUL:
 	case QUO:
 	case REM:
+	case AND:
+	case AND_NOT:
+	case SHL:
+	case SHR:
 		return 50;
 	// Special unary
 	case NOT:
@@ -1,8 +1,20 @@
+// mmap/madvise flags used by pool.c, llvm-config may already define it
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include "error.c"
 #include "lexer.c"
 #include "ast.c"
 #include "parser.c"
 #include "irgen.c"
+#include "types.c"
+#include "semantic.c"
+#include "optimize.c"
 #include "pool.c"
+#include "slab.c"
 #include "queue.c"
+#include "mpmc_queue.c"
+#include "spsc_queue.c"
+#include "pipeline.c"
 #include "string.c"
\ No newline at end of file
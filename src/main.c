@@ -5,33 +5,61 @@
 #include "includes/irgen.h"
 #include "includes/parser.h"
 #include "includes/string.h"
+#include "includes/pipeline.h"
+#include "includes/semantic.h"
+#include "includes/optimize.h"
 
 
 #include <llvm-c/BitWriter.h>
 #include <stdlib.h>
 
+// tools that turn the emitted bitcode into an executable, the build points these
+// at the llc of the LLVM it links against and at its own C compiler
+#ifndef ATOMICAL_LLC
+#define ATOMICAL_LLC "llc"
+#endif
+#ifndef ATOMICAL_CC
+#define ATOMICAL_CC "clang"
+#endif
+
 void print_usage() {
 	printf("usage: atomical filename <flags>\n");
+	printf("  -o, -output <file>      output file\n");
+	printf("  -t, --tokens            emit tokens\n");
+	printf("  -i, --ircode            emit llvm ir\n");
+	printf("  -O0, -O1, -O2, -O3, -Os optimization level, defaults to -O0\n");
+	printf("  -s, --share-exps        share identical expressions and reuse their values\n");
+	printf("  -d, --direct-ssa        keep scalar variables in registers instead of allocas\n");
+	printf("  -p, --pipeline          run the lexer, parser and irgen on separate threads\n");
+	printf("  -j, --json-diagnostics  write errors and phase times to stderr as newline delimited json\n");
+	printf("  -H, --huge-pages        back large allocations with transparent huge pages\n");
+	printf("  --huge-pages=explicit   use reserved huge pages (MAP_HUGETLB) when available\n");
 	exit(1);
 }
 
 int main(int argc, char *argv[]) {
-	string in_file = string_new(argv[1]);
-	string out_file = string_new("");
+	// file names and commands are usually short enough to be stored inline
+	small_string in_file = small_string_new(argv[1]);
+	small_string out_file = small_string_new("");
 	bool emit_tokens = false;
 	bool emit_ircode = false;
+	bool share_exps = false;
+	bool direct_ssa = false;
+	bool pipelined = false;
+	bool json_diagnostics = false;
+	OptLevel opt_level = {0, 0};
 
 	// Check for no/incorrect input file
 	if (argc < 2 || argv[0][0] == '-') print_usage();
 	
 	// Check input file has .acl extension
-	int in_len = string_length(in_file);
+	int in_len = small_string_length(&in_file);
 	if(in_len < 4) print_usage();
-	if(strcmp(in_file + in_len - 4, ".acl") != 0) print_usage();
+	if(strcmp(small_string_cstring(&in_file) + in_len - 4, ".acl") != 0) print_usage();
 	
 	// Create default out name
-	out_file = string_append_length(out_file, in_file, in_len - 4);
-	out_file = string_append_cstring(out_file, ".ll");
+	small_string_append_length(&out_file, small_string_cstring(&in_file), in_len - 4);
+	small_string_append_cstring(&out_file, ".ll");
 	
 	// Parse tokens
 	for (int i = 2; i < argc; i++) {
@@ -39,67 +67,153 @@ int main(int argc, char *argv[]) {
 			if(i == argc - 1) print_usage();
 			i++;
 			if(argv[i][0] == '-') print_usage();
-			out_file = argv[i];
+			small_string_free(&out_file);
+			out_file = small_string_new(argv[i]);
 			i++;
 		} else {
 			emit_tokens = emit_tokens || strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--tokens") == 0;
 			emit_ircode = emit_ircode || strcmp(argv[i], "-i") == 0 || strcmp(argv[i], "--ircode") == 0;
+			share_exps = share_exps || strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "--share-exps") == 0;
+			direct_ssa = direct_ssa || strcmp(argv[i], "-d") == 0 || strcmp(argv[i], "--direct-ssa") == 0;
+			pipelined = pipelined || strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--pipeline") == 0;
+			json_diagnostics = json_diagnostics || strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--json-diagnostics") == 0;
+			ParseOptLevel(argv[i], &opt_level);
+
+			// back large pool chunks with huge pages
+			if(strcmp(argv[i], "-H") == 0 || strcmp(argv[i], "--huge-pages") == 0) {
+				pool_set_page_mode(pool_pages_transparent);
+			} else if(strcmp(argv[i], "--huge-pages=explicit") == 0) {
+				pool_set_page_mode(pool_pages_explicit);
+			}
 		}
 	}
 
 	// Open the in and out files
-	FILE *in_file_hdl = fopen(in_file, "r");
-	FILE *out_file_hdl = fopen(out_file, "w+");
+	FILE *in_file_hdl = fopen(small_string_cstring(&in_file), "r");
+	FILE *out_file_hdl = fopen(small_string_cstring(&out_file), "w+");
 
 	// Copy file content to string buffer
+	double phase_start = diagnostic_now();
 	string buffer = string_new_file(in_file_hdl);
 	printf("Done\n");
 
+	// json diagnostics are collected here and written once at exit
+	string json = string_new_capacity(1024);
+	if (json_diagnostics) json = diagnostic_json_phase(json, "read", diagnostic_now() - phase_start);
+
 	// Compile the file
-	Token *tokens = Lex(buffer);
-	printf("Lexer done\n");
-	parser *p = new_parser(tokens);
-	ast_unit *ast = parse_file(p);
-	printf("Parser done\n");
 	Irgen *irgen = NewIrgen();
-	printf("Irgen done\n");
-	for (int i = 0; i < ast->dclCount; i++) {
-        CompileFunction(irgen, ast->dcls[i]);
-    }
+	irgen->reuse_values = share_exps;
+	irgen->direct_ssa = direct_ssa;
+	Checker *checker = NewChecker(irgen->types);
+	if (pipelined) {
+		phase_start = diagnostic_now();
+		pipeline pl;
+		pipeline_compile(&pl, buffer, irgen, checker, share_exps);
+		if (json_diagnostics) {
+			json = diagnostic_json_phase(json, "pipeline", diagnostic_now() - phase_start);
+			int error_count;
+			json = parser_render_errors_json(pl.parser, json, &error_count);
+			if (error_count == 0) json = RenderCheckErrorsJson(checker, json, &error_count);
+			if (error_count > 0) {
+				diagnostic_write(json, stderr);
+				exit(1);
+			}
+		} else if (parser_report_errors(pl.parser, buffer) > 0 || ReportCheckErrors(checker, buffer) > 0) {
+			exit(1);
+		}
+		printf("Pipeline done\n");
+	} else {
+		phase_start = diagnostic_now();
+		slab *token_slab = new_slab();
+		Token *tokens = LexSlab(buffer, token_slab);
+		if (json_diagnostics) json = diagnostic_json_phase(json, "lex", diagnostic_now() - phase_start);
+		printf("Lexer done\n");
+
+		phase_start = diagnostic_now();
+		parser *p = new_parser(tokens);
+		if (share_exps) ast_unit_enable_hash_consing(p->ast);
+		ast_unit *ast = parse_file(p);
+		if (json_diagnostics) {
+			json = diagnostic_json_phase(json, "parse", diagnostic_now() - phase_start);
+			int error_count;
+			json = parser_render_errors_json(p, json, &error_count);
+			if (error_count > 0) {
+				diagnostic_write(json, stderr);
+				exit(1);
+			}
+		} else if (parser_report_errors(p, buffer) > 0) {
+			exit(1);
+		}
+		printf("Parser done\n");
+
+		phase_start = diagnostic_now();
+		CheckUnit(checker, ast);
+		if (json_diagnostics) {
+			json = diagnostic_json_phase(json, "check", diagnostic_now() - phase_start);
+			int error_count;
+			json = RenderCheckErrorsJson(checker, json, &error_count);
+			if (error_count > 0) {
+				diagnostic_write(json, stderr);
+				exit(1);
+			}
+		} else if (ReportCheckErrors(checker, buffer) > 0) {
+			exit(1);
+		}
+		printf("Semantic analysis done\n");
+
+		phase_start = diagnostic_now();
+		printf("Irgen done\n");
+		for (int i = 0; i < ast->dclCount; i++) {
+			CompileFunction(irgen, ast->dcls[i]);
+		}
+		if (json_diagnostics) json = diagnostic_json_phase(json, "irgen", diagnostic_now() - phase_start);
+	}
 	printf("Compiled to LLVM\n");
 
+	// Optimize the module
+	phase_start = diagnostic_now();
+	OptimizeModule(irgen->module, opt_level);
+	if (json_diagnostics) json = diagnostic_json_phase(json, "optimize", diagnostic_now() - phase_start);
+	printf("Optimized\n");
+
 	// Write the file to llvm bitcode
+	phase_start = diagnostic_now();
 	int rc = LLVMWriteBitcodeToFD(irgen->module, fileno(out_file_hdl), true, true); // out_file_hdl closed here
 	if (rc > 0) {
 		printf("LLVM to bitcode error\n");
 		exit(1);
 	}
+	if (json_diagnostics) json = diagnostic_json_phase(json, "bitcode", diagnostic_now() - phase_start);
 	printf("Compile to bitcode\n");
 	
 	// Compile to assembly
-	string llc_command = string_new("llc-3.9 ");
-	llc_command = string_append(llc_command, out_file);
-	system(llc_command);
+	phase_start = diagnostic_now();
+	small_string llc_command = small_string_new("");
+	small_string_append_format(&llc_command, ATOMICAL_LLC " -O%d %s", opt_level.speed, small_string_cstring(&out_file));
+	system(small_string_cstring(&llc_command));
+	if (json_diagnostics) json = diagnostic_json_phase(json, "assemble", diagnostic_now() - phase_start);
 	printf("Compiled to assembly\n");
-	string llc_file = string_copy(out_file);
-	llc_file = string_slice(llc_file, 0, string_length(llc_file) - 3); // remove .ll
-	llc_file = string_append_cstring(llc_file, ".s"); // add .s
+	small_string llc_file = small_string_copy(&out_file);
+	small_string_slice(&llc_file, 0, small_string_length(&llc_file) - 3); // remove .ll
+	small_string_append_cstring(&llc_file, ".s"); // add .s
 
 	// Create executable
-	string clang_command = string_new("clang-3.9 ");
-	clang_command = string_append(clang_command, llc_file);
-	system(clang_command);
+	phase_start = diagnostic_now();
+	small_string clang_command = small_string_new("");
+	small_string_append_format(&clang_command, ATOMICAL_CC " %s", small_string_cstring(&llc_file));
+	system(small_string_cstring(&clang_command));
+	if (json_diagnostics) json = diagnostic_json_phase(json, "link", diagnostic_now() - phase_start);
 	printf("Executable created\n");
 
 	// Remove temporary files
-	string rm_command = string_new("rm ");
-	rm_command = string_append(rm_command, out_file);
-	rm_command = string_append_cstring(rm_command, " ");
-	rm_command = string_append(rm_command, llc_file);
-	system(rm_command);
+	small_string rm_command = small_string_new("");
+	small_string_append_format(&rm_command, "rm %s %s", small_string_cstring(&out_file), small_string_cstring(&llc_file));
+	system(small_string_cstring(&rm_command));
 	printf("Removed temporary files\n");
 
 	fclose(in_file_hdl);
+	if (json_diagnostics) diagnostic_write(json, stderr);
 
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,138 @@
+#include "includes/mpmc_queue.h"
+#include <sched.h>
+#include <stdint.h>
+#include <string.h>
+
+// mpmc_cell_sequence returns a pointer to the sequence number of cell pos
+size_t *mpmc_cell_sequence(mpmc_queue *q, size_t pos) {
+    return (size_t *)(q->cells + (pos & q->mask) * q->cell_size);
+}
+
+// new_mpmc_queue creates a queue holding up to capacity elements, capacity is
+// rounded up to a power of two
+mpmc_queue *new_mpmc_queue(size_t element_size, int capacity) {
+    assert(capacity > 0);
+    size_t size = 2;
+    while (size < (size_t)capacity) size *= 2;
+
+    // aligned so the positions sit on their own cache lines
+    mpmc_queue *q = aligned_alloc(MPMC_CACHE_LINE, (sizeof(mpmc_queue) + MPMC_CACHE_LINE - 1) & ~(MPMC_CACHE_LINE - 1));
+    q->element_size = element_size;
+    q->cell_size = (sizeof(size_t) + element_size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+    q->mask = size - 1;
+    q->cells = malloc(q->cell_size * size);
+
+    // cell i is free for the producer that claims position i
+    for (size_t i = 0; i < size; i++) {
+        __atomic_store_n(mpmc_cell_sequence(q, i), i, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&q->enqueue_pos, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&q->dequeue_pos, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&q->closed, false, __ATOMIC_RELAXED);
+
+    return q;
+}
+
+// mpmc_queue_capacity returns the amount of elements the queue can hold
+int mpmc_queue_capacity(mpmc_queue *q) {
+    return q->mask + 1;
+}
+
+// mpmc_queue_try_push copies element into the queue, returns false if the queue is full
+bool mpmc_queue_try_push(mpmc_queue *q, void *element) {
+    size_t pos = __atomic_load_n(&q->enqueue_pos, __ATOMIC_RELAXED);
+    for (;;) {
+        size_t *sequence = mpmc_cell_sequence(q, pos);
+        size_t seq = __atomic_load_n(sequence, __ATOMIC_ACQUIRE);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+        if (diff == 0) {
+            // cell is free, try to claim it
+            if (__atomic_compare_exchange_n(&q->enqueue_pos, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                memcpy(sequence + 1, element, q->element_size);
+                __atomic_store_n(sequence, pos + 1, __ATOMIC_RELEASE);
+                return true;
+            }
+            // another producer claimed it, pos has been reloaded
+        } else if (diff < 0) {
+            // cell still holds an element from the previous lap
+            return false;
+        } else {
+            pos = __atomic_load_n(&q->enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+// mpmc_queue_try_pop copies the next element out of the queue, returns false if the queue is empty
+bool mpmc_queue_try_pop(mpmc_queue *q, void *element) {
+    size_t pos = __atomic_load_n(&q->dequeue_pos, __ATOMIC_RELAXED);
+    for (;;) {
+        size_t *sequence = mpmc_cell_sequence(q, pos);
+        size_t seq = __atomic_load_n(sequence, __ATOMIC_ACQUIRE);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+
+        if (diff == 0) {
+            // cell is full, try to claim it
+            if (__atomic_compare_exchange_n(&q->dequeue_pos, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                memcpy(element, sequence + 1, q->element_size);
+                // free the cell for the producer one lap ahead
+                __atomic_store_n(sequence, pos + q->mask + 1, __ATOMIC_RELEASE);
+                return true;
+            }
+        } else if (diff < 0) {
+            // nothing has been pushed to this cell yet
+            return false;
+        } else {
+            pos = __atomic_load_n(&q->dequeue_pos, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+// mpmc_queue_wait backs off while waiting on another thread, spinning first and
+// then yielding the cpu
+void mpmc_queue_wait(int *spins) {
+    if (*spins < 64) {
+        (*spins)++;
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    } else {
+        sched_yield();
+    }
+}
+
+// mpmc_queue_push copies element into the queue, waiting while the queue is full
+void mpmc_queue_push(mpmc_queue *q, void *element) {
+    ASSERT(!mpmc_queue_closed(q), "Push to a closed queue");
+    int spins = 0;
+    while (!mpmc_queue_try_push(q, element)) mpmc_queue_wait(&spins);
+}
+
+// mpmc_queue_pop copies the next element out of the queue, waiting while the queue
+// is empty. Returns false once the queue is closed and empty.
+bool mpmc_queue_pop(mpmc_queue *q, void *element) {
+    int spins = 0;
+    for (;;) {
+        if (mpmc_queue_try_pop(q, element)) return true;
+        // check closed after a failed pop so elements pushed before the close are not lost
+        if (mpmc_queue_closed(q)) return mpmc_queue_try_pop(q, element);
+        mpmc_queue_wait(&spins);
+    }
+}
+
+// mpmc_queue_close marks that no more elements will be pushed, waking blocked consumers.
+// Must only be called once every push has returned.
+void mpmc_queue_close(mpmc_queue *q) {
+    __atomic_store_n(&q->closed, true, __ATOMIC_RELEASE);
+}
+
+// mpmc_queue_closed returns true if the queue has been closed
+bool mpmc_queue_closed(mpmc_queue *q) {
+    return __atomic_load_n(&q->closed, __ATOMIC_ACQUIRE);
+}
+
+// mpmc_queue_destroy frees the queue, no thread may be using it
+void mpmc_queue_destroy(mpmc_queue *q) {
+    free(q->cells);
+    free(q);
+}
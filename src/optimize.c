@@ -0,0 +1,111 @@
+#include "includes/optimize.h"
+
+#include <llvm-c/Target.h>
+#include <llvm-c/TargetMachine.h>
+#include <llvm-c/Transforms/InstCombine.h>
+#include <llvm-c/Transforms/PassManagerBuilder.h>
+#include <llvm-c/Transforms/Scalar.h>
+#include <llvm-c/Transforms/Vectorize.h>
+
+// ParseOptLevel parses -O0, -O1, -O2, -O3 and -Os, returns false for any other flag
+bool ParseOptLevel(char *flag, OptLevel *level) {
+    if (flag[0] != '-' || flag[1] != 'O' || flag[2] == '\0' || flag[3] != '\0') return false;
+
+    if (flag[2] >= '0' && flag[2] <= '3') {
+        level->speed = flag[2] - '0';
+        level->size = 0;
+        return true;
+    } else if (flag[2] == 's') {
+        level->speed = 2;
+        level->size = 1;
+        return true;
+    }
+
+    return false;
+}
+
+// InlineThreshold gets the inliner threshold for level (the same as clang), 0 when
+// functions are not inlined
+int InlineThreshold(OptLevel level) {
+    if (level.size > 0) return 75;
+    if (level.speed > 2) return 250;
+    if (level.speed > 1) return 225;
+    return 0;
+}
+
+// HostTargetMachine creates a target machine for the host, the unroller and the
+// vectorizers need it to know the register widths and instruction costs
+LLVMTargetMachineRef HostTargetMachine(OptLevel level) {
+    LLVMInitializeNativeTarget();
+
+    char *triple = LLVMGetDefaultTargetTriple();
+    LLVMTargetRef target;
+    char *error = NULL;
+    if (LLVMGetTargetFromTriple(triple, &target, &error) != 0) {
+        LLVMDisposeMessage(error);
+        LLVMDisposeMessage(triple);
+        return NULL;
+    }
+
+    LLVMCodeGenOptLevel codegen = level.speed > 2 ? LLVMCodeGenLevelAggressive : LLVMCodeGenLevelDefault;
+    LLVMTargetMachineRef machine = LLVMCreateTargetMachine(target, triple, "generic", "", codegen,
+        LLVMRelocDefault, LLVMCodeModelDefault);
+    LLVMDisposeMessage(triple);
+    return machine;
+}
+
+// OptimizeModule runs the optimization pipeline for level on module. The pipeline is
+// the one LLVM builds for clang: per function SROA (mem2reg), early cse and
+// simplifycfg, then the module pipeline of inlining, instcombine, GVN, LICM, loop
+// rotation and unrolling. The loop and SLP vectorizers are not part of the builders
+// pipeline when driven through the C api so they are added after it, followed by
+// the cleanup they need. -O0 leaves the module untouched.
+void OptimizeModule(LLVMModuleRef module, OptLevel level) {
+    if (level.speed == 0 && level.size == 0) return;
+
+    // the cost models read the target from the module
+    LLVMTargetMachineRef machine = HostTargetMachine(level);
+    if (machine != NULL) {
+        char *triple = LLVMGetTargetMachineTriple(machine);
+        LLVMSetTarget(module, triple);
+        LLVMDisposeMessage(triple);
+        LLVMTargetDataRef layout = LLVMCreateTargetDataLayout(machine);
+        LLVMSetModuleDataLayout(module, layout);
+        LLVMDisposeTargetData(layout);
+    }
+
+    LLVMPassManagerBuilderRef builder = LLVMPassManagerBuilderCreate();
+    LLVMPassManagerBuilderSetOptLevel(builder, level.speed);
+    LLVMPassManagerBuilderSetSizeLevel(builder, level.size);
+    // unrolling grows the code so it only runs from -O2 and never for -Os
+    LLVMPassManagerBuilderSetDisableUnrollLoops(builder, level.speed < 2 || level.size > 0);
+    int threshold = InlineThreshold(level);
+    if (threshold > 0) LLVMPassManagerBuilderUseInlinerWithThreshold(builder, threshold);
+
+    // function passes clean up each function before the module passes see it
+    LLVMPassManagerRef functionPasses = LLVMCreateFunctionPassManagerForModule(module);
+    if (machine != NULL) LLVMAddAnalysisPasses(machine, functionPasses);
+    LLVMPassManagerBuilderPopulateFunctionPassManager(builder, functionPasses);
+    LLVMInitializeFunctionPassManager(functionPasses);
+    for (LLVMValueRef f = LLVMGetFirstFunction(module); f != NULL; f = LLVMGetNextFunction(f)) {
+        if (LLVMCountBasicBlocks(f) > 0) LLVMRunFunctionPassManager(functionPasses, f);
+    }
+    LLVMFinalizeFunctionPassManager(functionPasses);
+    LLVMDisposePassManager(functionPasses);
+
+    LLVMPassManagerRef modulePasses = LLVMCreatePassManager();
+    if (machine != NULL) LLVMAddAnalysisPasses(machine, modulePasses);
+    LLVMPassManagerBuilderPopulateModulePassManager(builder, modulePasses);
+    if (level.speed > 1 && level.size == 0) {
+        LLVMAddLoopVectorizePass(modulePasses);
+        LLVMAddSLPVectorizePass(modulePasses);
+        // the vectorizers leave behind redundant instructions and blocks
+        LLVMAddInstructionCombiningPass(modulePasses);
+        LLVMAddCFGSimplificationPass(modulePasses);
+    }
+    LLVMRunPassManager(modulePasses, module);
+    LLVMDisposePassManager(modulePasses);
+
+    LLVMPassManagerBuilderDispose(builder);
+    if (machine != NULL) LLVMDisposeTargetMachine(machine);
+}
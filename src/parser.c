@@ -4,12 +4,41 @@
 parser *new_parser(Token *tokens) {
 	parser *p = (parser *)malloc(sizeof(parser));
 	p->tokens = tokens;
+	p->token_end = NULL;
+	p->token_queue = NULL;
+	p->dcl_queue = NULL;
 	p->scope = parser_new_scope(NULL);
 	p->ast = new_ast_unit();
 	p->error_queue = new_queue(sizeof(parser_error));
 	return p;
 }
 
+// new_stream_parser creates a parser which pulls tokens from token_queue as it
+// needs them, blocking until the lexer has produced them. max_tokens is an upper
+// bound on the amount of tokens (see LexMaxTokens). Tokens are kept in one
+// buffer so pointers into it stay valid, untouched pages of the buffer are
+// never committed.
+parser *new_stream_parser(spsc_queue *token_queue, int max_tokens) {
+	Token *tokens = (Token *)malloc(max_tokens * sizeof(Token));
+	parser *p = new_parser(tokens);
+	p->token_end = tokens;
+	p->token_max = tokens + max_tokens;
+	p->token_queue = token_queue;
+	parser_pull_token(p);
+	return p;
+}
+
+// parser_pull_token appends the next token from the token queue to the token buffer,
+// repeating the END token if the parser moves past the end
+void parser_pull_token(parser *p) {
+	assert(p->token_end < p->token_max);
+	if (!spsc_queue_pop(p->token_queue, p->token_end)) {
+		*p->token_end = p->token_end[-1];
+		assert(p->token_end->type == END);
+	}
+	p->token_end++;
+}
+
 // parse_file creates an abstract sytax tree from the tokens in parser 
 ast_unit *parse_file(parser *p) {
 	Dcl **dcls = malloc(0);
@@ -18,9 +47,20 @@ ast_unit *parse_file(parser *p) {
 		Dcl *d = parse_declaration(p);
 		dcls = realloc(dcls, ++dclCount * sizeof(Dcl *));
 		memcpy(dcls + dclCount - 1, &d, sizeof(Dcl *));
+
+		// send the finished declaration downstream, once there is an error the
+		// declarations may be incomplete so nothing more is sent
+		bool failed = queue_size(p->error_queue) > 0;
+		if (p->dcl_queue != NULL && d != NULL && !failed) {
+			ast_unit_forget_shared_exps(p->ast);
+			spsc_queue_push(p->dcl_queue, &d);
+		}
 	}
+	if (p->dcl_queue != NULL) spsc_queue_close(p->dcl_queue);
 
-	ast_unit *f = malloc(sizeof(ast_unit));
+	// the nodes live in the parsers pools, so hand back that unit
+	ast_unit *f = p->ast;
+	free(f->dcls);
 	f->dcls = dcls;
 	f->dclCount = dclCount;
 
@@ -48,7 +88,7 @@ void parser_exit_scope(parser *p) {
 	scope_object *obj, *tmp;
 	HASH_ITER(hh, p->scope->objects, obj, tmp) {
 		HASH_DEL(p->scope->objects, obj);
-		free(obj);
+		slab_free(p->ast->slab, obj, sizeof(scope_object));
 	}
 
 	// Move to outer scipe
@@ -65,7 +105,7 @@ bool parser_insert_scope(parser *p, char *name, Object *object) {
 	if (obj != NULL) return false;
 
 	// add object to scope
-	obj = (scope_object *)malloc(sizeof(scope_object));
+	obj = (scope_object *)slab_alloc(p->ast->slab, sizeof(scope_object));
 	obj->name = name;
 	obj->obj = object;
 	HASH_ADD_KEYPTR(hh, p->scope->objects, obj->name, strlen(obj->name), obj);
@@ -86,6 +126,7 @@ Object *parser_find_scope(parser *p, char *name) {
 // parser_next moves the parser onto the next token
 void parser_next(parser *p) {
 	p->tokens++;
+	if (p->token_queue != NULL && p->tokens == p->token_end) parser_pull_token(p);
 }
 
 // parser_expect checks that the current token is of type type, if true parser advances, 
@@ -126,8 +167,141 @@ parser_error *new_error_token(parser *p, TokenType token_type) {
 	return error;
 }
 
-char *format_error(char *src, parser_error *error) {
-	return "";
+// token_text returns the source text of token, symbols have no value so use their name
+char *token_text(Token *token) {
+	return token->value[0] != '\0' ? token->value : TokenName(token->type);
+}
+
+// format_error appends the message of error to out
+string format_error(string out, parser_error *error) {
+	char *got = error->start->type == END ? "end of file" : token_text(error->start);
+	switch(error->type) {
+		case parser_error_expect_token:
+			return string_append_format(out, "expected '%s' but got '%s'", TokenName(error->expect_token.type), got);
+		case parser_error_expect_declaration:
+			return string_append_format(out, "expected a top level declaration but got '%s'", got);
+		case parser_error_expect_statement:
+			return string_append_format(out, "expected a statement but got '%s'", got);
+		case parser_error_expect_expression:
+			return string_append_format(out, "expected an expression but got '%s'", got);
+		case parser_error_expect_type:
+			return string_append_format(out, "expected a type but got '%s'", got);
+		case parser_error_expect_array_length:
+			return string_append_format(out, "expected an array length but got '%s'", got);
+		case parser_error_expect_block:
+			return string_append_format(out, "expected a block but got '%s'", got);
+		case parser_error_expect_prefix:
+			return string_append_format(out, "'%s' can not start an expression", got);
+		case parser_error_expect_infix:
+			return string_append_format(out, "'%s' can not continue an expression", got);
+		case parser_error_misplaced_fallthrough:
+			return string_append_cstring(out, "fallthrough must be the last statement in a case");
+	}
+
+	return string_append_cstring(out, "unknown error");
+}
+
+// parser_error_span finds the line and column of the first token of error and
+// the length in characters up to the end of its last token on the same line
+void parser_error_span(parser_error *error, int *line, int *column, int *length) {
+	Token *first = error->start;
+	Token *last = error->start + (error->length > 0 ? error->length - 1 : 0);
+	if (last->line != first->line) last = first;
+
+	*line = first->line;
+	*column = first->column;
+	*length = last->column + (last->type == END ? 0 : strlen(token_text(last))) - first->column;
+	if (*length < 1) *length = 1;
+}
+
+// parser_render_errors drains the error queue, appending a diagnostic for each of the
+// first MAX_ERRORS errors to out. count is set to the amount of errors drained.
+string parser_render_errors(parser *p, char *src, string out, int *count) {
+	*count = 0;
+	if (queue_size(p->error_queue) == 0) return out;
+
+	line_index *index = new_line_index(src);
+	parser_error *error;
+	while((error = queue_pop_front(p->error_queue)) != NULL) {
+		(*count)++;
+		if (*count <= MAX_ERRORS) {
+			// underline from the first token to the end of the last token of the error
+			int line, start, length, line_length;
+			parser_error_span(error, &line, &start, &length);
+			char *line_src = line_index_line(index, line, &line_length);
+			if (line_src == NULL) {
+				// not in the source, point just past the last line
+				line = index->count;
+				line_src = line_index_line(index, line, &line_length);
+				start = line_length + 1;
+				length = 1;
+			}
+			int end = start + length - 1;
+
+			out = diagnostic_begin(out);
+			out = format_error(out, error);
+			out = diagnostic_source(out, line_src, line_length, line, start, end);
+		}
+		queue_free_item(error);
+	}
+
+	if (*count > MAX_ERRORS) {
+		out = string_append_format(out, "%d more errors not shown\n", *count - MAX_ERRORS);
+	}
+	line_index_destroy(index);
+	return out;
+}
+
+// parser_error_kind returns the name used for type in machine readable diagnostics
+char *parser_error_kind(parser_error_type type) {
+	switch(type) {
+		case parser_error_expect_token: return "expect_token";
+		case parser_error_expect_declaration: return "expect_declaration";
+		case parser_error_expect_statement: return "expect_statement";
+		case parser_error_expect_expression: return "expect_expression";
+		case parser_error_expect_type: return "expect_type";
+		case parser_error_expect_array_length: return "expect_array_length";
+		case parser_error_expect_block: return "expect_block";
+		case parser_error_expect_prefix: return "expect_prefix";
+		case parser_error_expect_infix: return "expect_infix";
+		case parser_error_misplaced_fallthrough: return "misplaced_fallthrough";
+	}
+
+	return "unknown";
+}
+
+// parser_render_errors_json drains the error queue, appending one JSON object per
+// error to out (newline delimited JSON). Unlike parser_render_errors there is no
+// limit and the source is not needed. count is set to the amount of errors drained.
+string parser_render_errors_json(parser *p, string out, int *count) {
+	*count = 0;
+	parser_error *error;
+	while((error = queue_pop_front(p->error_queue)) != NULL) {
+		(*count)++;
+		int line, column, length;
+		parser_error_span(error, &line, &column, &length);
+
+		out = string_append_format(out, "{\"kind\":\"%s\",\"token\":", parser_error_kind(error->type));
+		out = diagnostic_json_string(out, TokenName(error->start->type));
+		if (error->type == parser_error_expect_token) {
+			out = string_append_cstring(out, ",\"expected\":");
+			out = diagnostic_json_string(out, TokenName(error->expect_token.type));
+		}
+		out = string_append_format(out, ",\"line\":%d,\"column\":%d,\"length\":%d}\n", line, column, length);
+		queue_free_item(error);
+	}
+
+	return out;
+}
+
+// parser_report_errors writes the diagnostics for the parsers errors to stdout in a single
+// write, returns the amount of errors
+int parser_report_errors(parser *p, char *src) {
+	int count;
+	string out = parser_render_errors(p, src, string_new_capacity(4096), &count);
+	if (count > 0) diagnostic_write(out, stdout);
+	string_free(out);
+	return count;
 }
 
 // parse_declaration parse a decleration node
@@ -137,7 +311,7 @@ Dcl *parse_declaration(parser *p) {
 			return parse_function_dcl(p);
 		case VAR:
 		case IDENT:
-			return parse_variable_dcl(p);
+			return parse_global_variable_dcl(p);
 		default: {
 			// expected a top level declaration
 			new_error(p, parser_error_expect_declaration, 1);
@@ -153,23 +327,23 @@ Dcl *parse_declaration_from_string(char *src) {
 
 void parser_skip_next_block(parser *p) {
 		// Move to start of block
-		while(p->tokens->type != LBRACE) p->tokens++;
+		while(p->tokens->type != LBRACE) parser_next(p);
 		
 		// Skip over block (and all sub blocks)
 		int depth = 0;
 		do {
 			if(p->tokens->type == LBRACE) depth++;
 			else if(p->tokens->type == RBRACE) depth--;
-			p->tokens++;
+			parser_next(p);
 		} while(depth > 0);
 
-		if(p->tokens->type == SEMI) p->tokens++;
+		if(p->tokens->type == SEMI) parser_next(p);
 }
 
 void parser_skip_to_semi(parser *p) {
 	// Move past first semi
-	while(p->tokens->type != SEMI && p->tokens->type != END) p->tokens++;
-	if(p->tokens->type == SEMI) p->tokens++;
+	while(p->tokens->type != SEMI && p->tokens->type != END) parser_next(p);
+	if(p->tokens->type == SEMI) parser_next(p);
 }
 
 // parse_function_dcl parses a function decleration
@@ -188,19 +362,21 @@ Dcl *parse_function_dcl(parser *p) {
 		return NULL;
 	}
 	char *name = ident->value; // function name
+	Token location = *ident;
 	
 	// Parse argument seperator
 	parser_expect(p, DOUBLE_COLON);
 	// missing double colon is not fatel so countinue
 
 	// Parse arguments
-	Dcl *args = (Dcl *)malloc(0);
+	Dcl *args = NULL;
 	int argCount = 0;
 	while(p->tokens->type != ARROW && p->tokens->type != LBRACE) {
 		if (argCount > 0) parser_expect(p, COMMA);
 		// missing comma not fatel
 
-		args = realloc(args, sizeof(Dcl) * ++argCount);
+		args = slab_realloc(p->ast->slab, args, sizeof(Dcl) * argCount, sizeof(Dcl) * (argCount + 1));
+		argCount++;
 
 		// Construct argument
 		Exp *type = parse_type(p); // arg type
@@ -219,6 +395,7 @@ Dcl *parse_function_dcl(parser *p) {
 
 		// add argument to list
 		Dcl *arg = new_argument_dcl(p->ast, type, name);
+		arg->token = *name_token;
 		void *dest = memcpy(args + argCount - 1, arg, sizeof(Dcl));
 	}
 	
@@ -235,40 +412,42 @@ Dcl *parse_function_dcl(parser *p) {
 		return NULL;
 	}
 
-	// insert arguments into scope
+	// insert arguments into the functions scope
+	parser_enter_scope(p);
 	for (int i = 0; i < argCount; i++) {
 		// insert into scope
-		Object *obj = (Object *)malloc(sizeof(Object));
+		Object *obj = (Object *)slab_alloc(p->ast->slab, sizeof(Object));
 		obj->name = args[i].argument.name;
 		obj->node = args + i;
 		obj->type = argObj;
 		parser_insert_scope(p, obj->name, obj);
 	}
 
-	// insert function into scope
+	// the function name is bound by the resolution pass, so declarations can be
+	// parsed without knowing about each other
 	Dcl* function = new_function_dcl(p->ast, name, args, argCount, return_type, NULL);
-	Object *obj = (Object *)malloc(sizeof(Object));
-	obj->name = name;
-	obj->node = function;
-	obj->type = funcObj;
-	parser_insert_scope(p, name, obj);
+	function->token = location;
 	
 	// parse body
 	Smt *body = parse_block_smt(p);
 	function->function.body = body;
+	parser_exit_scope(p);
 
-	if(p->tokens->type == SEMI) p->tokens++;
+	if(p->tokens->type == SEMI) parser_next(p);
 
 	return function;
 }
 
-Dcl *parse_variable_dcl(parser *p) {
+// parse_global_variable_dcl parses a varible decleration without adding it to the
+// scope, top level names are bound by the resolution pass
+Dcl *parse_global_variable_dcl(parser *p) {
 	char *name;
+	Token location;
 	Exp *type = NULL;
 	Exp *value;
 
 	if(p->tokens->type == VAR) {
-		p->tokens++;
+		parser_next(p);
 		
 		// Type
 		type = parse_type(p);
@@ -284,6 +463,7 @@ Dcl *parse_variable_dcl(parser *p) {
 			return NULL;
 		}
 		name = name_token->value;
+		location = *name_token;
 
 		// Assign
 		parser_expect(p, ASSIGN);
@@ -303,6 +483,7 @@ Dcl *parse_variable_dcl(parser *p) {
 			return NULL;
 		}
 		name = name_token->value;
+		location = *name_token;
 		
 		// Define
 		parser_expect(p, DEFINE);
@@ -316,13 +497,21 @@ Dcl *parse_variable_dcl(parser *p) {
 		}
 	}
 
-	Dcl *dcl = new_varible_dcl(p->ast, name, type, value);
+	Dcl *d = new_varible_dcl(p->ast, name, type, value);
+	d->token = location;
+	return d;
+}
 
-	Object *obj = (Object *)malloc(sizeof(Object));
-	obj->name = name;
+// parse_variable_dcl parses a local varible decleration and adds it to the scope
+Dcl *parse_variable_dcl(parser *p) {
+	Dcl *dcl = parse_global_variable_dcl(p);
+	if (dcl == NULL) return NULL;
+
+	Object *obj = (Object *)slab_alloc(p->ast->slab, sizeof(Object));
+	obj->name = dcl->varible.name;
 	obj->node = dcl;
 	obj->type = varObj;
-	parser_insert_scope(p, name, obj);
+	parser_insert_scope(p, obj->name, obj);
 
 	return dcl;
 }
@@ -344,6 +533,7 @@ Smt *parse_statement(parser *p) {
 		if(exp == NULL) queue_pop_back(p->error_queue); // remove expression error
 		new_error(p, parser_error_expect_statement, 1);
 		parser_skip_to_semi(p);
+		return NULL;
 	} 
 	
 	Exp *left = exp->binary.left;
@@ -355,9 +545,14 @@ Smt *parse_statement(parser *p) {
 		case ADD_ASSIGN:
 		case SUB_ASSIGN:
 		case MUL_ASSIGN:
+		case QUO_ASSIGN:
 		case REM_ASSIGN:
+		case AND_ASSIGN:
 		case OR_ASSIGN:
+		case XOR_ASSIGN:
 		case SHL_ASSIGN:
+		case SHR_ASSIGN:
+		case AND_NOT_ASSIGN:
 			smt = new_binary_assignment_smt(p->ast, left, op.type, right);
 			break;
 		case DEFINE:
@@ -370,9 +565,10 @@ Smt *parse_statement(parser *p) {
 			char *name = left->ident.name;
 
 			smt = new_declare_smt(p->ast, new_varible_dcl(p->ast, name, NULL, right));
+			smt->declare->token = left->ident.token;
 	
 			// Added declaration to scope
-			Object *obj =(Object *)malloc(sizeof(Object));
+			Object *obj = (Object *)slab_alloc(p->ast->slab, sizeof(Object));
 			obj->name = name;
 			obj->node = smt->declare;
 			obj->type = varObj;
@@ -391,8 +587,9 @@ Smt *parse_statement(parser *p) {
 		parser_skip_to_semi(p);
 	}
 
-	// Release the converted expression back into the pool
-	pool_release(p->ast->exp_pool, exp);
+	// Release the converted expression back into the pool, other expressions may
+	// be shared when hash consing
+	if (smt != NULL) pool_release(p->ast->exp_pool, exp);
 	
 	return smt;
 }
@@ -408,15 +605,13 @@ Smt *parse_block_smt(parser *p) {
 
 	// build list of statements
 	int smtCount = 0;
-	Smt *smts = (Smt *)malloc(sizeof(Smt) * 1024);
-	Smt *smtsPrt = smts;
+	Smt *smts = NULL;
 	while(p->tokens->type != RBRACE) {
+		smts = slab_realloc(p->ast->slab, smts, sizeof(Smt) * smtCount, sizeof(Smt) * (smtCount + 1));
+		memcpy(smts + smtCount, parse_statement(p), sizeof(Smt));
 		smtCount++;
-		memcpy(smtsPrt, parse_statement(p), sizeof(Smt));
 		if(p->tokens->type != RBRACE) parser_expect_semi(p);
-		smtsPrt++;
 	}
-	smts = realloc(smts, sizeof(Smt) * smtCount);
 
 	parser_expect(p, RBRACE);
 	parser_exit_scope(p);
@@ -425,22 +620,92 @@ Smt *parse_block_smt(parser *p) {
 	return s;
 }
 
+// at_clause_end returns true if the current token ends the statements of a case clause
+bool at_clause_end(parser *p) {
+	TokenType type = p->tokens->type;
+	return type == CASE || type == DEFAULT || type == RBRACE || type == END;
+}
+
+// parse_case_clause parses "case exp, exp:" or "default:" and the statements up to
+// the next clause, the clause is its own scope and may end with fallthrough
+Smt *parse_case_clause(parser *p) {
+	Token keyword = *p->tokens;
+	int expCount = 0;
+	Exp *exps = NULL;
+	if (p->tokens->type == DEFAULT) {
+		parser_next(p);
+	} else {
+		parser_expect(p, CASE);
+		while(true) {
+			Exp *exp = parse_expression(p, 0);
+			if (exp == NULL) {
+				// the error is queued, resync on the colon ending the list or the next clause
+				while(p->tokens->type != COLON && !at_clause_end(p)) parser_next(p);
+				break;
+			}
+			exps = slab_realloc(p->ast->slab, exps, expCount * sizeof(Exp), (expCount + 1) * sizeof(Exp));
+			memcpy(exps + expCount, exp, sizeof(Exp));
+			expCount++;
+
+			if (p->tokens->type != COMMA) break;
+			parser_next(p);
+		}
+	}
+	if (keyword.type == DEFAULT || !at_clause_end(p)) parser_expect(p, COLON);
+	parser_enter_scope(p);
+
+	// build list of statements
+	int smtCount = 0;
+	Smt *smts = NULL;
+	bool fallthrough = false;
+	while(!at_clause_end(p)) {
+		if (p->tokens->type == FALLTHROUGH) {
+			Token *token = p->tokens;
+			parser_next(p);
+			if (p->tokens->type == SEMI) parser_next(p);
+			if (!at_clause_end(p)) new_error(p, parser_error_misplaced_fallthrough, 1)->start = token;
+			fallthrough = true;
+			continue;
+		}
+
+		// a statement with an error has already been skipped up to its semi colon
+		Smt *smt = parse_statement(p);
+		if (smt == NULL) continue;
+		smts = slab_realloc(p->ast->slab, smts, sizeof(Smt) * smtCount, sizeof(Smt) * (smtCount + 1));
+		memcpy(smts + smtCount, smt, sizeof(Smt));
+		smtCount++;
+		if(!at_clause_end(p)) parser_expect_semi(p);
+	}
+
+	parser_exit_scope(p);
+	return new_case_smt(p->ast, keyword, exps, expCount, new_block_smt(p->ast, smts, smtCount), fallthrough);
+}
+
 // smtd parser the current token in the context of the start of a statement
 Smt *smtd(parser *p, Token *token) {
 	switch(token->type) {
 		// return statement
 		case RETURN: {
-			p->tokens++;
-			Smt *s = new_ret_smt(p->ast, parse_expression(p, 0));
+			Token ret = *token;
+			parser_next(p);
+			Smt *s = new_ret_smt(p->ast, ret, parse_expression(p, 0));
 			return s; 
 		}
+		// break or continue statement
+		case BREAK:
+		case CONTINUE: {
+			Token branch = *token;
+			parser_next(p);
+			return new_branch_smt(p->ast, branch);
+		}
+
 		// block statement
 		case LBRACE:
 			return parse_block_smt(p);
 		
 		// if statement
 		case IF: {
-			p->tokens++;
+			parser_next(p);
 			
 			Exp *cond = parse_expression(p, 0);
 			Smt *block = parse_block_smt(p);
@@ -448,7 +713,7 @@ Smt *smtd(parser *p, Token *token) {
 
 			// Check for elseif/else
 			if (p->tokens->type == ELSE) {
-				p->tokens++;
+				parser_next(p);
 				if (p->tokens->type == IF) {
 					// else if, so recursivly parse else chain
 					elses = parse_statement(p);
@@ -462,7 +727,7 @@ Smt *smtd(parser *p, Token *token) {
 		}
 		// for loop
 		case FOR: {
-			p->tokens++;
+			parser_next(p);
 
 			// parse index
 			Dcl *index = parse_variable_dcl(p);
@@ -480,6 +745,25 @@ Smt *smtd(parser *p, Token *token) {
 
 			return new_for_smt(p->ast, index, cond, inc, body);
 		}
+		// switch statement
+		case SWITCH: {
+			parser_next(p);
+
+			Exp *tag = parse_expression(p, 0);
+			parser_expect(p, LBRACE);
+
+			// parse case clauses
+			int clauseCount = 0;
+			Smt *clauses = NULL;
+			while(p->tokens->type == CASE || p->tokens->type == DEFAULT) {
+				clauses = slab_realloc(p->ast->slab, clauses, sizeof(Smt) * clauseCount, sizeof(Smt) * (clauseCount + 1));
+				memcpy(clauses + clauseCount, parse_case_clause(p), sizeof(Smt));
+				clauseCount++;
+			}
+			parser_expect(p, RBRACE);
+
+			return new_switch_smt(p->ast, tag, clauses, clauseCount);
+		}
 		// varible declaration
 		case VAR: {
 			return new_declare_smt(p->ast, parse_variable_dcl(p));
@@ -493,10 +777,10 @@ Smt *smtd(parser *p, Token *token) {
 
 			switch(p->tokens->type) {
 				case INC:
-					p->tokens++;
+					parser_next(p);
 					return new_binary_assignment_smt(p->ast, ident, ADD_ASSIGN, one_literal);
 				case DEC:
-					p->tokens++;
+					parser_next(p);
 					return new_binary_assignment_smt(p->ast, ident, SUB_ASSIGN, one_literal);
 				default:
 					// expression is assigment or declaration so let caller handle it
@@ -581,7 +865,13 @@ Exp *led(parser *p, Token *token, Exp *exp) {
 		case GTR:
 		case LSS:
 		case GEQ:
-		case LEQ: {
+		case LEQ:
+		case AND:
+		case OR:
+		case XOR:
+		case AND_NOT:
+		case SHL:
+		case SHR: {
 			return new_binary_exp(p->ast, exp, *token, parse_expression(p, bp));
 		}
 
@@ -606,13 +896,13 @@ Exp *led(parser *p, Token *token, Exp *exp) {
 		// call expression
 		case LPAREN: {
 			int argCount = 0;
-			Exp *args = (Exp *)malloc(0);
+			Exp *args = NULL;
 			if(p->tokens->type != RPAREN) {
 				// arguments are not empty so parse arguments
 				while(true) {
+					args = slab_realloc(p->ast->slab, args, argCount * sizeof(Exp), (argCount + 1) * sizeof(Exp));
 					argCount++;
 					
-					args = realloc(args, argCount * sizeof(Exp));
 					Exp *arg = parse_expression(p, 0);
 					memcpy(args + argCount - 1, arg, sizeof(Exp));
 					
@@ -634,9 +924,14 @@ Exp *led(parser *p, Token *token, Exp *exp) {
 		case ADD_ASSIGN:
 		case SUB_ASSIGN:
 		case MUL_ASSIGN:
+		case QUO_ASSIGN:
 		case REM_ASSIGN:
+		case AND_ASSIGN:
 		case OR_ASSIGN:
-		case SHL_ASSIGN: 
+		case XOR_ASSIGN:
+		case SHL_ASSIGN:
+		case SHR_ASSIGN:
+		case AND_NOT_ASSIGN:
 		case DEFINE: {
 			return new_binary_exp(p->ast, exp, *token, parse_expression(p, bp - 1));	
 		}
@@ -658,7 +953,7 @@ Exp *parse_key_value_exp(parser *p) {
 	
 	if (p->tokens->type == COLON) {
 		// Key/value belongs to structure expression
-		p->tokens++;
+		parser_next(p);
 		key = keyOrVal;
 		value = parse_expression(p, 0);
 	} else {
@@ -671,11 +966,11 @@ Exp *parse_key_value_exp(parser *p) {
 
 Exp *parse_key_value_list_exp(parser *p) {
 	int keyCount = 0;
-	Exp *values = malloc(0);
+	Exp *values = NULL;
 
 	while(p->tokens->type != RBRACE) {
+		values = slab_realloc(p->ast->slab, values, keyCount * sizeof(Exp), (keyCount + 1) * sizeof(Exp));
 		keyCount++;
-		values = realloc(values, keyCount * sizeof(Exp));
 		Exp *keyValue = parse_key_value_exp(p);
 		memcpy(values + keyCount - 1, keyValue, sizeof(Exp));
 		
@@ -687,9 +982,10 @@ Exp *parse_key_value_list_exp(parser *p) {
 
 Exp *parse_array_exp(parser *p) {
 	int valueCount = 0;
-	Exp *values = malloc(0);
+	Exp *values = NULL;
 	while(p->tokens->type != RBRACK) {
-		values = realloc(values, (++valueCount) * sizeof(Exp));
+		values = slab_realloc(p->ast->slab, values, valueCount * sizeof(Exp), (valueCount + 1) * sizeof(Exp));
+		valueCount++;
 		Exp *value = parse_expression(p, 0);
 		memcpy(values + valueCount - 1, value, sizeof(Exp));
 		if (p->tokens->type != RBRACK) parser_expect(p, COMMA);
@@ -711,7 +1007,7 @@ Exp *parse_type(parser *p) {
 
 	if(p->tokens->type == LBRACK) {
 		// Type is an array type
-		p->tokens++;
+		parser_next(p);
 		Exp *length = parse_expression(p, 0);
 		if(length == NULL) {
 			new_error(p, parser_error_expect_array_length, 1);
@@ -732,12 +1028,8 @@ Exp *parse_ident_exp_from_token(parser *p, Token *token) {
 		return NULL;
 	}
 
-	char *name = token->value;
-	Exp *ident = new_ident_exp(p->ast, name);
-	Object *obj = parser_find_scope(p, name);
-	ident->ident.obj = obj;
-	
-	return ident;
+	Object *obj = parser_find_scope(p, token->value);
+	return new_ident_exp(p->ast, *token, obj);
 }
 
 Exp *parse_ident_exp(parser *p) {
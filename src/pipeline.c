@@ -0,0 +1,178 @@
+#include "includes/pipeline.h"
+
+// pipeline_lex is the lexer threads entry point
+void *pipeline_lex(void *arg) {
+    pipeline *pl = arg;
+    pl->token_slab = new_slab();
+    // the token values live in the slab and are referenced by the ast, so it is
+    // kept for the life of the program like the sequential drivers token slab
+    LexQueue(pl->source, pl->token_slab, pl->token_queue);
+    return NULL;
+}
+
+// pipeline_parse is the parser threads entry point
+void *pipeline_parse(void *arg) {
+    pipeline *pl = arg;
+    parser *p = new_stream_parser(pl->token_queue, LexMaxTokens(pl->source));
+    if (pl->share_exps) ast_unit_enable_hash_consing(p->ast);
+    p->dcl_queue = pl->dcl_queue;
+    parse_file(p);
+
+    // give the ast back to the thread that joins this one
+    ast_unit_handoff(p->ast);
+    pl->parser = p;
+    return NULL;
+}
+
+// pipeline_name_of finds the entry for name, adding an undeclared one the first
+// time name is seen
+pipeline_name *pipeline_name_of(pipeline *pl, char *name) {
+    pipeline_name *n;
+    HASH_FIND_STR(pl->names, name, n);
+    if (n != NULL) return n;
+
+    n = malloc(sizeof(pipeline_name));
+    n->name = name;
+    n->dcl = NULL;
+    n->users = NULL;
+    n->userCount = 0;
+    HASH_ADD_KEYPTR(hh, pl->names, n->name, strlen(name), n);
+    return n;
+}
+
+// pipeline_dcl_name returns the top level name d declares
+char *pipeline_dcl_name(Dcl *d) {
+    return d->type == functionDcl ? d->function.name : d->varible.name;
+}
+
+// pipeline_try_compile compiles pd once it and every declaration it uses have been
+// checked, nothing more is compiled after the first error
+void pipeline_try_compile(pipeline *pl, pipeline_dcl *pd) {
+    if (pd->compiled || !pd->checked || pd->unchecked > 0 || pl->errors > 0) return;
+    CompileFunction(pl->irgen, pd->dcl);
+    pd->compiled = true;
+}
+
+// pipeline_check type checks pd once every name it uses is declared, then compiles
+// whatever was only waiting for pd to be checked
+void pipeline_check(pipeline *pl, pipeline_dcl *pd) {
+    if (pd->checked || pd->undeclared > 0) return;
+    pl->errors += CheckDcl(pl->checker, pd->dcl);
+    pd->checked = true;
+
+    pipeline_name *n = pipeline_name_of(pl, pipeline_dcl_name(pd->dcl));
+    if (n->dcl == pd) {
+        for (int i = 0; i < n->userCount; i++) {
+            n->users[i]->unchecked--;
+            pipeline_try_compile(pl, n->users[i]);
+        }
+    }
+    pipeline_try_compile(pl, pd);
+}
+
+// pipeline_receive declares a declaration from the parser and records the names it
+// uses, so it is only visited again when one of those is declared or checked instead
+// of being resolved again for every later declaration
+pipeline_dcl *pipeline_receive(pipeline *pl, Dcl *d, queue *used) {
+    pl->errors += DeclareGlobal(pl->checker, d);
+    pipeline_dcl *pd = malloc(sizeof(pipeline_dcl));
+    pd->dcl = d;
+    pd->undeclared = 0;
+    pd->unchecked = 0;
+    pd->checked = false;
+    pd->compiled = false;
+
+    // the users of the name now wait for d to be checked instead of declared, the
+    // ones that arent missing any other name can be bound
+    pipeline_name *n = pipeline_name_of(pl, pipeline_dcl_name(d));
+    if (n->dcl == NULL) {
+        n->dcl = pd;
+        for (int i = 0; i < n->userCount; i++) {
+            pipeline_dcl *user = n->users[i];
+            user->unchecked++;
+            if (--user->undeclared == 0) ResolveDcl(pl->checker, user->dcl, false);
+        }
+    }
+
+    pl->checker->names = used;
+    ResolveDcl(pl->checker, d, false);
+    pl->checker->names = NULL;
+    char **name;
+    while ((name = queue_pop_front(used)) != NULL) {
+        pipeline_name *use = pipeline_name_of(pl, *name);
+        queue_free_item(name);
+
+        // d's names are added together, so a repeated name has d as its last user
+        if (use->userCount > 0 && use->users[use->userCount - 1] == pd) continue;
+        use->users = realloc(use->users, (use->userCount + 1) * sizeof(pipeline_dcl *));
+        use->users[use->userCount++] = pd;
+        if (use->dcl == NULL) pd->undeclared++;
+        else if (!use->dcl->checked) pd->unchecked++;
+    }
+
+    if (n->dcl == pd) {
+        for (int i = 0; i < n->userCount; i++) {
+            pipeline_check(pl, n->users[i]);
+        }
+    }
+    pipeline_check(pl, pd);
+    return pd;
+}
+
+// pipeline_compile lexes, parses, type checks and compiles source into irgen's module,
+// returning the ast which is owned by the calling thread. Parse errors are left in
+// pl->parser and type errors in checker, either stops any further declarations
+// being compiled.
+ast_unit *pipeline_compile(pipeline *pl, char *source, Irgen *irgen, Checker *checker, bool share_exps) {
+    pl->source = source;
+    pl->share_exps = share_exps;
+    pl->token_queue = new_spsc_queue(sizeof(Token), PIPELINE_TOKEN_QUEUE_SIZE);
+    pl->dcl_queue = new_spsc_queue(sizeof(Dcl *), PIPELINE_DCL_QUEUE_SIZE);
+    pl->irgen = irgen;
+    pl->checker = checker;
+    pl->names = NULL;
+    pl->errors = 0;
+
+    pthread_create(&pl->lexer_thread, NULL, pipeline_lex, pl);
+    pthread_create(&pl->parser_thread, NULL, pipeline_parse, pl);
+
+    // check and compile declarations as the parser finishes them. A declaration that
+    // uses one the parser hasnt reached yet waits until that is declared before it is
+    // checked, and until that is checked before it is compiled.
+    Dcl *d;
+    pipeline_dcl **received = NULL;
+    int receivedCount = 0;
+    queue *used = new_queue(sizeof(char *));
+    while (spsc_queue_pop(pl->dcl_queue, &d)) {
+        received = realloc(received, (receivedCount + 1) * sizeof(pipeline_dcl *));
+        received[receivedCount++] = pipeline_receive(pl, d, used);
+    }
+    queue_destroy(used);
+
+    pthread_join(pl->lexer_thread, NULL);
+    pthread_join(pl->parser_thread, NULL);
+    ast_unit_adopt(pl->parser->ast);
+    spsc_queue_destroy(pl->token_queue);
+    spsc_queue_destroy(pl->dcl_queue);
+
+    // anything still waiting uses a name that is never declared, unless the parser
+    // stopped sending declarations because of an error
+    bool parsed = queue_size(pl->parser->error_queue) == 0;
+    for (int i = 0; i < receivedCount; i++) {
+        if (parsed && received[i]->undeclared > 0) {
+            pl->errors += ResolveDcl(checker, received[i]->dcl, true);
+            pl->errors += CheckDcl(checker, received[i]->dcl);
+        }
+        free(received[i]);
+    }
+    free(received);
+
+    pipeline_name *n, *tmp;
+    HASH_ITER(hh, pl->names, n, tmp) {
+        HASH_DEL(pl->names, n);
+        free(n->users);
+        free(n);
+    }
+
+    return pl->parser->ast;
+}
@@ -1,31 +1,112 @@
 #include "includes/pool.h"
+#include <sys/mman.h>
+
+pool_page_mode pool_current_page_mode = pool_pages_default;
+
+// pool_set_page_mode sets how large chunks are backed
+void pool_set_page_mode(pool_page_mode mode) {
+    pool_current_page_mode = mode;
+}
+
+// pool_get_page_mode gets how large chunks are backed
+pool_page_mode pool_get_page_mode() {
+    return pool_current_page_mode;
+}
+
+// pool_map_huge maps size bytes aligned to a huge page boundary, returns NULL on failure
+void *pool_map_huge(size_t size, pool_page_mode mode) {
+    if (mode == pool_pages_explicit) {
+        void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (memory != MAP_FAILED) return memory;
+        // no huge pages reserved, fall back to transparent huge pages
+    }
+
+    // over map so the chunk can start on a huge page boundary, then trim the ends
+    size_t mapped = size + POOL_HUGE_PAGE_SIZE;
+    char *memory = mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) return NULL;
+
+    char *aligned = (char *)(((size_t)memory + POOL_HUGE_PAGE_SIZE - 1) & ~((size_t)POOL_HUGE_PAGE_SIZE - 1));
+    if (aligned > memory) munmap(memory, aligned - memory);
+    size_t tail = (memory + mapped) - (aligned + size);
+    if (tail > 0) munmap(aligned + size, tail);
+
+    // advisory only, the kernel may have transparent huge pages disabled
+    madvise(aligned, size, MADV_HUGEPAGE);
+    return aligned;
+}
+
+// pool_alloc_chunk allocates the memory for a chunk of size bytes, using huge pages
+// for large chunks when enabled
+pool_chunk *pool_alloc_chunk(size_t size) {
+    if (pool_current_page_mode != pool_pages_default && size >= POOL_HUGE_PAGE_SIZE) {
+        size_t mapped_size = (size + POOL_HUGE_PAGE_SIZE - 1) & ~((size_t)POOL_HUGE_PAGE_SIZE - 1);
+        pool_chunk *chunk = pool_map_huge(mapped_size, pool_current_page_mode);
+        if (chunk != NULL) {
+            chunk->mapped_size = mapped_size;
+            return chunk;
+        }
+        // mapping failed so fall back to malloc
+    }
+
+    pool_chunk *chunk = malloc(size);
+    assert(chunk != NULL);
+    chunk->mapped_size = 0;
+    return chunk;
+}
+
+// pool_free_chunk frees a chunk allocated with pool_alloc_chunk
+void pool_free_chunk(pool_chunk *chunk) {
+    if (chunk->mapped_size > 0) {
+        munmap(chunk, chunk->mapped_size);
+    } else {
+        free(chunk);
+    }
+}
+
+// pool_new_chunk allocates a chunk of element_count elements and links them into a free list
+pool_chunk *pool_new_chunk(size_t element_size, int element_count, pool_element **first, pool_element **last) {
+    pool_chunk *chunk = pool_alloc_chunk(sizeof(pool_chunk) + element_size * element_count);
+    chunk->next = NULL;
+    chunk->element_count = element_count;
 
-// new_pool creates a new pool
-pool *new_pool(size_t element_size, int element_count) {
-    // allocate space for elements + free list
-    element_size = element_size + sizeof(pool_element);
-    void *pool_memory = malloc(element_size * element_count);
-    
     // set up the free list
-    pool_element *last_element = pool_memory;
+    void *chunk_memory = chunk + 1;
+    pool_element *last_element = chunk_memory;
     for(int i = 0; i < element_count; i++) {
-        pool_element *element = pool_memory + i * element_size;
+        pool_element *element = chunk_memory + i * element_size;
         last_element->next = element;
         last_element = element;
     }
     last_element->next = NULL;
-    
+
+    *first = chunk_memory;
+    *last = last_element;
+    return chunk;
+}
+
+// new_pool creates a new pool owned by the calling thread
+pool *new_pool(size_t element_size, int element_count) {
+    // allocate space for elements + free list, keeping the free list pointer aligned
+    element_size = element_size + sizeof(pool_element);
+    element_size = (element_size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
     // construct the pool data
     pool *p = malloc(sizeof(pool));
-    p->pool_memory = pool_memory; 
     p->element_size = element_size;
     p->element_count = element_count;
-    p->head = pool_memory;
-    p->tail = last_element;
-    
+    p->chunks = pool_new_chunk(element_size, element_count, &p->head, &p->tail);
+    p->owner = pthread_self();
+    p->owned = true;
+
     return p;
 }
 
+// pool_is_owner returns true if the calling thread owns the pool
+bool pool_is_owner(pool *p) {
+    return p->owned && pthread_equal(p->owner, pthread_self());
+}
+
 // pool_full returns true if the pool is full
 bool pool_full(pool *p) {
     return p->head == NULL;
@@ -39,7 +120,7 @@ int pool_size(pool *p) {
 // pool_count returns the amount of elements in the pool
 int pool_count(pool *p) {
     // if the pool is full no need to look at free list
-    if(pool_full(p)) return p->element_count; 
+    if(pool_full(p)) return p->element_count;
 
     // count the amount of elements in the free list
     int free_count = 0;
@@ -53,48 +134,19 @@ int pool_count(pool *p) {
     return p->element_count - free_count;
 }
 
-// pool_extend extends the size of the pool
+// pool_extend extends the size of the pool by adding a new chunk, existing elements
+// are not moved.
 void pool_extend(pool *p, int new_count) {
     assert(new_count > p->element_count);
-    int old_count = p->element_count;
-    p->element_count = new_count;
 
-    bool is_full = pool_full(p);
-
-    // get the head/tail offset
-    void *old_memory = p->pool_memory;
-    int head_offset = (char *)p->head - (char *)p->pool_memory;
-    int tail_offset = (char *)p->tail - (char *)p->pool_memory;
-    
-    // extend the pool memory
-    p->pool_memory = realloc(p->pool_memory, p->element_size * p->element_count);
-    assert(p->pool_memory != NULL);
-    
-    // restore the head/tail
-    p->head = (pool_element *)((char *)p->pool_memory + head_offset);
-    p->tail = (pool_element *)((char *)p->pool_memory + tail_offset);
-    
-    // restore the pointers in the free list
-    if(!is_full) {
-        pool_element *ptr = p->head;
-        while(ptr != p->tail) {
-            ptr->next = p->pool_memory + ((void *)ptr->next - old_memory);
-            ptr = ptr->next;
-        }
-    }
+    // allocate a chunk for the new elements
+    pool_element *first_new, *last_new;
+    pool_chunk *chunk = pool_new_chunk(p->element_size, new_count - p->element_count, &first_new, &last_new);
+    chunk->next = p->chunks;
+    p->chunks = chunk;
+    p->element_count = new_count;
 
-    // get the first new element
-    pool_element *first_new = p->pool_memory + (p->element_size * old_count);
-    
-    // set up a free list for the new elements
-    pool_element *last_element = first_new;
-    for(int i = old_count; i < p->element_count; i++) {
-        pool_element *element = p->pool_memory + i * p->element_size;
-        last_element->next = element;
-        last_element = element;
-    }
-    
-    if(is_full) {
+    if(pool_full(p)) {
         // set the head to the new free list
         p->head = first_new;
     } else {
@@ -102,32 +154,45 @@ void pool_extend(pool *p, int new_count) {
         p->tail->next = first_new;
     }
 
-    p->tail = last_element;
+    p->tail = last_new;
 }
 
 // pool_get gets a new element from the pool, increasing the pools size if its full.
 void *pool_get(pool *p) {
+    ASSERT(pool_is_owner(p), "Pool used by a thread that does not own it");
     if (pool_full(p)) pool_extend(p, p->element_count * 2);
     pool_element *element = p->head;
     p->head = p->head->next;
     return element + 1;
 }
 
+// pool_contains returns true if element was allocated from the pool
+bool pool_contains(pool *p, void *element) {
+    for(pool_chunk *chunk = p->chunks; chunk != NULL; chunk = chunk->next) {
+        void *start = chunk + 1;
+        void *end = start + chunk->element_count * p->element_size;
+        if(element > start && element < end) return true;
+    }
+
+    return false;
+}
+
 // pool_release releases element back into pool to be reused
 void pool_release(pool *p, void *element) {
+    ASSERT(pool_is_owner(p), "Pool used by a thread that does not own it");
+
     // Check element is within bounds
-    assert(element > p->pool_memory);
-    assert(element < p->pool_memory + p->element_count * p->element_size);
-    
+    assert(pool_contains(p, element));
+
     // Move pointer back to free list data
     pool_element *list_element = element;
     list_element--;
 
     // Add to free list
+    list_element->next = NULL;
     if (pool_full(p)) {
         // Free list is empty so start a new free list
         p->head = list_element;
-        p->head->next = NULL;
         p->tail = p->head;
     } else {
         // Append to free list
@@ -136,7 +201,28 @@ void pool_release(pool *p, void *element) {
     }
 }
 
+// pool_handoff gives up ownership of the pool so it can be passed to another thread.
+// The pool must be passed through something that synchronizes the two threads
+// (thread join, mutex, channel) before the other thread adopts it.
+void pool_handoff(pool *p) {
+    ASSERT(pool_is_owner(p), "Only the owner can hand off a pool");
+    p->owned = false;
+}
+
+// pool_adopt makes the calling thread the owner of a pool that was handed off
+void pool_adopt(pool *p) {
+    ASSERT(!p->owned, "Cannot adopt a pool that has not been handed off");
+    p->owner = pthread_self();
+    p->owned = true;
+}
+
 // pool_destroy frees the pools memory
 void pool_destroy(pool *p) {
-    free(p->pool_memory);
+    pool_chunk *chunk = p->chunks;
+    while(chunk != NULL) {
+        pool_chunk *next = chunk->next;
+        pool_free_chunk(chunk);
+        chunk = next;
+    }
+    p->chunks = NULL;
 }
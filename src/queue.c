@@ -1,9 +1,26 @@
 #include "includes/queue.h"
 
+#define QUEUE_POOL_ELEMENTS 16
+
+// queue_new_item gets an item from the free list, or from the pool when no items are free
+queue_item *queue_new_item(queue *q) {
+    queue_item *q_item = q->free_items;
+    if (q_item != NULL) {
+        q->free_items = q_item->next;
+        return q_item;
+    }
+
+    q_item = pool_get(q->item_pool);
+    q_item->queue = q;
+    return q_item;
+}
+
 queue *new_queue(size_t element_size) {
     queue *q = malloc(sizeof(queue));
     element_size += sizeof(queue_item);
     q->element_size = element_size;
+    q->item_pool = new_pool(element_size, QUEUE_POOL_ELEMENTS);
+    q->free_items = NULL;
     q->first = NULL;
     q->last = NULL;
     q->size = 0;
@@ -16,7 +33,7 @@ int queue_size(queue *q) {
 
 void *queue_push_front(queue *q) {
     q->size++;
-    queue_item *q_item = malloc(q->element_size);
+    queue_item *q_item = queue_new_item(q);
     
     q_item->prev = NULL;
     if (q->first == NULL) {
@@ -33,7 +50,7 @@ void *queue_push_front(queue *q) {
 
 void *queue_push_back(queue *q) {
     q->size++;
-    queue_item *q_item = malloc(q->element_size);
+    queue_item *q_item = queue_new_item(q);
     
     q_item->next = NULL;
     if(q->first == NULL) {
@@ -53,8 +70,8 @@ void *queue_pop_front(queue *q) {
     q->size--;
     queue_item *q_item = q->first;
     if (q->first == q->last) q->last = NULL;
-    q->first->prev = NULL;
     q->first = q->first->next;
+    if (q->first != NULL) q->first->prev = NULL; // popped item may be reused
     return q_item + 1; // move past item header
 }
 
@@ -63,20 +80,27 @@ void *queue_pop_back(queue *q) {
     q->size--;
     queue_item *q_item = q->last;
     if (q->last == q->first) q->first = NULL;
-    q->last->next = NULL;
     q->last = q->last->prev;
+    if (q->last != NULL) q->last->next = NULL; // popped item may be reused
     return q_item + 1; // move past item header
 }
 
+// queue_free_item releases a popped item back to the queue it came from
 void queue_free_item(void *item) {
     queue_item *q_item = item;
-    free(q_item - 1);
+    q_item--;
+    q_item->next = q_item->queue->free_items;
+    q_item->queue->free_items = q_item;
 }
 
+// queue_destroy frees every item of the queue, including popped items that
+// have not been freed
 void queue_destroy(queue *q) {
-    while(q->first != NULL) {
-        queue_item *next = q->first->next;
-        free(q->first);
-        q->first = next;
-    }
+    pool_destroy(q->item_pool);
+    free(q->item_pool);
+    q->item_pool = NULL;
+    q->free_items = NULL;
+    q->first = NULL;
+    q->last = NULL;
+    q->size = 0;
 }
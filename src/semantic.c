@@ -0,0 +1,918 @@
+#include "includes/lexer.h"
+#include "includes/semantic.h"
+#include "includes/parser.h"
+
+// NewChecker creates a checker that resolves types through types
+Checker *NewChecker(TypeTable *types) {
+    Checker *c = malloc(sizeof(Checker));
+    c->types = types;
+    c->globals = NULL;
+    c->returnType = NULL;
+    c->loops = 0;
+    c->switches = 0;
+    c->names = NULL;
+    c->errors = new_queue(sizeof(CheckError));
+    return c;
+}
+
+// ExpToken finds a token inside e to locate an error at, returns NULL if e has none
+Token *ExpToken(Exp *e) {
+    switch(e->type) {
+        case identExp:
+            return &e->ident.token;
+        case literalExp:
+            return &e->literal;
+        case unaryExp:
+            return &e->unary.op;
+        case binaryExp:
+            return &e->binary.op;
+        case indexExp: {
+            Token *token = ExpToken(e->index.index);
+            return token != NULL ? token : ExpToken(e->index.exp);
+        }
+        case callExp:
+            for (int i = 0; i < e->call.argCount; i++) {
+                Token *token = ExpToken(e->call.args + i);
+                if (token != NULL) return token;
+            }
+            return NULL;
+        case arrayExp:
+            return e->array.valueCount > 0 ? ExpToken(e->array.values) : NULL;
+        default:
+            return NULL;
+    }
+}
+
+// NewCheckErrorAt adds an error located at token (which may be NULL) to the checker,
+// the caller appends the message
+CheckError *NewCheckErrorAt(Checker *c, Token *token) {
+    CheckError *error = queue_push_back(c->errors);
+    error->message = string_new_capacity(64);
+    error->line = 0;
+    error->column = 0;
+    error->length = 0;
+
+    if (token != NULL && token->line > 0) {
+        error->line = token->line;
+        error->column = token->column;
+        error->length = strlen(token_text(token));
+    }
+    return error;
+}
+
+// NewCheckError adds an error located at e (which may be NULL) to the checker, the
+// caller appends the message
+CheckError *NewCheckError(Checker *c, Exp *e) {
+    return NewCheckErrorAt(c, e != NULL ? ExpToken(e) : NULL);
+}
+
+// DeclareGlobal adds the top level declaration d to the symbol table, returns the
+// amount of errors (1 if the name is already declared)
+int DeclareGlobal(Checker *c, Dcl *d) {
+    char *name = d->type == functionDcl ? d->function.name : d->varible.name;
+    if (LookupGlobal(c, name) != NULL) {
+        CheckError *error = NewCheckErrorAt(c, &d->token);
+        error->message = string_append_format(error->message, "'%s' redeclared", name);
+        return 1;
+    }
+
+    Symbol *symbol = malloc(sizeof(Symbol));
+    symbol->obj.name = name;
+    symbol->obj.node = d;
+    symbol->obj.type = d->type == functionDcl ? funcObj : varObj;
+    HASH_ADD_KEYPTR(hh, c->globals, symbol->obj.name, strlen(name), symbol);
+    return 0;
+}
+
+// LookupGlobal finds a top level declaration, returns NULL if there is none called name
+Object *LookupGlobal(Checker *c, char *name) {
+    Symbol *symbol;
+    HASH_FIND_STR(c->globals, name, symbol);
+    return symbol != NULL ? &symbol->obj : NULL;
+}
+
+// ResolveExp binds the unbound identifiers in e to top level declarations, returns
+// the amount of names that are not declared (reported if report is set)
+int ResolveExp(Checker *c, Exp *e, bool report) {
+    switch(e->type) {
+        case identExp: {
+            char *name = e->ident.name;
+            if (e->ident.obj != NULL || strcmp(name, "true") == 0 || strcmp(name, "false") == 0) return 0;
+
+            if (c->names != NULL) *(char **)queue_push_back(c->names) = name;
+            e->ident.obj = LookupGlobal(c, name);
+            if (e->ident.obj != NULL) return 0;
+            if (report) {
+                CheckError *error = NewCheckError(c, e);
+                error->message = string_append_format(error->message, "undeclared name '%s'", name);
+            }
+            return 1;
+        }
+        case unaryExp:
+            return ResolveExp(c, e->unary.right, report);
+        case binaryExp:
+            return ResolveExp(c, e->binary.left, report) + ResolveExp(c, e->binary.right, report);
+        case indexExp:
+            return ResolveExp(c, e->index.exp, report) + ResolveExp(c, e->index.index, report);
+        case callExp: {
+            int unresolved = ResolveExp(c, e->call.function, report);
+            for (int i = 0; i < e->call.argCount; i++) {
+                unresolved += ResolveExp(c, e->call.args + i, report);
+            }
+            return unresolved;
+        }
+        case arrayExp: {
+            int unresolved = 0;
+            for (int i = 0; i < e->array.valueCount; i++) {
+                unresolved += ResolveExp(c, e->array.values + i, report);
+            }
+            return unresolved;
+        }
+        default:
+            return 0;
+    }
+}
+
+int ResolveSmt(Checker *c, Smt *s, bool report) {
+    int unresolved = 0;
+    switch(s->type) {
+        case declareSmt:
+            return ResolveDcl(c, s->declare, report);
+        case assignmentSmt:
+            return ResolveExp(c, s->assignment.left, report) + ResolveExp(c, s->assignment.right, report);
+        case returnSmt:
+            return s->ret.result != NULL ? ResolveExp(c, s->ret.result, report) : 0;
+        case blockSmt:
+            for (int i = 0; i < s->block.count; i++) {
+                unresolved += ResolveSmt(c, s->block.smts + i, report);
+            }
+            return unresolved;
+        case ifSmt:
+            if (s->ifs.cond != NULL) unresolved += ResolveExp(c, s->ifs.cond, report);
+            unresolved += ResolveSmt(c, s->ifs.body, report);
+            if (s->ifs.elses != NULL) unresolved += ResolveSmt(c, s->ifs.elses, report);
+            return unresolved;
+        case forSmt:
+            if (s->fors.index != NULL) unresolved += ResolveDcl(c, s->fors.index, report);
+            if (s->fors.cond != NULL) unresolved += ResolveExp(c, s->fors.cond, report);
+            if (s->fors.inc != NULL) unresolved += ResolveSmt(c, s->fors.inc, report);
+            return unresolved + ResolveSmt(c, s->fors.body, report);
+        case switchSmt:
+            unresolved += ResolveExp(c, s->switchs.tag, report);
+            for (int i = 0; i < s->switchs.clauseCount; i++) {
+                unresolved += ResolveSmt(c, s->switchs.clauses + i, report);
+            }
+            return unresolved;
+        case caseSmt:
+            for (int i = 0; i < s->cases.expCount; i++) {
+                unresolved += ResolveExp(c, s->cases.exps + i, report);
+            }
+            return unresolved + ResolveSmt(c, s->cases.body, report);
+        case branchSmt:
+            return 0;
+    }
+
+    return unresolved;
+}
+
+// ResolveDcl binds the identifiers in d the parser couldnt, which are the names of
+// top level declarations. Returns the amount of names that are not declared yet,
+// reporting them as errors if report is set. Can be called again once more
+// declarations are in the symbol table.
+int ResolveDcl(Checker *c, Dcl *d, bool report) {
+    switch(d->type) {
+        case functionDcl:
+            return ResolveSmt(c, d->function.body, report);
+        case argumentDcl:
+            return 0;
+        case varibleDcl:
+            return ResolveExp(c, d->varible.value, report);
+    }
+
+    return 0;
+}
+
+// CheckTypeMismatch reports that the operands of a binary expression cant be combined
+void CheckTypeMismatch(Checker *c, Exp *e, Type *left, Type *right) {
+    CheckError *error = NewCheckError(c, e);
+    error->message = string_append_cstring(error->message, "mismatched types ");
+    error->message = AppendTypeName(error->message, left);
+    error->message = string_append_cstring(error->message, " and ");
+    error->message = AppendTypeName(error->message, right);
+    error->message = string_append_format(error->message, " for '%s'", TokenName(e->binary.op.type));
+}
+
+// CheckOperator reports that op is not defined on operands of type
+void CheckOperator(Checker *c, Exp *e, Token op, Type *type) {
+    CheckError *error = NewCheckError(c, e);
+    error->message = string_append_format(error->message, "operator '%s' is not defined on ", TokenName(op.type));
+    error->message = AppendTypeName(error->message, type);
+}
+
+// CheckConversion reports an error if value, of type from, cant be used where a target
+// is expected. Array literals take the target type when their elements convert.
+void CheckConversion(Checker *c, Exp *value, Type *from, Type *target) {
+    if (from == NULL || target == NULL) return;
+    if (IsConvertible(from, target)) return;
+
+    if (value->type == arrayExp && from->kind == ArrayType && target->kind == ArrayType &&
+        from->array.length == target->array.length &&
+        IsConvertible(from->array.element, target->array.element)) {
+        value->resolvedType = target;
+        return;
+    }
+
+    CheckError *error = NewCheckError(c, value);
+    error->message = string_append_cstring(error->message, "cannot use ");
+    error->message = AppendTypeName(error->message, from);
+    error->message = string_append_cstring(error->message, " as ");
+    error->message = AppendTypeName(error->message, target);
+}
+
+// CheckCondition reports an error if cond is not a bool
+void CheckCondition(Checker *c, Exp *cond) {
+    Type *type = CheckExp(c, cond);
+    if (type == NULL || type->kind == BoolType) return;
+
+    CheckError *error = NewCheckError(c, cond);
+    error->message = string_append_cstring(error->message, "condition must be a bool but got ");
+    error->message = AppendTypeName(error->message, type);
+}
+
+// CheckType returns the type named by the type expression e, reporting an error if
+// e does not name a type
+Type *CheckType(Checker *c, Exp *e) {
+    Type *type = LookupType(c->types, e);
+    if (type != NULL) return type;
+
+    // report a bad element type on its own
+    if (e->type == arrayTypeExp && LookupType(c->types, e->arrayType.type) == NULL) {
+        return CheckType(c, e->arrayType.type);
+    }
+
+    CheckError *error = NewCheckError(c, e);
+    switch(e->type) {
+        case identExp:
+            error->message = string_append_format(error->message, "unknown type '%s'", e->ident.name);
+            break;
+        case arrayTypeExp:
+            error->message = string_append_cstring(error->message, "array length must be an integer literal");
+            break;
+        default:
+            error->message = string_append_cstring(error->message, "expected a type");
+            break;
+    }
+    return NULL;
+}
+
+// TypeOfDcl returns the type of the value declared by d, for functions this is
+// the return type. Returns NULL if the declaration has a type error.
+Type *TypeOfDcl(Checker *c, Dcl *d) {
+    switch(d->type) {
+        case varibleDcl: {
+            if (d->varible.type != NULL) return LookupType(c->types, d->varible.type);
+            Type *type = d->varible.value->resolvedType;
+            return type != NULL ? DefaultType(c->types, type) : NULL;
+        }
+        case argumentDcl:
+            return LookupType(c->types, d->argument.type);
+        case functionDcl:
+            return d->function.returnType != NULL ? LookupType(c->types, d->function.returnType) : NULL;
+    }
+
+    return NULL;
+}
+
+Type *CheckIdentExp(Checker *c, Exp *e) {
+    char *name = e->ident.name;
+    if (e->ident.obj == NULL) {
+        if (strcmp(name, "true") == 0 || strcmp(name, "false") == 0) return c->types->boolean;
+
+        // undeclared, reported by the resolution pass
+        return NULL;
+    }
+
+    Dcl *dcl = e->ident.obj->node;
+    if (dcl->type == functionDcl) {
+        CheckError *error = NewCheckError(c, e);
+        error->message = string_append_format(error->message, "function '%s' used as a value", name);
+        return NULL;
+    }
+
+    return TypeOfDcl(c, dcl);
+}
+
+Type *CheckLiteralExp(Checker *c, Exp *e) {
+    switch(e->literal.type) {
+        case INT:
+        case HEX:
+        case OCTAL:
+            return c->types->untypedInt;
+        case FLOAT:
+            return c->types->untypedFloat;
+        default: {
+            CheckError *error = NewCheckError(c, e);
+            error->message = string_append_cstring(error->message, "string literals are not supported");
+            return NULL;
+        }
+    }
+}
+
+Type *CheckUnaryExp(Checker *c, Exp *e) {
+    Type *type = CheckExp(c, e->unary.right);
+    if (type == NULL) return NULL;
+
+    switch(e->unary.op.type) {
+        case ADD:
+        case SUB:
+            if (!IsScalarType(type) || type->kind == BoolType) {
+                CheckOperator(c, e, e->unary.op, type);
+                return NULL;
+            }
+            return type;
+        default: {
+            CheckError *error = NewCheckError(c, e);
+            error->message = string_append_format(error->message, "unary operator '%s' is not supported",
+                TokenName(e->unary.op.type));
+            return NULL;
+        }
+    }
+}
+
+Type *CheckBinaryExp(Checker *c, Exp *e) {
+    Type *left = CheckExp(c, e->binary.left);
+    Type *right = CheckExp(c, e->binary.right);
+    if (left == NULL || right == NULL) return NULL;
+
+    TokenType op = e->binary.op.type;
+    switch(op) {
+        case ADD:
+        case SUB:
+        case MUL:
+        case QUO:
+        case REM:
+        case LSS:
+        case LEQ:
+        case GTR:
+        case GEQ:
+        case EQL:
+        case NEQ:
+        case LAND:
+        case LOR:
+        case AND:
+        case OR:
+        case XOR:
+        case AND_NOT:
+        case SHL:
+        case SHR:
+            break;
+        default: {
+            CheckError *error = NewCheckError(c, e);
+            error->message = string_append_format(error->message, "operator '%s' is not supported", TokenName(op));
+            return NULL;
+        }
+    }
+
+    Type *operand;
+    if (op == SHL || op == SHR) {
+        operand = ShiftType(c->types, left, right);
+    } else {
+        operand = UnifyTypes(c->types, left, right);
+    }
+    if (operand == NULL) {
+        CheckTypeMismatch(c, e, left, right);
+        return NULL;
+    }
+
+    switch(op) {
+        // logical operators only combine bools
+        case LAND:
+        case LOR:
+            if (operand->kind != BoolType) {
+                CheckOperator(c, e, e->binary.op, operand);
+                return NULL;
+            }
+            return operand;
+        // bitwise operators work on ints and on bools as one bit ints
+        case AND:
+        case OR:
+        case XOR:
+        case AND_NOT:
+            if (operand->kind == FloatType) {
+                CheckOperator(c, e, e->binary.op, operand);
+                return NULL;
+            }
+            return operand;
+        // shifts need an int to shift and an int count
+        case SHL:
+        case SHR:
+            if (operand->kind != IntType || right->kind != IntType) {
+                CheckOperator(c, e, e->binary.op, operand->kind != IntType ? operand : right);
+                return NULL;
+            }
+            return operand;
+        default:
+            break;
+    }
+
+    // only equality is defined on bools
+    if (operand->kind == BoolType && op != EQL && op != NEQ) {
+        CheckOperator(c, e, e->binary.op, operand);
+        return NULL;
+    }
+
+    switch(op) {
+        case LSS:
+        case LEQ:
+        case GTR:
+        case GEQ:
+        case EQL:
+        case NEQ:
+            return c->types->boolean;
+        default:
+            return operand;
+    }
+}
+
+Type *CheckCallExp(Checker *c, Exp *e) {
+    Exp *function = e->call.function;
+    for (int i = 0; i < e->call.argCount; i++) {
+        CheckExp(c, e->call.args + i);
+    }
+
+    // undeclared, reported by the resolution pass
+    if (function->type == identExp && function->ident.obj == NULL) return NULL;
+
+    if (function->type != identExp || function->ident.obj == NULL ||
+        function->ident.obj->node->type != functionDcl) {
+        CheckError *error = NewCheckError(c, e);
+        if (function->type == identExp) {
+            error->message = string_append_format(error->message, "'%s' is not a function", function->ident.name);
+        } else {
+            error->message = string_append_cstring(error->message, "cannot call a non function");
+        }
+        return NULL;
+    }
+
+    Dcl *dcl = function->ident.obj->node;
+    if (e->call.argCount != dcl->function.argCount) {
+        CheckError *error = NewCheckError(c, e);
+        error->message = string_append_format(error->message, "'%s' expects %d arguments but got %d",
+            dcl->function.name, dcl->function.argCount, e->call.argCount);
+    }
+
+    for (int i = 0; i < e->call.argCount && i < dcl->function.argCount; i++) {
+        Exp *arg = e->call.args + i;
+        CheckConversion(c, arg, arg->resolvedType, TypeOfDcl(c, dcl->function.args + i));
+    }
+
+    return TypeOfDcl(c, dcl);
+}
+
+Type *CheckIndexExp(Checker *c, Exp *e) {
+    Type *type = CheckExp(c, e->index.exp);
+    Type *index = CheckExp(c, e->index.index);
+    if (type == NULL || index == NULL) return NULL;
+
+    if (type->kind != ArrayType) {
+        CheckError *error = NewCheckError(c, e);
+        error->message = string_append_cstring(error->message, "cannot index ");
+        error->message = AppendTypeName(error->message, type);
+        return NULL;
+    }
+    if (index->kind != IntType) {
+        CheckError *error = NewCheckError(c, e->index.index);
+        error->message = string_append_cstring(error->message, "array index must be an integer but got ");
+        error->message = AppendTypeName(error->message, index);
+        return NULL;
+    }
+
+    return type->array.element;
+}
+
+// CheckArrayExp types an array literal by its elements, the literal is retyped if
+// it is used where another array type is expected (see CheckConversion)
+Type *CheckArrayExp(Checker *c, Exp *e) {
+    if (e->array.valueCount == 0) {
+        CheckError *error = NewCheckError(c, e);
+        error->message = string_append_cstring(error->message, "empty array literals are not supported");
+        return NULL;
+    }
+
+    Type *element = NULL;
+    bool failed = false;
+    for (int i = 0; i < e->array.valueCount; i++) {
+        Exp *value = e->array.values + i;
+        Type *type = CheckExp(c, value);
+        if (type == NULL) {
+            failed = true;
+            continue;
+        }
+        if (!IsScalarType(type)) {
+            CheckError *error = NewCheckError(c, value);
+            error->message = string_append_cstring(error->message, "array elements must be numbers or bools");
+            failed = true;
+            continue;
+        }
+        if (element == NULL) {
+            element = type;
+            continue;
+        }
+
+        Type *unified = UnifyTypes(c->types, element, type);
+        if (unified == NULL || (element->kind == BoolType) != (type->kind == BoolType)) {
+            CheckError *error = NewCheckError(c, value);
+            error->message = string_append_cstring(error->message, "mismatched array element types ");
+            error->message = AppendTypeName(error->message, element);
+            error->message = string_append_cstring(error->message, " and ");
+            error->message = AppendTypeName(error->message, type);
+            failed = true;
+            continue;
+        }
+        element = unified;
+    }
+    if (failed) return NULL;
+
+    return InternArrayType(c->types, DefaultType(c->types, element), e->array.valueCount);
+}
+
+Type *CheckExpType(Checker *c, Exp *e) {
+    switch(e->type) {
+        case literalExp:
+            return CheckLiteralExp(c, e);
+        case identExp:
+            return CheckIdentExp(c, e);
+        case unaryExp:
+            return CheckUnaryExp(c, e);
+        case binaryExp:
+            return CheckBinaryExp(c, e);
+        case callExp:
+            return CheckCallExp(c, e);
+        case indexExp:
+            return CheckIndexExp(c, e);
+        case arrayExp:
+            return CheckArrayExp(c, e);
+        default: {
+            CheckError *error = NewCheckError(c, e);
+            error->message = string_append_cstring(error->message, "expression is not supported");
+            return NULL;
+        }
+    }
+}
+
+// CheckExp annotates e and its children with their types, returns the type of e or
+// NULL if it has a type error. Shared (hash consed) nodes are only checked once.
+Type *CheckExp(Checker *c, Exp *e) {
+    if (e->resolvedType != NULL) return e->resolvedType;
+    e->resolvedType = CheckExpType(c, e);
+    return e->resolvedType;
+}
+
+// MarkWritten flags the varible or argument at the root of the assigned expression
+// left, irgen reads unwritten arrays straight from their initializer
+void MarkWritten(Exp *left) {
+    while (left->type == indexExp) left = left->index.exp;
+    if (left->type == identExp && left->ident.obj != NULL) left->ident.obj->node->written = true;
+}
+
+// ConstIntValue evaluates the untyped int constant e at 64 bits with integer
+// semantics, the way irgen builds it. Returns false if e has no defined value, such
+// as a division by zero or a shift by 64 or more.
+bool ConstIntValue(Exp *e, int64_t *value) {
+    switch(e->type) {
+        case literalExp: {
+            int base = e->literal.type == HEX ? 16 : e->literal.type == OCTAL ? 8 : 10;
+            if (e->literal.type != INT && base == 10) return false;
+            *value = (int64_t)strtoull(e->literal.value, NULL, base);
+            return true;
+        }
+        case unaryExp: {
+            int64_t right;
+            if (!ConstIntValue(e->unary.right, &right)) return false;
+            *value = e->unary.op.type == SUB ? (int64_t)(0 - (uint64_t)right) : right;
+            return true;
+        }
+        case binaryExp: {
+            int64_t left, right;
+            if (!ConstIntValue(e->binary.left, &left) || !ConstIntValue(e->binary.right, &right)) return false;
+
+            // wrap like the 64 bit instructions instead of overflowing
+            uint64_t l = left, r = right;
+            switch(e->binary.op.type) {
+                case ADD: *value = l + r; return true;
+                case SUB: *value = l - r; return true;
+                case MUL: *value = l * r; return true;
+                case AND: *value = l & r; return true;
+                case OR: *value = l | r; return true;
+                case XOR: *value = l ^ r; return true;
+                case AND_NOT: *value = l & ~r; return true;
+                case QUO:
+                case REM:
+                    if (right == 0 || (left == INT64_MIN && right == -1)) return false;
+                    *value = e->binary.op.type == QUO ? left / right : left % right;
+                    return true;
+                case SHL:
+                case SHR:
+                    if (r >= 64) return false;
+                    *value = e->binary.op.type == SHL ? (int64_t)(l << r) : left >> r;
+                    return true;
+                default:
+                    return false;
+            }
+        }
+        default:
+            return false;
+    }
+}
+
+int CompareCaseValues(const void *a, const void *b) {
+    const CaseValue *x = a, *y = b;
+    if (x->value != y->value) return x->value < y->value ? -1 : 1;
+    return x->index - y->index;
+}
+
+// CheckCaseValues reports case constants without a value (a division by zero or an
+// oversized shift), ones that dont fit in the tag type, which would otherwise be
+// truncated, and values listed more than once
+void CheckCaseValues(Checker *c, Smt *s, Type *tag) {
+    int count = 0;
+    for (int i = 0; i < s->switchs.clauseCount; i++) {
+        count += s->switchs.clauses[i].cases.expCount;
+    }
+    CaseValue *values = malloc(sizeof(CaseValue) * (count + 1));
+    bool *duplicate = calloc(count + 1, sizeof(bool));
+
+    int valueCount = 0, index = 0;
+    for (int i = 0; i < s->switchs.clauseCount; i++) {
+        Smt *clause = s->switchs.clauses + i;
+        for (int j = 0; j < clause->cases.expCount; j++, index++) {
+            Exp *exp = clause->cases.exps + j;
+            Type *type = exp->resolvedType;
+            int64_t value;
+            if (type == NULL || !type->untyped || type->kind != IntType) continue;
+            if (!ConstIntValue(exp, &value)) {
+                CheckError *error = NewCheckError(c, exp);
+                error->message = string_append_cstring(error->message, "case value is not a constant integer");
+                continue;
+            }
+
+            if (tag->bits < 64) {
+                int64_t max = ((int64_t)1 << (tag->bits - 1)) - 1;
+                if (value > max || value < -max - 1) {
+                    CheckError *error = NewCheckError(c, exp);
+                    error->message = string_append_format(error->message, "case %lld overflows ", (long long)value);
+                    error->message = AppendTypeName(error->message, tag);
+                    continue;
+                }
+            }
+            values[valueCount++] = (CaseValue){value, index, exp};
+        }
+    }
+
+    // sort a copy to find repeated values, then report them in source order
+    CaseValue *sorted = malloc(sizeof(CaseValue) * (valueCount + 1));
+    memcpy(sorted, values, sizeof(CaseValue) * valueCount);
+    qsort(sorted, valueCount, sizeof(CaseValue), CompareCaseValues);
+    for (int i = 1; i < valueCount; i++) {
+        if (sorted[i].value == sorted[i - 1].value) duplicate[sorted[i].index] = true;
+    }
+    for (int i = 0; i < valueCount; i++) {
+        if (!duplicate[values[i].index]) continue;
+        CheckError *error = NewCheckError(c, values[i].exp);
+        error->message = string_append_format(error->message, "duplicate case %lld in switch", (long long)values[i].value);
+    }
+    free(sorted);
+    free(duplicate);
+    free(values);
+}
+
+// CheckSwitch checks the tag of the switch s is an int and its cases are int
+// constants, which irgen needs to build a switch instruction. Case values fit the
+// tag type and are distinct, there can only be one default and the last clause has
+// no clause to fall through to.
+void CheckSwitch(Checker *c, Smt *s) {
+    Type *tag = CheckExp(c, s->switchs.tag);
+    if (tag != NULL && tag->kind != IntType) {
+        CheckError *error = NewCheckError(c, s->switchs.tag);
+        error->message = string_append_cstring(error->message, "switch tag must be an int but got ");
+        error->message = AppendTypeName(error->message, tag);
+    }
+
+    bool hasDefault = false;
+    for (int i = 0; i < s->switchs.clauseCount; i++) {
+        Smt *clause = s->switchs.clauses + i;
+        if (clause->cases.expCount == 0) {
+            if (hasDefault) {
+                CheckError *error = NewCheckErrorAt(c, &clause->cases.token);
+                error->message = string_append_cstring(error->message, "multiple defaults in switch");
+            }
+            hasDefault = true;
+        }
+
+        for (int j = 0; j < clause->cases.expCount; j++) {
+            Exp *value = clause->cases.exps + j;
+            Type *type = CheckExp(c, value);
+            if (type != NULL && (!type->untyped || type->kind != IntType)) {
+                CheckError *error = NewCheckError(c, value);
+                error->message = string_append_cstring(error->message, "case must be an int constant but got ");
+                error->message = AppendTypeName(error->message, type);
+            }
+        }
+
+        if (clause->cases.fallthrough && i == s->switchs.clauseCount - 1) {
+            CheckError *error = NewCheckErrorAt(c, &clause->cases.token);
+            error->message = string_append_cstring(error->message, "cannot fallthrough the last case in switch");
+        }
+        CheckSmt(c, clause->cases.body);
+    }
+    if (tag != NULL && tag->kind == IntType) CheckCaseValues(c, s, DefaultType(c->types, tag));
+}
+
+void CheckSmt(Checker *c, Smt *s) {
+    switch(s->type) {
+        case declareSmt:
+            CheckDcl(c, s->declare);
+            break;
+        case assignmentSmt: {
+            Exp *left = s->assignment.left;
+            Exp *right = s->assignment.right;
+            if (left->type != identExp && left->type != indexExp) {
+                CheckError *error = NewCheckError(c, left);
+                error->message = string_append_cstring(error->message, "cannot assign to expression");
+                CheckExp(c, right);
+                break;
+            }
+            MarkWritten(left);
+            Type *target = CheckExp(c, left);
+            CheckConversion(c, right, CheckExp(c, right), target);
+            break;
+        }
+        case returnSmt:
+            if (s->ret.result == NULL) {
+                CheckError *error = NewCheckErrorAt(c, &s->ret.token);
+                error->message = string_append_cstring(error->message, "missing return value");
+                break;
+            }
+            CheckConversion(c, s->ret.result, CheckExp(c, s->ret.result), c->returnType);
+            break;
+        case blockSmt:
+            for (int i = 0; i < s->block.count; i++) {
+                CheckSmt(c, s->block.smts + i);
+            }
+            break;
+        case ifSmt:
+            if (s->ifs.cond != NULL) CheckCondition(c, s->ifs.cond);
+            CheckSmt(c, s->ifs.body);
+            if (s->ifs.elses != NULL) CheckSmt(c, s->ifs.elses);
+            break;
+        case forSmt:
+            if (s->fors.index != NULL) CheckDcl(c, s->fors.index);
+            if (s->fors.cond != NULL) CheckCondition(c, s->fors.cond);
+            if (s->fors.inc != NULL) CheckSmt(c, s->fors.inc);
+            c->loops++;
+            CheckSmt(c, s->fors.body);
+            c->loops--;
+            break;
+        case switchSmt:
+            c->switches++;
+            CheckSwitch(c, s);
+            c->switches--;
+            break;
+        case branchSmt:
+            // break leaves the innermost loop or switch, continue the innermost loop
+            if (s->branch.token.type == BREAK && c->loops + c->switches == 0) {
+                CheckError *error = NewCheckErrorAt(c, &s->branch.token);
+                error->message = string_append_cstring(error->message, "break is not in a loop or switch");
+            } else if (s->branch.token.type == CONTINUE && c->loops == 0) {
+                CheckError *error = NewCheckErrorAt(c, &s->branch.token);
+                error->message = string_append_cstring(error->message, "continue is not in a loop");
+            }
+            break;
+        case caseSmt:
+            ASSERT(false, "Case clause outside of switch");
+            break;
+    }
+}
+
+// CheckDcl type checks a declaration, returns the amount of errors found in it
+int CheckDcl(Checker *c, Dcl *d) {
+    int errors = queue_size(c->errors);
+    switch(d->type) {
+        case functionDcl: {
+            for (int i = 0; i < d->function.argCount; i++) {
+                CheckDcl(c, d->function.args + i);
+            }
+            Type *outer = c->returnType;
+            c->returnType = d->function.returnType != NULL ? CheckType(c, d->function.returnType) : NULL;
+            CheckSmt(c, d->function.body);
+            c->returnType = outer;
+            break;
+        }
+        case argumentDcl:
+            CheckType(c, d->argument.type);
+            break;
+        case varibleDcl: {
+            Type *value = CheckExp(c, d->varible.value);
+            if (d->varible.type != NULL) {
+                CheckConversion(c, d->varible.value, value, CheckType(c, d->varible.type));
+            }
+            break;
+        }
+    }
+
+    return queue_size(c->errors) - errors;
+}
+
+// CheckUnit runs the semantic passes over ast, adding every top level declaration to
+// the symbol table, resolving names and then type checking. Returns the amount of errors.
+int CheckUnit(Checker *c, ast_unit *ast) {
+    int errors = 0;
+    for (int i = 0; i < ast->dclCount; i++) {
+        errors += DeclareGlobal(c, ast->dcls[i]);
+    }
+    for (int i = 0; i < ast->dclCount; i++) {
+        errors += ResolveDcl(c, ast->dcls[i], true);
+    }
+    for (int i = 0; i < ast->dclCount; i++) {
+        errors += CheckDcl(c, ast->dcls[i]);
+    }
+    return errors;
+}
+
+// RenderCheckErrors drains the checkers errors, appending a diagnostic for each of the
+// first MAX_ERRORS errors to out. count is set to the amount of errors drained.
+string RenderCheckErrors(Checker *c, char *src, string out, int *count) {
+    *count = 0;
+    if (queue_size(c->errors) == 0) return out;
+
+    line_index *index = new_line_index(src);
+    CheckError *error;
+    while((error = queue_pop_front(c->errors)) != NULL) {
+        (*count)++;
+        if (*count <= MAX_ERRORS) {
+            out = diagnostic_begin(out);
+            out = string_append(out, error->message);
+
+            int line_length;
+            char *line_src = line_index_line(index, error->line, &line_length);
+            if (line_src != NULL) {
+                out = diagnostic_source(out, line_src, line_length, error->line,
+                    error->column, error->column + error->length - 1);
+            } else {
+                out = string_append_cstring(out, "\n\n");
+            }
+        }
+        string_free(error->message);
+        queue_free_item(error);
+    }
+
+    if (*count > MAX_ERRORS) {
+        out = string_append_format(out, "%d more errors not shown\n", *count - MAX_ERRORS);
+    }
+    line_index_destroy(index);
+    return out;
+}
+
+// RenderCheckErrorsJson drains the checkers errors, appending one JSON object per error
+// to out (see parser_render_errors_json). count is set to the amount of errors drained.
+string RenderCheckErrorsJson(Checker *c, string out, int *count) {
+    *count = 0;
+    CheckError *error;
+    while((error = queue_pop_front(c->errors)) != NULL) {
+        (*count)++;
+        out = string_append_cstring(out, "{\"kind\":\"type\",\"message\":");
+        out = diagnostic_json_string(out, error->message);
+        out = string_append_format(out, ",\"line\":%d,\"column\":%d,\"length\":%d}\n",
+            error->line, error->column, error->length);
+        string_free(error->message);
+        queue_free_item(error);
+    }
+
+    return out;
+}
+
+// ReportCheckErrors writes the diagnostics for the checkers errors to stdout in a single
+// write, returns the amount of errors
+int ReportCheckErrors(Checker *c, char *src) {
+    int count;
+    string out = RenderCheckErrors(c, src, string_new_capacity(4096), &count);
+    if (count > 0) diagnostic_write(out, stdout);
+    string_free(out);
+    return count;
+}
+
+void DestroyChecker(Checker *c) {
+    CheckError *error;
+    while((error = queue_pop_front(c->errors)) != NULL) {
+        string_free(error->message);
+        queue_free_item(error);
+    }
+    queue_destroy(c->errors);
+
+    Symbol *symbol, *tmp;
+    HASH_ITER(hh, c->globals, symbol, tmp) {
+        HASH_DEL(c->globals, symbol);
+        free(symbol);
+    }
+    free(c);
+}
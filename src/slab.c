@@ -0,0 +1,132 @@
+#include "includes/slab.h"
+
+// new_slab creates a slab allocator owned by the calling thread
+slab *new_slab() {
+    slab *s = malloc(sizeof(slab));
+    for (int i = 0; i < SLAB_CLASS_COUNT; i++) {
+        s->classes[i] = new_pool(SLAB_MIN_SIZE << i, SLAB_CLASS_ELEMENTS);
+    }
+    s->large = NULL;
+    s->alloc_count = 0;
+    s->large_count = 0;
+
+    return s;
+}
+
+// slab_class returns the size class index for size, or -1 if size is too large for a class
+int slab_class(size_t size) {
+    if (size > SLAB_MAX_SIZE) return -1;
+
+    int class = 0;
+    size_t class_size = SLAB_MIN_SIZE;
+    while (class_size < size) {
+        class_size <<= 1;
+        class++;
+    }
+    return class;
+}
+
+// slab_alloc allocates size bytes from the matching size class
+void *slab_alloc(slab *s, size_t size) {
+    s->alloc_count++;
+
+    int class = slab_class(size);
+    if (class >= 0) return pool_get(s->classes[class]);
+
+    // too large for a size class so fall back to malloc, keeping it in a list
+    // so slab_destroy can free it
+    s->large_count++;
+    slab_large *large = malloc(sizeof(slab_large) + size);
+    assert(large != NULL);
+    large->prev = NULL;
+    large->next = s->large;
+    if (s->large != NULL) s->large->prev = large;
+    s->large = large;
+
+    return large + 1;
+}
+
+// slab_realloc resizes an allocation, only moving it when the size class changes
+void *slab_realloc(slab *s, void *ptr, size_t old_size, size_t new_size) {
+    if (ptr == NULL) return slab_alloc(s, new_size);
+
+    int old_class = slab_class(old_size);
+    int new_class = slab_class(new_size);
+    if (old_class >= 0 && old_class == new_class) return ptr;
+
+    if (old_class < 0 && new_class < 0) {
+        // both large so let realloc move the block
+        slab_large *large = (slab_large *)ptr - 1;
+        large = realloc(large, sizeof(slab_large) + new_size);
+        assert(large != NULL);
+        if (large->prev != NULL) large->prev->next = large; else s->large = large;
+        if (large->next != NULL) large->next->prev = large;
+        return large + 1;
+    }
+
+    void *moved = slab_alloc(s, new_size);
+    memcpy(moved, ptr, old_size < new_size ? old_size : new_size);
+    slab_free(s, ptr, old_size);
+    return moved;
+}
+
+// slab_free returns an allocation of size bytes to the slab
+void slab_free(slab *s, void *ptr, size_t size) {
+    if (ptr == NULL) return;
+
+    int class = slab_class(size);
+    if (class >= 0) {
+        pool_release(s->classes[class], ptr);
+        return;
+    }
+
+    // unlink and free the large allocation
+    slab_large *large = (slab_large *)ptr - 1;
+    if (large->prev != NULL) large->prev->next = large->next; else s->large = large->next;
+    if (large->next != NULL) large->next->prev = large->prev;
+    free(large);
+}
+
+// slab_strndup copies length characters of str into the slab as a null terminated string
+char *slab_strndup(slab *s, char *str, int length) {
+    char *copy = slab_alloc(s, length + 1);
+    memcpy(copy, str, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+// slab_chunk_count returns the amount of chunks the size classes have allocated
+int slab_chunk_count(slab *s) {
+    int count = 0;
+    for (int i = 0; i < SLAB_CLASS_COUNT; i++) {
+        for (pool_chunk *chunk = s->classes[i]->chunks; chunk != NULL; chunk = chunk->next) {
+            count++;
+        }
+    }
+    return count;
+}
+
+// slab_handoff gives up ownership of the slab so it can be passed to another thread
+void slab_handoff(slab *s) {
+    for (int i = 0; i < SLAB_CLASS_COUNT; i++) pool_handoff(s->classes[i]);
+}
+
+// slab_adopt makes the calling thread the owner of a slab that was handed off
+void slab_adopt(slab *s) {
+    for (int i = 0; i < SLAB_CLASS_COUNT; i++) pool_adopt(s->classes[i]);
+}
+
+// slab_destroy frees all the slabs memory, including large allocations
+void slab_destroy(slab *s) {
+    for (int i = 0; i < SLAB_CLASS_COUNT; i++) {
+        pool_destroy(s->classes[i]);
+    }
+
+    slab_large *large = s->large;
+    while (large != NULL) {
+        slab_large *next = large->next;
+        free(large);
+        large = next;
+    }
+    s->large = NULL;
+}
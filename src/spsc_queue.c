@@ -0,0 +1,106 @@
+#include "includes/spsc_queue.h"
+#include <sched.h>
+#include <string.h>
+
+// new_spsc_queue creates a ring holding up to capacity elements, capacity is
+// rounded up to a power of two
+spsc_queue *new_spsc_queue(size_t element_size, int capacity) {
+    assert(capacity > 0);
+    size_t size = 2;
+    while (size < (size_t)capacity) size *= 2;
+
+    // aligned so the producer and consumer positions sit on their own cache lines
+    spsc_queue *q = aligned_alloc(SPSC_CACHE_LINE, (sizeof(spsc_queue) + SPSC_CACHE_LINE - 1) & ~(SPSC_CACHE_LINE - 1));
+    q->elements = malloc(element_size * size);
+    q->element_size = element_size;
+    q->mask = size - 1;
+    q->tail = 0;
+    q->cached_head = 0;
+    q->head = 0;
+    q->cached_tail = 0;
+    __atomic_store_n(&q->closed, false, __ATOMIC_RELEASE);
+
+    return q;
+}
+
+// spsc_queue_capacity returns the amount of elements the ring can hold
+int spsc_queue_capacity(spsc_queue *q) {
+    return q->mask + 1;
+}
+
+// spsc_queue_try_push copies element into the ring, returns false if the ring is full.
+// Only the producer thread may call this.
+bool spsc_queue_try_push(spsc_queue *q, void *element) {
+    size_t tail = q->tail;
+    if (tail - q->cached_head > q->mask) {
+        // looks full, refresh the consumers position
+        q->cached_head = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+        if (tail - q->cached_head > q->mask) return false;
+    }
+
+    memcpy(q->elements + (tail & q->mask) * q->element_size, element, q->element_size);
+    __atomic_store_n(&q->tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+// spsc_queue_try_pop copies the next element out of the ring, returns false if the ring is empty.
+// Only the consumer thread may call this.
+bool spsc_queue_try_pop(spsc_queue *q, void *element) {
+    size_t head = q->head;
+    if (head == q->cached_tail) {
+        // looks empty, refresh the producers position
+        q->cached_tail = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+        if (head == q->cached_tail) return false;
+    }
+
+    memcpy(element, q->elements + (head & q->mask) * q->element_size, q->element_size);
+    __atomic_store_n(&q->head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+// spsc_queue_wait backs off while waiting on the other side, spinning first and
+// then yielding the cpu
+void spsc_queue_wait(int *spins) {
+    if (*spins < 64) {
+        (*spins)++;
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    } else {
+        sched_yield();
+    }
+}
+
+// spsc_queue_push copies element into the ring, waiting while the ring is full
+void spsc_queue_push(spsc_queue *q, void *element) {
+    int spins = 0;
+    while (!spsc_queue_try_push(q, element)) spsc_queue_wait(&spins);
+}
+
+// spsc_queue_pop copies the next element out of the ring, waiting while the ring
+// is empty. Returns false once the ring is closed and empty.
+bool spsc_queue_pop(spsc_queue *q, void *element) {
+    int spins = 0;
+    for (;;) {
+        if (spsc_queue_try_pop(q, element)) return true;
+        // check closed after a failed pop so elements pushed before the close are not lost
+        if (spsc_queue_closed(q)) return spsc_queue_try_pop(q, element);
+        spsc_queue_wait(&spins);
+    }
+}
+
+// spsc_queue_close marks that the producer will push no more elements
+void spsc_queue_close(spsc_queue *q) {
+    __atomic_store_n(&q->closed, true, __ATOMIC_RELEASE);
+}
+
+// spsc_queue_closed returns true if the ring has been closed
+bool spsc_queue_closed(spsc_queue *q) {
+    return __atomic_load_n(&q->closed, __ATOMIC_ACQUIRE);
+}
+
+// spsc_queue_destroy frees the ring, neither side may be using it
+void spsc_queue_destroy(spsc_queue *q) {
+    free(q->elements);
+    free(q);
+}
@@ -1,6 +1,10 @@
 #include "includes/string.h"
 
 #define STRING_HEADER(s) ((string_header *)s - 1)
+#define STRING_MIN_CAPACITY 16
+
+// string_allocations counts heap allocations made for strings
+int string_allocations = 0;
 
 string string_new(const char *str) {
     int length = str ? strlen(str) : 0;
@@ -11,6 +15,7 @@ string string_new_length(const char *str, int len) {
     // Create header + data
     void *data = malloc(sizeof(string_header) + len + 1);
     if (data == NULL) return NULL;
+    string_allocations++;
     
     string s = (char *)data + sizeof(string_header);
     
@@ -18,6 +23,7 @@ string string_new_length(const char *str, int len) {
     string_header *header = STRING_HEADER(s);
     header->length = len;
     header->capacity = len;
+    header->hash = 0;
 
     // Set the string data
     memcpy(s, str, len);
@@ -31,11 +37,27 @@ string string_new_file(FILE *f) {
 	int file_length = ftell (f);
 	fseek (f, 0, SEEK_SET);
 
-    string s = string_new_length("", file_length);
+    string s = string_new_capacity(file_length);
     fread(s, 1, file_length, f);
     s[file_length] = '\0';
     STRING_HEADER(s)->length = file_length;
+    STRING_HEADER(s)->hash = 0;
+
+    return s;
+}
+
+// string_new_capacity creates an empty string with room for capacity characters,
+// used to build a string with appends without reallocating
+string string_new_capacity(int capacity) {
+    string_header *header = malloc(sizeof(string_header) + capacity + 1);
+    if (header == NULL) return NULL;
+    string_allocations++;
 
+    header->length = 0;
+    header->capacity = capacity;
+    header->hash = 0;
+    string s = (char *)(header + 1);
+    s[0] = '\0';
     return s;
 }
 
@@ -60,14 +82,28 @@ int string_avalible(string s) {
     return header->capacity - header->length;
 }
 
+// string_expand sets the capacity of s to exactly capacity characters, unless it
+// already has room for them
 string string_expand(string s, int capacity) {
     string_header *header = STRING_HEADER(s);
-    if (header->capacity > capacity) return s;
-    header = realloc(header, sizeof(string_header) + capacity);
+    if (header->capacity >= capacity) return s;
+    header = realloc(header, sizeof(string_header) + capacity + 1);
+    string_allocations++;
     header->capacity = capacity;
     return (char *)(header + 1);
 }
 
+// string_reserve makes room for s to hold length characters, at least doubling
+// the capacity when it grows
+string string_reserve(string s, int length) {
+    int capacity = string_capacity(s);
+    if (capacity >= length) return s;
+    capacity *= 2;
+    if (capacity < STRING_MIN_CAPACITY) capacity = STRING_MIN_CAPACITY;
+    if (capacity < length) capacity = length;
+    return string_expand(s, capacity);
+}
+
 string string_clear(string s) {
     return string_slice(s, 0, 0);
 }
@@ -78,10 +114,11 @@ string string_append(string s1, string s2) {
 
 string string_append_length(string s1, char *s2, int length) {
     int current_length = string_length(s1);
-    s1 = string_expand(s1, current_length + length + 1);
+    s1 = string_reserve(s1, current_length + length);
     memcpy(s1 + current_length, s2, length);
     s1[current_length + length] = '\0';
     STRING_HEADER(s1)->length = current_length + length;
+    STRING_HEADER(s1)->hash = 0;
     return s1;
 }
 
@@ -89,6 +126,46 @@ string string_append_cstring(string s, char *str) {
     return string_append_length(s, str, strlen(str));
 }
 
+string string_append_char(string s, char c) {
+    int length = string_length(s);
+    s = string_reserve(s, length + 1);
+    s[length] = c;
+    s[length + 1] = '\0';
+    STRING_HEADER(s)->length = length + 1;
+    STRING_HEADER(s)->hash = 0;
+    return s;
+}
+
+// string_append_format appends printf style formatted output to s, writing
+// directly into the strings buffer
+string string_append_format(string s, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    s = string_append_vformat(s, format, args);
+    va_end(args);
+    return s;
+}
+
+// string_append_vformat is string_append_format taking a va_list
+string string_append_vformat(string s, const char *format, va_list args) {
+    int length = string_length(s);
+
+    // try to format into the space available, growing and retrying if it does not fit
+    va_list retry;
+    va_copy(retry, args);
+    int written = vsnprintf(s + length, string_avalible(s) + 1, format, args);
+    assert(written >= 0);
+    if (written > string_avalible(s)) {
+        s = string_reserve(s, length + written);
+        vsnprintf(s + length, written + 1, format, retry);
+    }
+    va_end(retry);
+
+    STRING_HEADER(s)->length = length + written;
+    STRING_HEADER(s)->hash = 0;
+    return s;
+}
+
 string string_slice(string s, int start, int end) {
     string_header *header = STRING_HEADER(s);
     assert(start >= 0);
@@ -97,18 +174,193 @@ string string_slice(string s, int start, int end) {
     if(start > 0) memmove(s, s + start, length);
     s[length] = '\0';
     header->length = length;
+    header->hash = 0;
     return s;
 }
 
 bool string_equals(string s1, string s2) {
-    int length = string_length(s1);
-    if (length != string_length(s2)) {
-        return false;
-    }
+    string_header *h1 = STRING_HEADER(s1);
+    string_header *h2 = STRING_HEADER(s2);
+    if (h1->length != h2->length) return false;
+
+    // strings with different cached hashes can not be equal
+    if (h1->hash != 0 && h2->hash != 0 && h1->hash != h2->hash) return false;
 
+    return memcmp(s1, s2, h1->length) == 0;
+}
+
+// string_hash_append mixes length bytes of data into the 64-bit FNV-1a hash h, start
+// from STRING_HASH_SEED
+uint64_t string_hash_append(uint64_t h, const void *data, int length) {
+    const unsigned char *bytes = data;
     for (int i = 0; i < length; i++) {
-        if(s1[i] != s2[i]) return false;
+        h ^= bytes[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// string_hash_bytes returns the 64-bit FNV-1a hash of length bytes of data, never 0
+// so 0 can mark a hash that has not been computed
+uint64_t string_hash_bytes(const char *data, int length) {
+    uint64_t h = string_hash_append(STRING_HASH_SEED, data, length);
+    return h != 0 ? h : 1;
+}
+
+// string_hash returns the hash of s, computing it on first use and caching it in the header
+uint64_t string_hash(string s) {
+    string_header *header = STRING_HEADER(s);
+    if (header->hash == 0) header->hash = string_hash_bytes(s, header->length);
+    return header->hash;
+}
+
+// string_allocation_count returns the amount of heap allocations made for strings
+int string_allocation_count() {
+    return string_allocations;
+}
+
+// small_string_new creates a small string, only allocating when str is too long to store inline
+small_string small_string_new(const char *str) {
+    int length = str ? strlen(str) : 0;
+    return small_string_new_length(str, length);
+}
+
+small_string small_string_new_length(const char *str, int len) {
+    small_string s;
+    if (len > SMALL_STRING_INLINE) {
+        s.heap.str = string_new_length(str, len);
+        s.heap.flag = SMALL_STRING_HEAP;
+        return s;
+    }
+
+    memcpy(s.small.data, str, len);
+    s.small.data[len] = '\0';
+    s.small.length = len;
+    return s;
+}
+
+small_string small_string_copy(small_string *s) {
+    return small_string_new_length(small_string_cstring(s), small_string_length(s));
+}
+
+void small_string_free(small_string *s) {
+    if (!small_string_is_inline(s)) string_free(s->heap.str);
+    *s = small_string_new_length("", 0);
+}
+
+bool small_string_is_inline(small_string *s) {
+    return s->small.length != SMALL_STRING_HEAP;
+}
+
+int small_string_length(small_string *s) {
+    if (small_string_is_inline(s)) return s->small.length;
+    return string_length(s->heap.str);
+}
+
+int small_string_capacity(small_string *s) {
+    if (small_string_is_inline(s)) return SMALL_STRING_INLINE;
+    return string_capacity(s->heap.str);
+}
+
+// small_string_cstring returns the null terminated characters, valid until s is modified
+char *small_string_cstring(small_string *s) {
+    if (small_string_is_inline(s)) return s->small.data;
+    return s->heap.str;
+}
+
+// small_string_to_string copies s into a new heap string
+string small_string_to_string(small_string *s) {
+    return string_new_length(small_string_cstring(s), small_string_length(s));
+}
+
+// small_string_reserve makes room for s to hold length characters, moving an
+// inline string to the heap when it no longer fits
+void small_string_reserve(small_string *s, int length) {
+    if (!small_string_is_inline(s)) {
+        s->heap.str = string_reserve(s->heap.str, length);
+        return;
+    }
+    if (length <= SMALL_STRING_INLINE) return;
+
+    int capacity = 2 * SMALL_STRING_INLINE;
+    if (capacity < length) capacity = length;
+    string str = string_new_capacity(capacity);
+    s->heap.str = string_append_length(str, s->small.data, s->small.length);
+    s->heap.flag = SMALL_STRING_HEAP;
+}
+
+void small_string_append(small_string *s1, small_string *s2) {
+    small_string_append_length(s1, small_string_cstring(s2), small_string_length(s2));
+}
+
+void small_string_append_length(small_string *s1, const char *s2, int length) {
+    int current_length = small_string_length(s1);
+    small_string_reserve(s1, current_length + length);
+    if (!small_string_is_inline(s1)) {
+        s1->heap.str = string_append_length(s1->heap.str, (char *)s2, length);
+        return;
+    }
+
+    memcpy(s1->small.data + current_length, s2, length);
+    s1->small.data[current_length + length] = '\0';
+    s1->small.length = current_length + length;
+}
+
+void small_string_append_cstring(small_string *s, const char *str) {
+    small_string_append_length(s, str, strlen(str));
+}
+
+// small_string_append_format appends printf style formatted output to s, formatting
+// inline when the result fits
+void small_string_append_format(small_string *s, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    if (!small_string_is_inline(s)) {
+        s->heap.str = string_append_vformat(s->heap.str, format, args);
+        va_end(args);
+        return;
+    }
+
+    va_list retry;
+    va_copy(retry, args);
+    int length = s->small.length;
+    int written = vsnprintf(s->small.data + length, SMALL_STRING_INLINE - length + 1, format, args);
+    assert(written >= 0);
+    if (length + written <= SMALL_STRING_INLINE) {
+        s->small.length = length + written;
+    } else {
+        // did not fit, vsnprintf truncated the inline data so restore the terminator
+        s->small.data[length] = '\0';
+        small_string_reserve(s, length + written);
+        s->heap.str = string_append_vformat(s->heap.str, format, retry);
     }
+    va_end(retry);
+    va_end(args);
+}
+
+void small_string_slice(small_string *s, int start, int end) {
+    if (!small_string_is_inline(s)) {
+        s->heap.str = string_slice(s->heap.str, start, end);
+        return;
+    }
+
+    assert(start >= 0);
+    assert(end <= s->small.length);
+    int length = end - start;
+    if(start > 0) memmove(s->small.data, s->small.data + start, length);
+    s->small.data[length] = '\0';
+    s->small.length = length;
+}
 
-    return true;
-}
\ No newline at end of file
+// small_string_hash returns the hash of s, cached when s is on the heap
+uint64_t small_string_hash(small_string *s) {
+    if (!small_string_is_inline(s)) return string_hash(s->heap.str);
+    return string_hash_bytes(s->small.data, s->small.length);
+}
+
+bool small_string_equals(small_string *s1, small_string *s2) {
+    if (!small_string_is_inline(s1) && !small_string_is_inline(s2)) return string_equals(s1->heap.str, s2->heap.str);
+    int length = small_string_length(s1);
+    if (length != small_string_length(s2)) return false;
+    return memcmp(small_string_cstring(s1), small_string_cstring(s2), length) == 0;
+}
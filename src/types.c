@@ -0,0 +1,209 @@
+#include "includes/types.h"
+
+// AddNamedType adds a builtin named type to the table
+Type *AddNamedType(TypeTable *table, char *name, TypeKind kind, int bits, LLVMTypeRef llvm) {
+    Type *type = calloc(1, sizeof(Type));
+    type->kind = kind;
+    type->bits = bits;
+    type->name = name;
+    type->llvm = llvm;
+    HASH_ADD_KEYPTR(hh, table->named, type->name, strlen(type->name), type);
+    return type;
+}
+
+// NewTypeTable creates a table containing the builtin types
+TypeTable *NewTypeTable() {
+    TypeTable *table = malloc(sizeof(TypeTable));
+    table->named = NULL;
+    table->arrays = NULL;
+    table->exps = NULL;
+
+    AddNamedType(table, "int", IntType, 64, LLVMInt64Type());
+    AddNamedType(table, "i64", IntType, 64, LLVMInt64Type());
+    AddNamedType(table, "i32", IntType, 32, LLVMInt32Type());
+    AddNamedType(table, "i16", IntType, 16, LLVMInt16Type());
+    AddNamedType(table, "i8", IntType, 8, LLVMInt8Type());
+
+    AddNamedType(table, "float", FloatType, 32, LLVMFloatType());
+    AddNamedType(table, "f32", FloatType, 32, LLVMFloatType());
+    AddNamedType(table, "f64", FloatType, 64, LLVMDoubleType());
+
+    table->boolean = AddNamedType(table, "bool", BoolType, 1, LLVMInt1Type());
+
+    // the names of untyped types cant be written in source so they are only
+    // reachable through the table
+    table->untypedInt = AddNamedType(table, "untyped int", IntType, 64, LLVMInt64Type());
+    table->untypedInt->untyped = true;
+    table->untypedFloat = AddNamedType(table, "untyped float", FloatType, 32, LLVMFloatType());
+    table->untypedFloat->untyped = true;
+
+    return table;
+}
+
+// LookupNamedType finds a named type, returns NULL if there is no type called name
+Type *LookupNamedType(TypeTable *table, char *name) {
+    Type *type;
+    HASH_FIND_STR(table->named, name, type);
+    return type;
+}
+
+// InternArrayType returns the array type of length elements of element, creating it
+// the first time the shape is seen
+Type *InternArrayType(TypeTable *table, Type *element, int length) {
+    ArrayTypeKey key;
+    memset(&key, 0, sizeof(ArrayTypeKey)); // clear padding, the key is hashed as bytes
+    key.element = element;
+    key.length = length;
+
+    Type *type;
+    HASH_FIND(hh, table->arrays, &key, sizeof(ArrayTypeKey), type);
+    if (type != NULL) return type;
+
+    type = calloc(1, sizeof(Type));
+    type->kind = ArrayType;
+    type->array = key;
+    type->llvm = LLVMArrayType(element->llvm, length);
+    HASH_ADD(hh, table->arrays, array, sizeof(ArrayTypeKey), type);
+    return type;
+}
+
+// LookupType returns the type of the type expression e, or NULL if e does not
+// name a type
+Type *LookupType(TypeTable *table, Exp *e) {
+    TypeExp *cached;
+    HASH_FIND_PTR(table->exps, &e, cached);
+    if (cached != NULL) return cached->type;
+
+    Type *type = NULL;
+    switch(e->type) {
+        case identExp:
+            type = LookupNamedType(table, e->ident.name);
+            break;
+        case arrayTypeExp: {
+            Exp *length = e->arrayType.length;
+            if (length == NULL || length->type != literalExp || length->literal.type != INT) break;
+            Type *element = LookupType(table, e->arrayType.type);
+            if (element == NULL) break;
+            type = InternArrayType(table, element, atoi(length->literal.value));
+            break;
+        }
+        default:
+            break;
+    }
+    if (type == NULL) return NULL;
+
+    cached = malloc(sizeof(TypeExp));
+    cached->exp = e;
+    cached->type = type;
+    HASH_ADD_PTR(table->exps, exp, cached);
+    return type;
+}
+
+// ResolveType returns the type of the type expression e, which must name a type
+Type *ResolveType(TypeTable *table, Exp *e) {
+    Type *type = LookupType(table, e);
+    ASSERT(type != NULL, "Expected a type");
+    return type;
+}
+
+// TypeTableCount returns the amount of distinct types in the table
+int TypeTableCount(TypeTable *table) {
+    return HASH_COUNT(table->named) + HASH_COUNT(table->arrays);
+}
+
+// IsScalarType returns true for int, float and bool types
+bool IsScalarType(Type *type) {
+    return type->kind != ArrayType;
+}
+
+// DefaultType returns the type an untyped literal takes when nothing narrows it,
+// other types are returned unchanged
+Type *DefaultType(TypeTable *table, Type *type) {
+    if (type == table->untypedInt) return LookupNamedType(table, "int");
+    if (type == table->untypedFloat) return LookupNamedType(table, "float");
+    return type;
+}
+
+// UnifyTypes returns the type both operands of a binary expression are converted to
+// before the operation, or NULL if the types cant be combined. Untyped literals take
+// the type of the other side, otherwise the narrowest type that holds both is used
+// (floats win over ints, bool acts as a one bit int). An f32 only holds ints of up
+// to 24 bits exactly, so wider ints mixed with it or with an untyped float unify
+// to f64.
+Type *UnifyTypes(TypeTable *table, Type *a, Type *b) {
+    if (a == b) return a;
+    if (!IsScalarType(a) || !IsScalarType(b)) return NULL;
+
+    if (a->untyped && b->untyped) return table->untypedFloat;
+
+    // move a typed operand to a
+    if (a->untyped) {
+        Type *tmp = a;
+        a = b;
+        b = tmp;
+    }
+
+    if (b->untyped) {
+        if (a->kind == BoolType) return DefaultType(table, b);
+        if (a->kind == FloatType || b->kind == IntType) return a;
+        if (a->bits > 24) return LookupNamedType(table, "f64");
+        return DefaultType(table, b);
+    }
+
+    // move a float operand to a
+    if (b->kind == FloatType && a->kind != FloatType) {
+        Type *tmp = a;
+        a = b;
+        b = tmp;
+    }
+
+    if (a->kind == FloatType && b->kind != FloatType) {
+        if (a->bits == 32 && b->bits > 24) return LookupNamedType(table, "f64");
+        return a;
+    }
+    return a->bits >= b->bits ? a : b;
+}
+
+// ShiftType returns the type of a shift of left by right, which is the type of
+// left unless it is an untyped literal shifted by a typed value, or NULL if either
+// operand isnt a scalar
+Type *ShiftType(TypeTable *table, Type *left, Type *right) {
+    if (!IsScalarType(left) || !IsScalarType(right)) return NULL;
+    if (left->untyped && !right->untyped) return right;
+    return left;
+}
+
+// IsConvertible returns true if a value of type from can be implicitly converted to
+// type to, numbers convert freely but only bools convert to bool
+bool IsConvertible(Type *from, Type *to) {
+    if (from == to) return true;
+    if (!IsScalarType(from) || !IsScalarType(to)) return false;
+    return to->kind != BoolType;
+}
+
+// AppendTypeName appends the source name of type to out
+string AppendTypeName(string out, Type *type) {
+    if (type->kind != ArrayType) return string_append_cstring(out, type->name);
+    out = AppendTypeName(out, type->array.element);
+    return string_append_format(out, "[%d]", type->array.length);
+}
+
+// DestroyTypeTable frees the table and its types
+void DestroyTypeTable(TypeTable *table) {
+    TypeExp *exp, *exp_tmp;
+    HASH_ITER(hh, table->exps, exp, exp_tmp) {
+        HASH_DEL(table->exps, exp);
+        free(exp);
+    }
+
+    Type *type, *tmp;
+    HASH_ITER(hh, table->named, type, tmp) {
+        HASH_DEL(table->named, type);
+        free(type);
+    }
+    HASH_ITER(hh, table->arrays, type, tmp) {
+        HASH_DEL(table->arrays, type);
+        free(type);
+    }
+    free(table);
+}
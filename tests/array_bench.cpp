@@ -0,0 +1,57 @@
+#define ARRAY_BENCH_LENGTH 10000
+
+// array_bench_source generates a lookup table of length literals. The first element
+// is n when dynamic is set, which keeps the literal from being constant, and an
+// element is assigned when written is set.
+string array_bench_source(int length, bool dynamic, bool written) {
+    string src = string_new("proc main :: int n -> int {\n    table := [");
+    char value[32];
+    for (int i = 0; i < length; i++) {
+        if (i == 0 && dynamic) {
+            src = string_append_cstring(src, (char *)"n");
+        } else {
+            sprintf(value, i == 0 ? "%d" : ", %d", i * 7 % 1000);
+            src = string_append_cstring(src, value);
+        }
+    }
+    src = string_append_cstring(src, (char *)"]\n");
+    if (written) src = string_append_cstring(src, (char *)"    table[1] = n\n");
+    return string_append_cstring(src, (char *)"    return table[n] + table[1]\n}\n");
+}
+
+// array_bench_run times irgen and -O2 for the table and counts the instructions
+// irgen built
+void array_bench_run(const char *name, bool dynamic, bool written) {
+    ast_unit *ast = parse_file(new_parser(Lex(array_bench_source(ARRAY_BENCH_LENGTH, dynamic, written))));
+    Irgen *irgen = NewIrgen();
+    CheckUnit(NewChecker(irgen->types), ast);
+
+    double start = bench_now();
+    CompileFunction(irgen, ast->dcls[0]);
+    double compiled = bench_now();
+
+    int instructions = 0;
+    LLVMValueRef f = LLVMGetNamedFunction(irgen->module, "main");
+    for (LLVMBasicBlockRef b = LLVMGetFirstBasicBlock(f); b != NULL; b = LLVMGetNextBasicBlock(b)) {
+        for (LLVMValueRef i = LLVMGetFirstInstruction(b); i != NULL; i = LLVMGetNextInstruction(i)) {
+            instructions++;
+        }
+    }
+
+    OptLevel level = {2, 0};
+    double optimizeStart = bench_now();
+    OptimizeModule(irgen->module, level);
+    double optimized = bench_now();
+    LLVMDisposeModule(irgen->module);
+
+    printf("%-12s %14d %12.4f %12.4f\n", name, instructions, compiled - start, optimized - optimizeStart);
+}
+
+// array_bench compares a table stored element by element (one element is not
+// constant) with constant tables copied from a global or read from it in place
+void array_bench() {
+    printf("%-12s %14s %12s %12s\n", "table", "instructions", "irgen (s)", "-O2 (s)");
+    array_bench_run("stores", true, true);
+    array_bench_run("memcpy", false, true);
+    array_bench_run("global", false, false);
+}
@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// src project
+extern "C" {
+    #include "../src/includes/error.h"
+    #include "../src/includes/lexer.h"
+    #include "../src/includes/ast.h"
+    #include "../src/includes/parser.h"
+    #include "../src/includes/irgen.h"
+    #include "../src/includes/pool.h"
+    #include "../src/includes/slab.h"
+    #include "../src/includes/queue.h"
+    #include "../src/includes/mpmc_queue.h"
+    #include "../src/includes/spsc_queue.h"
+    #include "../src/includes/semantic.h"
+    #include "../src/includes/optimize.h"
+    #include "../src/includes/pipeline.h"
+    #include "../src/includes/string.h"
+}
+
+// example programs shared by tests and benchmarks
+#include "programs.h"
+
+// bench_now returns a monotonic time in seconds
+double bench_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// benchmark files
+#include "pool_bench.cpp"
+#include "slab_bench.cpp"
+#include "hugepage_bench.cpp"
+#include "queue_bench.cpp"
+#include "mpmc_queue_bench.cpp"
+#include "pipeline_bench.cpp"
+#include "string_bench.cpp"
+#include "optimize_bench.cpp"
+#include "ssa_bench.cpp"
+#include "array_bench.cpp"
+#include "switch_bench.cpp"
+
+typedef struct {
+    const char *name;
+    void (*run)();
+} bench;
+
+bench benches[] = {
+    {"pool", pool_bench},
+    {"slab", slab_bench},
+    {"hugepage", hugepage_bench},
+    {"queue", queue_bench},
+    {"mpmc", mpmc_bench},
+    {"pipeline", pipeline_bench},
+    {"string", string_bench},
+    {"optimize", optimize_bench},
+    {"ssa", ssa_bench},
+    {"array", array_bench},
+    {"switch", switch_bench},
+};
+
+// usage: atomical-bench [name...], runs all benchmarks when no names are given
+int main(int argc, char **argv) {
+    for (size_t i = 0; i < sizeof(benches) / sizeof(bench); i++) {
+        bool selected = argc < 2;
+        for (int j = 1; j < argc; j++) {
+            if (strcmp(argv[j], benches[i].name) == 0) selected = true;
+        }
+        if (!selected) continue;
+
+        printf("== %s ==\n", benches[i].name);
+        benches[i].run();
+        printf("\n");
+    }
+    return 0;
+}
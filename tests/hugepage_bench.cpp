@@ -0,0 +1,94 @@
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define HUGEPAGE_BENCH_NODES 4000000
+#define HUGEPAGE_BENCH_STEPS 20000000
+
+// hugepage_bench_open_dtlb opens a counter for data TLB load misses of this thread,
+// returns -1 if perf events are not available
+int hugepage_bench_open_dtlb() {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB |
+        (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+// builds a pool of nodes linked in a random order then chases the links
+double hugepage_bench_mode(pool_page_mode mode, long long *misses) {
+    pool_set_page_mode(mode);
+    ast_unit *ast = new_ast_unit();
+    pool_set_page_mode(pool_pages_default);
+
+    Exp **nodes = (Exp **)malloc(HUGEPAGE_BENCH_NODES * sizeof(Exp *));
+    for (int i = 0; i < HUGEPAGE_BENCH_NODES; i++) {
+        nodes[i] = new_star_exp(ast, NULL);
+    }
+
+    // link the nodes into one random cycle
+    srand(1);
+    for (int i = HUGEPAGE_BENCH_NODES - 1; i > 0; i--) {
+        int j = rand() % (i + 1);
+        Exp *tmp = nodes[i];
+        nodes[i] = nodes[j];
+        nodes[j] = tmp;
+    }
+    for (int i = 0; i < HUGEPAGE_BENCH_NODES; i++) {
+        nodes[i]->star = nodes[(i + 1) % HUGEPAGE_BENCH_NODES];
+    }
+
+    int fd = hugepage_bench_open_dtlb();
+    if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    double start = bench_now();
+    Exp *e = nodes[0];
+    for (int i = 0; i < HUGEPAGE_BENCH_STEPS; i++) {
+        e = e->star;
+    }
+    double time = bench_now() - start;
+
+    *misses = -1;
+    if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd, misses, sizeof(long long)) != sizeof(long long)) *misses = -1;
+        close(fd);
+    }
+
+    // keep the walk from being optimized away
+    if (e == NULL) printf("unreachable\n");
+
+    free(nodes);
+    pool_destroy(ast->dcl_pool);
+    pool_destroy(ast->smt_pool);
+    pool_destroy(ast->exp_pool);
+    slab_destroy(ast->slab);
+    return time;
+}
+
+// hugepage_bench chases pointers through a large expression pool with each page mode
+void hugepage_bench() {
+    const char *names[] = { "default", "transparent", "explicit" };
+    pool_page_mode modes[] = { pool_pages_default, pool_pages_transparent, pool_pages_explicit };
+
+    printf("%12s %12s %16s\n", "mode", "walk (s)", "dTLB misses");
+    for (int m = 0; m < 3; m++) {
+        long long misses;
+        double time = hugepage_bench_mode(modes[m], &misses);
+        if (misses >= 0) {
+            printf("%12s %12.4f %16lld\n", names[m], time, misses);
+        } else {
+            printf("%12s %12.4f %16s\n", names[m], time, "n/a");
+        }
+    }
+}
@@ -32,6 +32,54 @@ int runLLVMModule(Irgen *irgen) {
     return res;
 }
 
+// counts the instructions in every function of module
+int countInstructions(LLVMModuleRef module) {
+    int count = 0;
+    for (LLVMValueRef f = LLVMGetFirstFunction(module); f != NULL; f = LLVMGetNextFunction(f)) {
+        for (LLVMBasicBlockRef b = LLVMGetFirstBasicBlock(f); b != NULL; b = LLVMGetNextBasicBlock(b)) {
+            for (LLVMValueRef i = LLVMGetFirstInstruction(b); i != NULL; i = LLVMGetNextInstruction(i)) {
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+// counts the instructions with opcode in the function called name
+int countOpcode(LLVMModuleRef module, const char *name, LLVMOpcode opcode) {
+    int count = 0;
+    LLVMValueRef f = LLVMGetNamedFunction(module, name);
+    for (LLVMBasicBlockRef b = LLVMGetFirstBasicBlock(f); b != NULL; b = LLVMGetNextBasicBlock(b)) {
+        for (LLVMValueRef i = LLVMGetFirstInstruction(b); i != NULL; i = LLVMGetNextInstruction(i)) {
+            if (LLVMGetInstructionOpcode(i) == opcode) count++;
+        }
+    }
+    return count;
+}
+
+// compileModule parses, checks and compiles every declaration in src, leaving the
+// module for the caller to inspect before running it
+Irgen *compileModule(const char *src, bool direct_ssa) {
+    parser *p = new_parser(Lex((char *)src));
+    ast_unit *f = parse_file(p);
+
+    Irgen *irgen = NewIrgen();
+    irgen->direct_ssa = direct_ssa;
+    EXPECT_EQ(0, CheckUnit(NewChecker(irgen->types), f));
+    for (int i = 0; i < f->dclCount; i++) {
+        CompileFunction(irgen, f->dcls[i]);
+    }
+    return irgen;
+}
+
+// runVerifiedModule verifies the module of irgen and returns the result of its main
+int runVerifiedModule(Irgen *irgen) {
+    char *error = (char *)NULL;
+    EXPECT_FALSE(LLVMVerifyModule(irgen->module, LLVMPrintMessageAction, &error));
+    LLVMDisposeMessage(error);
+    return runLLVMModule(irgen);
+}
+
 void TEST_ERROR(char *src, TokenType type) {
     parser *p = new_parser(Lex(src));
     ast_unit *f = parse_file(p);
@@ -42,29 +90,41 @@ void TEST_ERROR(char *src, TokenType type) {
 }
 
 void TEST_MODULE(char *src, int out) {
-    /* generate module */
+    Irgen *irgen = compileModule(src, false);
+    ASSERT_EQ(out, runVerifiedModule(irgen));
+    LLVMDisposeBuilder(irgen->builder);
+}
+
+// compiles src with hash consed expressions and value reuse, checks the
+// module runs and returns the instruction count
+int TEST_MODULE_SHARED(char *src, int out) {
     parser *p = new_parser(Lex(src));
+    ast_unit_enable_hash_consing(p->ast);
     ast_unit *f = parse_file(p);
-    
+
     Irgen *irgen = NewIrgen();
-    
+    irgen->reuse_values = true;
+    EXPECT_EQ(0, CheckUnit(NewChecker(irgen->types), f));
     for (int i = 0; i < f->dclCount; i++) {
         CompileFunction(irgen, f->dcls[i]);
     }
 
-    // LLVMDumpModule(irgen->module);
-
-    /* check for errors in module */
     char *error = (char *)NULL;
-    LLVMVerifyModule(irgen->module, LLVMPrintMessageAction, &error);
+    EXPECT_FALSE(LLVMVerifyModule(irgen->module, LLVMPrintMessageAction, &error));
     LLVMDisposeMessage(error);
 
-    /* run the function */
-    int res = runLLVMModule(irgen);
-    ASSERT_EQ(out, res);
+    int count = countInstructions(irgen->module);
+    EXPECT_EQ(out, runLLVMModule(irgen));
+    return count;
+}
 
-    /* dispose of builder */
-    LLVMDisposeBuilder(irgen->builder);
+// compiles src with scalar variables in registers, checks the module runs and
+// returns the instruction count
+int TEST_MODULE_SSA(char *src, int out) {
+    Irgen *irgen = compileModule(src, true);
+    int count = countInstructions(irgen->module);
+    EXPECT_EQ(out, runVerifiedModule(irgen));
+    return count;
 }
 
 char *loadTest(std::string name) {
@@ -170,6 +230,52 @@ TEST(IntegrationTest, CompileFunctionBubblesort) {
     TEST_MODULE(loadTest("bubblesort.acl"), 123);
 }
 
+TEST(IntegrationTest, CompileFunctionForwardCall) {
+    TEST_MODULE(loadTest("forwardCall.acl"), 123);
+}
+
+TEST(IntegrationTest, UntypedConstantArithmetic) {
+    // untyped int arithmetic keeps integer semantics when the result is a float,
+    // only a bare literal takes the float type directly
+    TEST_MODULE((char *)
+        "proc main :: -> int {\n"
+        "    var float x = 7 / 2\n"
+        "    var f64 y = 7 % 4\n"
+        "    var float z = 7\n"
+        "    if x == 3.0 && y == 3.0 && z / 2 == 3.5 {\n"
+        "        return 123\n"
+        "    }\n"
+        "    return 0\n"
+        "}", 123);
+}
+
+TEST(IntegrationTest, WideIntWithFloat) {
+    // 16777217 does not fit the 24 bit mantissa of an f32, so a + b is an f64
+    TEST_MODULE((char *)
+        "proc main :: -> int {\n"
+        "    var i64 a = 16777217\n"
+        "    var f32 b = 0.0\n"
+        "    var i64 c = a + b\n"
+        "    if c == 16777217 {\n"
+        "        return 123\n"
+        "    }\n"
+        "    return 0\n"
+        "}", 123);
+}
+
+TEST(IntegrationTest, WideIntWithUntypedFloat) {
+    // an untyped float follows the same rule, a + 0.0 is an f64 and keeps a exact
+    TEST_MODULE((char *)
+        "proc main :: -> int {\n"
+        "    var i64 a = 16777217\n"
+        "    var i64 c = a + 0.0\n"
+        "    if c == 16777217 {\n"
+        "        return 123\n"
+        "    }\n"
+        "    return 0\n"
+        "}", 123);
+}
+
 TEST(IntegrationTest, CompileFunctionProcColonError) {
     TEST_ERROR(loadTest("procColonError.acl"), DOUBLE_COLON);
 }
@@ -188,4 +294,556 @@ TEST(IntegrationTest, CompileFunctionVarEqualError) {
 
 TEST(IntegrationTest, CompileFunctionVarNameError) {
     TEST_ERROR(loadTest("varNameError.acl"), IDENT);
-}
\ No newline at end of file
+}
+
+TEST(IntegrationTest, SharedExpsPrograms) {
+    for (int i = 0; i < test_program_count; i++) {
+        TEST_MODULE_SHARED(loadTest(test_programs[i].name), test_programs[i].result);
+    }
+}
+
+TEST(IntegrationTest, SharedExpsBubblesort) {
+    char *src = loadTest("bubblesort.acl");
+
+    // compile without sharing
+    parser *p = new_parser(Lex(src));
+    ast_unit *f = parse_file(p);
+    Irgen *irgen = NewIrgen();
+    CheckUnit(NewChecker(irgen->types), f);
+    for (int i = 0; i < f->dclCount; i++) {
+        CompileFunction(irgen, f->dcls[i]);
+    }
+    int unshared = countInstructions(irgen->module);
+    int unsharedNodes = pool_count(f->exp_pool);
+
+    // compile with sharing
+    p = new_parser(Lex(src));
+    ast_unit_enable_hash_consing(p->ast);
+    f = parse_file(p);
+    ASSERT_GT(f->exp_table->shared, 0);
+    ASSERT_LT(pool_count(f->exp_pool), unsharedNodes);
+
+    int shared = TEST_MODULE_SHARED(src, 123);
+    ASSERT_LT(shared, unshared);
+}
+
+TEST(IntegrationTest, PipelineKeepsSharingInsideDeclarations) {
+    // nodes handed to the checker thread get their types written, so the
+    // parser must not reuse them in later declarations
+    char *src = (char *)"proc a :: -> int { return 3 * 4 + 3 * 4 }\n"
+                        "proc b :: -> int { return 3 * 4 }\n"
+                        "proc main :: -> int { return a() + b() }";
+    Irgen *irgen = NewIrgen();
+    Checker *checker = NewChecker(irgen->types);
+    pipeline pl;
+    ast_unit *ast = pipeline_compile(&pl, src, irgen, checker, true);
+    ASSERT_EQ(0, queue_size(checker->errors));
+    ASSERT_GT(ast->exp_table->shared, 0);
+
+    Exp *sum = ast->dcls[0]->function.body->block.smts[0].ret.result;
+    Exp *product = ast->dcls[1]->function.body->block.smts[0].ret.result;
+    ASSERT_EQ(sum->binary.left, sum->binary.right);
+    ASSERT_NE(sum->binary.left, product);
+    EXPECT_EQ(36, runLLVMModule(irgen));
+}
+
+TEST(IntegrationTest, PipelinePrograms) {
+    for (int i = 0; i < test_program_count; i++) {
+        Irgen *irgen = NewIrgen();
+        Checker *checker = NewChecker(irgen->types);
+        pipeline pl;
+        ast_unit *ast = pipeline_compile(&pl, loadTest(test_programs[i].name), irgen, checker, false);
+        EXPECT_EQ(0, queue_size(pl.parser->error_queue));
+        EXPECT_EQ(0, queue_size(checker->errors));
+        ASSERT_GT(ast->dclCount, 0);
+
+        EXPECT_EQ(test_programs[i].result, runVerifiedModule(irgen)) << test_programs[i].name;
+    }
+}
+
+TEST(IntegrationTest, PipelineParseErrors) {
+    // declarations after a parse error are never checked or compiled
+    const char *names[] = {
+        "procArrowError.acl", "procColonError.acl", "procNameError.acl",
+        "varEqualError.acl", "varNameError.acl",
+    };
+    for (int i = 0; i < sizeof(names) / sizeof(char *); i++) {
+        Irgen *irgen = NewIrgen();
+        Checker *checker = NewChecker(irgen->types);
+        pipeline pl;
+        pipeline_compile(&pl, loadTest(names[i]), irgen, checker, false);
+        EXPECT_GT(queue_size(pl.parser->error_queue), 0) << names[i];
+        EXPECT_EQ(0, queue_size(checker->errors)) << names[i];
+        EXPECT_EQ(NULL, LLVMGetFirstFunction(irgen->module)) << names[i];
+    }
+}
+
+TEST(IntegrationTest, PipelineWaitsForCalleesToCheck) {
+    // main is complete before f arrives, but f's signature has a type error so
+    // main must not be compiled against it
+    const char *src =
+        "proc main :: -> int { return f(1) }\n"
+        "proc f :: foo a -> int { return 1 }";
+    Irgen *irgen = NewIrgen();
+    Checker *checker = NewChecker(irgen->types);
+    pipeline pl;
+    pipeline_compile(&pl, (char *)src, irgen, checker, false);
+    EXPECT_EQ(1, queue_size(checker->errors));
+    EXPECT_EQ(NULL, LLVMGetFirstFunction(irgen->module));
+}
+
+TEST(IntegrationTest, PipelineMutualRecursion) {
+    const char *src =
+        "proc main :: -> int { return even(10) + odd(7) }\n"
+        "proc even :: int n -> int {\n"
+        "    if n == 0 { return 1 }\n"
+        "    return odd(n - 1)\n"
+        "}\n"
+        "proc odd :: int n -> int {\n"
+        "    if n == 0 { return 0 }\n"
+        "    return even(n - 1)\n"
+        "}";
+    Irgen *irgen = NewIrgen();
+    Checker *checker = NewChecker(irgen->types);
+    pipeline pl;
+    pipeline_compile(&pl, (char *)src, irgen, checker, false);
+    ASSERT_EQ(0, queue_size(checker->errors));
+    EXPECT_EQ(2, runLLVMModule(irgen));
+}
+
+TEST(IntegrationTest, AllocasInEntryBlock) {
+    const char *src =
+        "proc main :: -> int {\n"
+        "    s := 0\n"
+        "    for i := 0; i < 3; i++ {\n"
+        "        a := [i, 40]\n"
+        "        for j := 0; j < 1; j++ {\n"
+        "            t := a[1] + 1\n"
+        "            s = s + t\n"
+        "        }\n"
+        "    }\n"
+        "    return s\n"
+        "}";
+    Irgen *irgen = compileModule(src, false);
+
+    // every local is allocated once in the entry block, the loops only store to them
+    LLVMValueRef main = LLVMGetNamedFunction(irgen->module, "main");
+    LLVMBasicBlockRef entry = LLVMGetEntryBasicBlock(main);
+    int allocas = 0;
+    for (LLVMBasicBlockRef b = LLVMGetFirstBasicBlock(main); b != NULL; b = LLVMGetNextBasicBlock(b)) {
+        for (LLVMValueRef i = LLVMGetFirstInstruction(b); i != NULL; i = LLVMGetNextInstruction(i)) {
+            if (LLVMGetInstructionOpcode(i) != LLVMAlloca) continue;
+            EXPECT_EQ(entry, b);
+            EXPECT_STRNE("allocapt", LLVMGetValueName(i));
+            allocas++;
+        }
+    }
+    ASSERT_EQ(5, allocas);
+
+    EXPECT_EQ(123, runVerifiedModule(irgen));
+}
+
+TEST(IntegrationTest, DirectSSAPrograms) {
+    for (int i = 0; i < test_program_count; i++) {
+        TEST_MODULE_SSA(loadTest(test_programs[i].name), test_programs[i].result);
+    }
+}
+
+TEST(IntegrationTest, DirectSSAPipeline) {
+    Irgen *irgen = NewIrgen();
+    irgen->direct_ssa = true;
+    Checker *checker = NewChecker(irgen->types);
+    pipeline pl;
+    pipeline_compile(&pl, loadTest("bubblesort.acl"), irgen, checker, false);
+    ASSERT_EQ(0, queue_size(checker->errors));
+    EXPECT_EQ(123, runLLVMModule(irgen));
+}
+
+TEST(IntegrationTest, DirectSSASkipsAllocas) {
+    char *src = loadTest("gcd.acl");
+
+    parser *p = new_parser(Lex(src));
+    ast_unit *f = parse_file(p);
+    Irgen *irgen = NewIrgen();
+    CheckUnit(NewChecker(irgen->types), f);
+    for (int i = 0; i < f->dclCount; i++) {
+        CompileFunction(irgen, f->dcls[i]);
+    }
+    int allocas = countInstructions(irgen->module);
+
+    p = new_parser(Lex(src));
+    f = parse_file(p);
+    irgen = NewIrgen();
+    irgen->direct_ssa = true;
+    CheckUnit(NewChecker(irgen->types), f);
+    for (int i = 0; i < f->dclCount; i++) {
+        CompileFunction(irgen, f->dcls[i]);
+    }
+    for (LLVMValueRef fn = LLVMGetFirstFunction(irgen->module); fn != NULL; fn = LLVMGetNextFunction(fn)) {
+        EXPECT_EQ(0, countOpcode(irgen->module, LLVMGetValueName(fn), LLVMAlloca));
+        EXPECT_EQ(0, countOpcode(irgen->module, LLVMGetValueName(fn), LLVMLoad));
+    }
+    ASSERT_LT(countInstructions(irgen->module), allocas);
+}
+
+TEST(IntegrationTest, DirectSSAPhis) {
+    // k and s are never assigned in the loop so only i and t need phis
+    const char *src =
+        "proc main :: -> int {\n"
+        "    k := 3\n"
+        "    s := 120\n"
+        "    t := 0\n"
+        "    for i := 0; i < 10; i++ {\n"
+        "        if i == k {\n"
+        "            t = k\n"
+        "        }\n"
+        "    }\n"
+        "    return s + t\n"
+        "}";
+    Irgen *irgen = compileModule(src, true);
+
+    // i and t merge at the loop header and t at the end of the if, the exit is only
+    // reached from the header so t needs no phi after the loop
+    EXPECT_EQ(3, countOpcode(irgen->module, "main", LLVMPHI));
+
+    EXPECT_EQ(123, runVerifiedModule(irgen));
+}
+
+TEST(IntegrationTest, FoldsConstantsAndIdentities) {
+    const char *src =
+        "proc f :: int a -> int {\n"
+        "    return 2 * 3 - 6 + a * 1 + 0 - a * 0 + a % 1\n"
+        "}\n"
+        "proc g :: float x -> float {\n"
+        "    return x * 1.0 / 1 - 0.0 + 0.0\n"
+        "}\n"
+        "proc h :: i8 a, float x -> int {\n"
+        "    return -a + -x\n"
+        "}\n"
+        "proc main :: -> int {\n"
+        "    return f(-3) + g(0.0) + h(-126, 0.0)\n"
+        "}";
+    Irgen *irgen = compileModule(src, true);
+
+    // every integer operation folds away, f only returns its argument
+    LLVMOpcode arithmetic[] = {LLVMAdd, LLVMSub, LLVMMul, LLVMSDiv, LLVMSRem};
+    for (int i = 0; i < sizeof(arithmetic) / sizeof(LLVMOpcode); i++) {
+        EXPECT_EQ(0, countOpcode(irgen->module, "f", arithmetic[i]));
+    }
+    LLVMValueRef ret = LLVMGetLastInstruction(LLVMGetLastBasicBlock(LLVMGetNamedFunction(irgen->module, "f")));
+    ASSERT_EQ(LLVMGetParam(LLVMGetNamedFunction(irgen->module, "f"), 0), LLVMGetOperand(ret, 0));
+
+    // x + 0.0 is not x for x = -0.0 so only the fadd is kept
+    EXPECT_EQ(0, countOpcode(irgen->module, "g", LLVMFMul));
+    EXPECT_EQ(0, countOpcode(irgen->module, "g", LLVMFDiv));
+    EXPECT_EQ(0, countOpcode(irgen->module, "g", LLVMFSub));
+    EXPECT_EQ(1, countOpcode(irgen->module, "g", LLVMFAdd));
+
+    // negation is a single instruction at the operands width
+    EXPECT_EQ(0, countOpcode(irgen->module, "h", LLVMMul));
+    EXPECT_EQ(0, countOpcode(irgen->module, "h", LLVMFMul));
+    EXPECT_EQ(1, countOpcode(irgen->module, "h", LLVMSub));
+    EXPECT_EQ(1, countOpcode(irgen->module, "h", LLVMFNeg));
+
+    EXPECT_EQ(123, runVerifiedModule(irgen));
+}
+
+TEST(IntegrationTest, ConstantArrayLiterals) {
+    // table is only read, copy is written and dynamic has an element only known at runtime
+    const char *src =
+        "proc main :: -> int {\n"
+        "    n := 3\n"
+        "    table := [100, 20, 3, 7]\n"
+        "    copy := [1, 2, 3]\n"
+        "    copy[1] = table[1]\n"
+        "    dynamic := [n, 0]\n"
+        "    return table[0] + copy[1] + dynamic[0]\n"
+        "}";
+    Irgen *irgen = compileModule(src, false);
+
+    // the constant literals become private constant globals
+    int globals = 0;
+    for (LLVMValueRef g = LLVMGetFirstGlobal(irgen->module); g != NULL; g = LLVMGetNextGlobal(g)) {
+        EXPECT_TRUE(LLVMIsGlobalConstant(g));
+        EXPECT_EQ(LLVMPrivateLinkage, LLVMGetLinkage(g));
+        EXPECT_EQ(LLVMGlobalUnnamedAddr, LLVMGetUnnamedAddress(g));
+        globals++;
+    }
+    EXPECT_EQ(2, globals);
+
+    // only copy is memcpyd to the stack, table is read from its global
+    EXPECT_EQ(1, countOpcode(irgen->module, "main", LLVMCall));
+    // n, copy[1] = table[1] and the two elements of dynamic
+    EXPECT_EQ(4, countOpcode(irgen->module, "main", LLVMStore));
+    // n, copy and dynamic
+    EXPECT_EQ(3, countOpcode(irgen->module, "main", LLVMAlloca));
+
+    EXPECT_EQ(123, runVerifiedModule(irgen));
+}
+
+// hasParamAttribute returns true if the parameter at index of function has the attribute name
+bool hasParamAttribute(LLVMValueRef function, int index, const char *name) {
+    unsigned kind = LLVMGetEnumAttributeKindForName(name, strlen(name));
+    return LLVMGetEnumAttributeAtIndex(function, index + 1, kind) != NULL;
+}
+
+TEST(IntegrationTest, ArraysByReference) {
+    // zero writes its own copy of xs, twice returns a new array through sret
+    const char *src =
+        "proc zero :: int[3] xs -> int {\n"
+        "    xs[0] = 0\n"
+        "    return xs[0]\n"
+        "}\n"
+        "proc twice :: int[3] xs -> int[3] {\n"
+        "    ys := xs\n"
+        "    ys[0] = xs[0] * 2\n"
+        "    return ys\n"
+        "}\n"
+        "proc main :: -> int {\n"
+        "    a := [50, 20, 3]\n"
+        "    z := zero(a)\n"
+        "    b := twice(a)\n"
+        "    a = twice(a)\n"
+        "    return a[0] + b[1] + b[2] + z\n"
+        "}";
+    Irgen *irgen = compileModule(src, false);
+
+    // arrays are passed as readonly pointers, only the callee that writes copies it
+    LLVMValueRef zero = LLVMGetNamedFunction(irgen->module, "zero");
+    ASSERT_EQ(LLVMPointerTypeKind, LLVMGetTypeKind(LLVMTypeOf(LLVMGetParam(zero, 0))));
+    EXPECT_TRUE(hasParamAttribute(zero, 0, "readonly"));
+    EXPECT_TRUE(hasParamAttribute(zero, 0, "noalias"));
+    EXPECT_EQ(1, countOpcode(irgen->module, "zero", LLVMCall));
+
+    // twice returns void and writes its result to the sret pointer
+    LLVMValueRef twice = LLVMGetNamedFunction(irgen->module, "twice");
+    ASSERT_EQ(2, LLVMCountParams(twice));
+    EXPECT_EQ(LLVMVoidTypeKind, LLVMGetTypeKind(LLVMGetReturnType(LLVMGetElementType(LLVMTypeOf(twice)))));
+    unsigned sret = LLVMGetEnumAttributeKindForName("sret", 4);
+    EXPECT_NE((LLVMAttributeRef)NULL, LLVMGetEnumAttributeAtIndex(twice, 1, sret));
+
+    // b uses the storage of its call, a = twice(a) copies the result into a, so main
+    // allocates a, z, b and the result of the assigned call and copies a twice
+    EXPECT_EQ(5, countOpcode(irgen->module, "main", LLVMCall));
+    EXPECT_EQ(4, countOpcode(irgen->module, "main", LLVMAlloca));
+
+    EXPECT_EQ(123, runVerifiedModule(irgen));
+}
+
+// countUses counts the uses of value
+int countUses(LLVMValueRef value) {
+    int count = 0;
+    for (LLVMUseRef use = LLVMGetFirstUse(value); use != NULL; use = LLVMGetNextUse(use)) {
+        count++;
+    }
+    return count;
+}
+
+TEST(IntegrationTest, CanonicalLoops) {
+    Irgen *irgen = compileModule(loadTest("nestedFor.acl"), false);
+
+    // each condition is only compiled in its loops header
+    EXPECT_EQ(2, countOpcode(irgen->module, "main", LLVMICmp));
+
+    unsigned loopKind = LLVMGetMDKindID("llvm.loop", 9);
+    LLVMValueRef ids[2];
+    int latches = 0;
+    LLVMValueRef main = LLVMGetNamedFunction(irgen->module, "main");
+    for (LLVMBasicBlockRef b = LLVMGetFirstBasicBlock(main); b != NULL; b = LLVMGetNextBasicBlock(b)) {
+        LLVMValueRef branch = LLVMGetBasicBlockTerminator(b);
+        LLVMValueRef id = LLVMGetMetadata(branch, loopKind);
+        if (id == NULL) continue;
+        ASSERT_LT(latches, 2);
+        ids[latches++] = id;
+
+        // the latch is the only back edge to a header entered from the preheader,
+        // the header is the only way to the exit
+        ASSERT_FALSE(LLVMIsConditional(branch));
+        LLVMBasicBlockRef header = LLVMGetSuccessor(branch, 0);
+        EXPECT_EQ(2, countUses(LLVMBasicBlockAsValue(header)));
+        LLVMBasicBlockRef exit = LLVMGetSuccessor(LLVMGetBasicBlockTerminator(header), 1);
+        EXPECT_EQ(1, countUses(LLVMBasicBlockAsValue(exit)));
+    }
+    ASSERT_EQ(2, latches);
+    EXPECT_NE(ids[0], ids[1]);
+
+    EXPECT_EQ(123, runVerifiedModule(irgen));
+}
+
+TEST(IntegrationTest, BitwiseOperators) {
+    const char *src =
+        "proc bits :: int a, int b, i8 c, int n -> int {\n"
+        "    r := a & b | 112\n"
+        "    r ^= 11\n"
+        "    r &^= 1\n"
+        "    r <<= 2\n"
+        "    r >>= 3\n"
+        "    s := c >> n\n"
+        "    t := 1 << n\n"
+        "    up := a > b\n"
+        "    down := b > a\n"
+        "    if up ^ down {\n"
+        "        return r + s + t\n"
+        "    }\n"
+        "    return 0\n"
+        "}\n"
+        "proc main :: -> int {\n"
+        "    return bits(90, 15, -64, 3) + 67\n"
+        "}";
+    Irgen *irgen = compileModule(src, true);
+
+    // each operator is one instruction, &^ a constant is an and with its complement
+    // and right shifts are arithmetic since ints are signed
+    EXPECT_EQ(2, countOpcode(irgen->module, "bits", LLVMAnd));
+    EXPECT_EQ(1, countOpcode(irgen->module, "bits", LLVMOr));
+    EXPECT_EQ(2, countOpcode(irgen->module, "bits", LLVMXor));
+    EXPECT_EQ(2, countOpcode(irgen->module, "bits", LLVMShl));
+    EXPECT_EQ(2, countOpcode(irgen->module, "bits", LLVMAShr));
+    EXPECT_EQ(0, countOpcode(irgen->module, "bits", LLVMLShr));
+
+    EXPECT_EQ(123, runVerifiedModule(irgen));
+}
+
+TEST(IntegrationTest, ShortCircuit) {
+    // the division in f would trap if b were 0 so it is branched around, the
+    // comparisons in g cant trap so g selects without branching
+    const char *src =
+        "proc f :: int a, int b -> bool {\n"
+        "    return b != 0 && a / b > 1 || a == 0\n"
+        "}\n"
+        "proc g :: int a, int b, int c -> bool {\n"
+        "    return a < b && b < c || c == 0\n"
+        "}\n"
+        "proc main :: -> int {\n"
+        "    r := 0\n"
+        "    if f(10, 0) || f(0, 0) {\n"
+        "        r = 100\n"
+        "    }\n"
+        "    if f(10, 2) && g(1, 2, 3) && g(3, 2, 0) {\n"
+        "        r += 23\n"
+        "    }\n"
+        "    return r\n"
+        "}";
+    Irgen *irgen = compileModule(src, true);
+
+    EXPECT_EQ(1, countOpcode(irgen->module, "f", LLVMPHI));
+    EXPECT_EQ(1, countOpcode(irgen->module, "f", LLVMSelect));
+    EXPECT_EQ(1, countOpcode(irgen->module, "f", LLVMSDiv));
+    EXPECT_EQ(1, LLVMCountBasicBlocks(LLVMGetNamedFunction(irgen->module, "g")));
+    EXPECT_EQ(2, countOpcode(irgen->module, "g", LLVMSelect));
+
+    // calls may have side effects so the later calls in main are only made when needed,
+    // there is a phi for each && and || and one for r after each if
+    EXPECT_EQ(0, countOpcode(irgen->module, "main", LLVMSelect));
+    EXPECT_EQ(5, countOpcode(irgen->module, "main", LLVMPHI));
+
+    EXPECT_EQ(123, runVerifiedModule(irgen));
+}
+
+TEST(IntegrationTest, Switch) {
+    // step dispatches with a single switch whatever the number of cases
+    const char *src =
+        "proc step :: int op, int acc -> int {\n"
+        "    switch op {\n"
+        "    case 0, 1:\n"
+        "        acc += 1\n"
+        "    case 2:\n"
+        "        acc *= 2\n"
+        "        fallthrough\n"
+        "    case 3:\n"
+        "        acc += 3\n"
+        "    case 4, 5:\n"
+        "        return acc - 1\n"
+        "    default:\n"
+        "        acc += 10\n"
+        "    }\n"
+        "    return acc\n"
+        "}\n"
+        "proc main :: -> int {\n"
+        "    acc := 0\n"
+        "    acc = step(0, acc)\n"
+        "    acc = step(2, acc)\n"
+        "    acc = step(3, acc)\n"
+        "    acc = step(5, acc)\n"
+        "    acc = step(9, acc)\n"
+        "    acc = step(9, acc)\n"
+        "    switch acc {\n"
+        "    case 1:\n"
+        "        acc = 0\n"
+        "    }\n"
+        "    acc = step(1, acc * 4)\n"
+        "    return acc + 14\n"
+        "}";
+    Irgen *irgen = compileModule(src, true);
+
+    EXPECT_EQ(1, countOpcode(irgen->module, "step", LLVMSwitch));
+    EXPECT_EQ(0, countOpcode(irgen->module, "step", LLVMICmp));
+    LLVMValueRef dispatch = LLVMGetBasicBlockTerminator(
+        LLVMGetEntryBasicBlock(LLVMGetNamedFunction(irgen->module, "step")));
+    EXPECT_EQ(LLVMSwitch, LLVMGetInstructionOpcode(dispatch));
+    // the default plus one successor for each distinct case value
+    EXPECT_EQ(7, LLVMGetNumSuccessors(dispatch));
+
+    EXPECT_EQ(123, runVerifiedModule(irgen));
+}
+
+TEST(IntegrationTest, BreakContinue) {
+    // break in a switch leaves the switch, continue in it goes to the next iteration
+    const char *src =
+        "proc find :: int[8] xs, int x -> int {\n"
+        "    found := 100\n"
+        "    for i := 0; i < 8; i++ {\n"
+        "        if xs[i] == x {\n"
+        "            found = i\n"
+        "            break\n"
+        "        }\n"
+        "    }\n"
+        "    return found\n"
+        "}\n"
+        "proc pairs :: int n -> int {\n"
+        "    count := 0\n"
+        "    for i := 0; i < n; i++ {\n"
+        "        if i & 1 == 1 {\n"
+        "            continue\n"
+        "        }\n"
+        "        for j := 0; j < n; j++ {\n"
+        "            if j > i {\n"
+        "                break\n"
+        "            }\n"
+        "            if j == 2 {\n"
+        "                continue\n"
+        "            }\n"
+        "            count += 1\n"
+        "        }\n"
+        "    }\n"
+        "    return count\n"
+        "}\n"
+        "proc main :: -> int {\n"
+        "    xs := [5, 3, 9, 7, 1, 8, 2, 6]\n"
+        "    d := 0\n"
+        "    for k := 0; k < 10; k++ {\n"
+        "        switch k {\n"
+        "        case 3:\n"
+        "            break\n"
+        "            d = 100\n"
+        "        case 5:\n"
+        "            continue\n"
+        "        }\n"
+        "        d += 1\n"
+        "    }\n"
+        "    return find(xs, 7) + find(xs, 4) + pairs(10) + d - 10\n"
+        "}";
+    for (int direct = 0; direct < 2; direct++) {
+        Irgen *irgen = compileModule(src, direct);
+
+        // the loop keeps a single back edge from its latch and break goes straight
+        // to the exit, which is the headers false successor
+        LLVMValueRef find = LLVMGetNamedFunction(irgen->module, "find");
+        LLVMBasicBlockRef header = LLVMGetNextBasicBlock(LLVMGetEntryBasicBlock(find));
+        EXPECT_EQ(2, countUses(LLVMBasicBlockAsValue(header)));
+        LLVMBasicBlockRef exit = LLVMGetSuccessor(LLVMGetBasicBlockTerminator(header), 1);
+        EXPECT_EQ(2, countUses(LLVMBasicBlockAsValue(exit)));
+
+        EXPECT_EQ(123, runVerifiedModule(irgen)) << "direct ssa " << direct;
+    }
+}
@@ -8,7 +8,7 @@
     parser *p = new_parser(Lex((char *)src));                           \
     Exp *e = parse_type(p);                                             \
     Irgen *irgen = NewIrgen();                                          \
-    LLVMTypeRef type = CompileType(e);                                  \
+    LLVMTypeRef type = CompileType(irgen, e);                           \
     ASSERT_TRUE(type == expectedType);                                  \
 }                                                                       \
 
@@ -25,6 +25,40 @@ TEST_TYPE(CompileTypeF32, "f32", LLVMFloatType())
 TEST_TYPE(CompileTypeIntArray, "int[3]", LLVMArrayType(LLVMInt64Type(), 3))
 TEST_TYPE(CompileTypeFloatArray, "float[100]", LLVMArrayType(LLVMFloatType(), 100))
 
+TEST(IrgenTest, TypeTableInternsTypes) {
+    Irgen *irgen = NewIrgen();
+    int builtins = TypeTableCount(irgen->types);
+
+    // separate expressions for the same type resolve to the same descriptor
+    Exp *a = parse_type(new_parser(Lex((char *)"int[3]")));
+    Exp *b = parse_type(new_parser(Lex((char *)"i64[3]")));
+    Exp *c = parse_type(new_parser(Lex((char *)"int[4]")));
+    Type *ta = ResolveType(irgen->types, a);
+    ASSERT_EQ(ArrayType, ta->kind);
+    ASSERT_EQ(3, ta->array.length);
+    ASSERT_EQ(LookupNamedType(irgen->types, (char *)"int"), ta->array.element);
+    ASSERT_NE(ta, ResolveType(irgen->types, b)); // int and i64 are distinct names
+    ASSERT_EQ(ta->llvm, ResolveType(irgen->types, b)->llvm);
+    ASSERT_NE(ta, ResolveType(irgen->types, c));
+    ASSERT_EQ(ta, ResolveType(irgen->types, a));
+    ASSERT_EQ(builtins + 3, TypeTableCount(irgen->types));
+
+    Exp *d = parse_type(new_parser(Lex((char *)"int[3]")));
+    ASSERT_EQ(ta, ResolveType(irgen->types, d));
+    ASSERT_EQ(builtins + 3, TypeTableCount(irgen->types));
+    DestroyTypeTable(irgen->types);
+}
+
+TEST(IrgenTest, TypeTableDescriptors) {
+    Irgen *irgen = NewIrgen();
+    Type *t = ResolveType(irgen->types, parse_type(new_parser(Lex((char *)"f64[5]"))));
+    ASSERT_EQ(ArrayType, t->kind);
+    ASSERT_EQ(FloatType, t->array.element->kind);
+    ASSERT_EQ(64, t->array.element->bits);
+    ASSERT_TRUE(LLVMGetTypeKind(t->llvm) == LLVMArrayTypeKind);
+    ASSERT_EQ(NULL, LookupNamedType(irgen->types, (char *)"string"));
+}
+
 #define TEST_LITERAL(name, src, expectedType, expectedValue) TEST(IrgenTest, name) {    \
     parser *p = new_parser(Lex((char *)src));                                           \
     Exp *e = parse_expression(p, 0);                                                    \
@@ -151,11 +151,26 @@ TEST(LexerTest, Symbols) {
 TEST(LexerTest, LineNumbers) {
     Token *tokens = Lex((char *)"1\n2\n3");
     
+    // numbers are seperated by the semicolons inserted at each newline
     for (int i = 0; i < 3; i++) {
-        ASSERT_EQ(i+1, tokens[i].line);	
+        ASSERT_EQ(i+1, tokens[i*2].line);	
+        if (i < 2) ASSERT_EQ(i+1, tokens[i*2+1].line);
     }
 }
 
+TEST(LexerTest, SymbolColumnsAndBlankLines) {
+    Token *tokens = Lex((char *)"a := b\n\n    c -> d");
+
+    ASSERT_EQ(1, tokens[0].column);
+    ASSERT_EQ(3, tokens[1].column);
+    ASSERT_EQ(6, tokens[2].column);
+    ASSERT_EQ(3, tokens[4].line);
+    ASSERT_EQ(5, tokens[4].column);
+    ASSERT_EQ(7, tokens[5].column);
+    ASSERT_EQ(10, tokens[6].column);
+    ASSERT_EQ(3, tokens[6].line);
+}
+
 TEST(LexerTest, ColumnNumbers) {
     Token *tokens = Lex((char *)"foo bar baz");
 
@@ -167,4 +182,10 @@ TEST(LexerTest, ColumnNumbers) {
 TEST(LexerTest, SemiColonInsertion) {
     Token *tokens = Lex((char *)"foo\nbar");
     ASSERT_STREQ(TokenName(SEMI), TokenName(tokens[1].type));
-}
\ No newline at end of file
+}
+
+TEST(LexerTest, NoSemiColonAfterColon) {
+    Token *tokens = Lex((char *)"case 1:\nfoo");
+    ASSERT_STREQ(TokenName(COLON), TokenName(tokens[2].type));
+    ASSERT_STREQ(TokenName(IDENT), TokenName(tokens[3].type));
+}
@@ -0,0 +1,96 @@
+#define MPMC_BENCH_ITEMS 1000000
+#define MPMC_BENCH_CAPACITY 1024
+
+// mutex_queue is the single threaded queue behind a lock, the baseline for the lock-free queue
+struct mutex_queue {
+    queue *q;
+    std::mutex lock;
+    bool closed;
+};
+
+// mpmc_bench_lockfree runs a producer or consumer on the lock-free queue
+void mpmc_bench_lockfree(mpmc_queue *q, bool producer, int items) {
+    long value = 0;
+    if (producer) {
+        for (int i = 0; i < items; i++) mpmc_queue_push(q, &value);
+    } else {
+        while (mpmc_queue_pop(q, &value)) {}
+    }
+}
+
+// mpmc_bench_locked runs a producer or consumer on the mutex guarded queue
+void mpmc_bench_locked(mutex_queue *mq, bool producer, int items) {
+    if (producer) {
+        for (int i = 0; i < items; i++) {
+            mq->lock.lock();
+            pool_adopt(mq->q->item_pool);
+            *(long *)queue_push_back(mq->q) = i;
+            pool_handoff(mq->q->item_pool);
+            mq->lock.unlock();
+        }
+        return;
+    }
+
+    for (;;) {
+        mq->lock.lock();
+        void *item = queue_pop_front(mq->q);
+        if (item != NULL) queue_free_item(item);
+        bool done = item == NULL && mq->closed;
+        mq->lock.unlock();
+        if (done) return;
+        if (item == NULL) std::this_thread::yield();
+    }
+}
+
+// mpmc_bench_run splits threads into producers and consumers, passing MPMC_BENCH_ITEMS
+// elements through the queue, returns the time taken
+template <typename Q>
+double mpmc_bench_run(Q *q, void (*worker)(Q *, bool, int), void (*close)(Q *), int threads) {
+    int producers = threads > 1 ? threads / 2 : 1;
+    int consumers = threads > 1 ? threads - producers : 1;
+    std::vector<std::thread> producing, consuming;
+
+    double start = bench_now();
+    for (int t = 0; t < consumers; t++) {
+        consuming.push_back(std::thread(worker, q, false, 0));
+    }
+    for (int t = 0; t < producers; t++) {
+        producing.push_back(std::thread(worker, q, true, MPMC_BENCH_ITEMS / producers));
+    }
+    for (auto &producer : producing) producer.join();
+    close(q);
+    for (auto &consumer : consuming) consumer.join();
+    return bench_now() - start;
+}
+
+void mpmc_bench_close_lockfree(mpmc_queue *q) {
+    mpmc_queue_close(q);
+}
+
+void mpmc_bench_close_locked(mutex_queue *mq) {
+    mq->lock.lock();
+    mq->closed = true;
+    mq->lock.unlock();
+}
+
+// mpmc_bench measures throughput of the lock-free and mutex guarded queues
+// from 1 to 64 threads, half producing and half consuming
+void mpmc_bench() {
+    printf("%8s %14s %14s %14s %14s\n", "threads", "lockfree (s)", "lockfree Mop/s", "mutex (s)", "mutex Mop/s");
+    for (int threads = 1; threads <= 64; threads *= 2) {
+        mpmc_queue *q = new_mpmc_queue(sizeof(long), MPMC_BENCH_CAPACITY);
+        double lockfree = mpmc_bench_run(q, mpmc_bench_lockfree, mpmc_bench_close_lockfree, threads);
+        mpmc_queue_destroy(q);
+
+        mutex_queue mq;
+        mq.q = new_queue(sizeof(long));
+        mq.closed = false;
+        pool_handoff(mq.q->item_pool); // producers adopt the item pool while they hold the lock
+        double locked = mpmc_bench_run(&mq, mpmc_bench_locked, mpmc_bench_close_locked, threads);
+        queue_destroy(mq.q);
+        free(mq.q);
+
+        double total = MPMC_BENCH_ITEMS / 1e6;
+        printf("%8d %14.4f %14.2f %14.4f %14.2f\n", threads, lockfree, total / lockfree, locked, total / locked);
+    }
+}
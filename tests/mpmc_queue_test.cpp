@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+
+TEST(MpmcQueueTest, NewQueue) {
+    mpmc_queue *q = new_mpmc_queue(sizeof(int), 100);
+    ASSERT_EQ(128, mpmc_queue_capacity(q));
+    ASSERT_EQ(0, (size_t)&q->enqueue_pos % MPMC_CACHE_LINE);
+    ASSERT_EQ(0, (size_t)&q->dequeue_pos % MPMC_CACHE_LINE);
+    mpmc_queue_destroy(q);
+}
+
+TEST(MpmcQueueTest, PushPopInOrder) {
+    mpmc_queue *q = new_mpmc_queue(sizeof(int), 8);
+    for (int round = 0; round < 4; round++) {
+        for (int i = 0; i < 8; i++) {
+            ASSERT_TRUE(mpmc_queue_try_push(q, &i));
+        }
+        for (int i = 0; i < 8; i++) {
+            int out = -1;
+            ASSERT_TRUE(mpmc_queue_try_pop(q, &out));
+            ASSERT_EQ(i, out);
+        }
+    }
+    mpmc_queue_destroy(q);
+}
+
+TEST(MpmcQueueTest, FullAndEmpty) {
+    mpmc_queue *q = new_mpmc_queue(sizeof(int), 4);
+    int value = 1;
+    ASSERT_FALSE(mpmc_queue_try_pop(q, &value));
+    for (int i = 0; i < 4; i++) {
+        ASSERT_TRUE(mpmc_queue_try_push(q, &i));
+    }
+    ASSERT_FALSE(mpmc_queue_try_push(q, &value));
+    ASSERT_TRUE(mpmc_queue_try_pop(q, &value));
+    ASSERT_EQ(0, value);
+    ASSERT_TRUE(mpmc_queue_try_push(q, &value));
+    mpmc_queue_destroy(q);
+}
+
+TEST(MpmcQueueTest, CloseWakesConsumer) {
+    mpmc_queue *q = new_mpmc_queue(sizeof(int), 4);
+    int value = 7;
+    mpmc_queue_push(q, &value);
+    mpmc_queue_close(q);
+
+    // elements pushed before the close are still popped
+    int out = 0;
+    ASSERT_TRUE(mpmc_queue_pop(q, &out));
+    ASSERT_EQ(7, out);
+    ASSERT_FALSE(mpmc_queue_pop(q, &out));
+    mpmc_queue_destroy(q);
+}
+
+#define MPMC_TEST_THREADS 4
+#define MPMC_TEST_ITEMS 20000
+
+void mpmc_test_produce(mpmc_queue *q, int id) {
+    for (int i = 0; i < MPMC_TEST_ITEMS; i++) {
+        long value = (long)id * MPMC_TEST_ITEMS + i;
+        mpmc_queue_push(q, &value);
+    }
+}
+
+void mpmc_test_consume(mpmc_queue *q, long *sum, int *count) {
+    long value;
+    while (mpmc_queue_pop(q, &value)) {
+        *sum += value;
+        (*count)++;
+    }
+}
+
+TEST(MpmcQueueTest, ManyProducersManyConsumers) {
+    // small capacity so producers and consumers wrap the ring many times
+    mpmc_queue *q = new_mpmc_queue(sizeof(long), 16);
+    long sums[MPMC_TEST_THREADS] = {0};
+    int counts[MPMC_TEST_THREADS] = {0};
+
+    std::vector<std::thread> producers, consumers;
+    for (int t = 0; t < MPMC_TEST_THREADS; t++) {
+        consumers.push_back(std::thread(mpmc_test_consume, q, &sums[t], &counts[t]));
+        producers.push_back(std::thread(mpmc_test_produce, q, t));
+    }
+    for (auto &producer : producers) producer.join();
+    mpmc_queue_close(q);
+    for (auto &consumer : consumers) consumer.join();
+
+    // every element is popped exactly once
+    long sum = 0;
+    int count = 0;
+    for (int t = 0; t < MPMC_TEST_THREADS; t++) {
+        sum += sums[t];
+        count += counts[t];
+    }
+    long n = (long)MPMC_TEST_THREADS * MPMC_TEST_ITEMS;
+    ASSERT_EQ(n, count);
+    ASSERT_EQ(n * (n - 1) / 2, sum);
+    mpmc_queue_destroy(q);
+}
@@ -0,0 +1,71 @@
+#include <llvm-c/ExecutionEngine.h>
+#include <llvm-c/Target.h>
+
+#define OPTIMIZE_BENCH_CALLS 200000
+
+// optimize_bench_run compiles src at level, jits it and times calls to its main
+double optimize_bench_run(char *src, const char *flag, int calls) {
+    parser *p = new_parser(Lex(src));
+    ast_unit *ast = parse_file(p);
+    Irgen *irgen = NewIrgen();
+    CheckUnit(NewChecker(irgen->types), ast);
+    for (int i = 0; i < ast->dclCount; i++) {
+        CompileFunction(irgen, ast->dcls[i]);
+    }
+
+    OptLevel level;
+    ParseOptLevel((char *)flag, &level);
+    OptimizeModule(irgen->module, level);
+
+    // code generation runs at the same level for every run so only the ir pipeline differs
+    LLVMExecutionEngineRef engine;
+    struct LLVMMCJITCompilerOptions options;
+    LLVMInitializeMCJITCompilerOptions(&options, sizeof(options));
+    options.OptLevel = 2;
+    char *error = NULL;
+    LLVMCreateMCJITCompilerForModule(&engine, irgen->module, &options, sizeof(options), &error);
+    long (*main)() = (long (*)())LLVMGetFunctionAddress(engine, "main");
+
+    volatile long result = 0;
+    double start = bench_now();
+    for (int i = 0; i < calls; i++) {
+        result += main();
+    }
+    double elapsed = bench_now() - start;
+
+    LLVMDisposeExecutionEngine(engine);
+    return elapsed;
+}
+
+// optimize_bench compares the runtime of the test programs at each optimization level
+void optimize_bench() {
+    LLVMLinkInMCJIT();
+    LLVMInitializeNativeTarget();
+    LLVMInitializeNativeAsmPrinter();
+
+    const char *levels[] = {"-O0", "-O1", "-O2", "-O3", "-Os"};
+    int levelCount = sizeof(levels) / sizeof(char *);
+
+    printf("%-24s", "program (ms)");
+    for (int l = 0; l < levelCount; l++) printf(" %10s", levels[l]);
+    printf("\n");
+
+    double totals[5] = {0};
+    for (int i = 0; i < test_program_count; i++) {
+        char path[256];
+        snprintf(path, sizeof(path), "../tests/tests/%s", test_programs[i].name);
+        string src = string_new_file(fopen(path, "r"));
+
+        printf("%-24s", test_programs[i].name);
+        for (int l = 0; l < levelCount; l++) {
+            double elapsed = optimize_bench_run(src, levels[l], OPTIMIZE_BENCH_CALLS) * 1000;
+            totals[l] += elapsed;
+            printf(" %10.2f", elapsed);
+        }
+        printf("\n");
+    }
+
+    printf("%-24s", "total");
+    for (int l = 0; l < levelCount; l++) printf(" %10.2f", totals[l]);
+    printf("\n");
+}
@@ -0,0 +1,78 @@
+// compileOptimized compiles src and runs the optimization pipeline for flag on it
+Irgen *compileOptimized(char *src, const char *flag) {
+    Irgen *irgen = compileModule(src, false);
+    OptLevel level;
+    EXPECT_TRUE(ParseOptLevel((char *)flag, &level));
+    OptimizeModule(irgen->module, level);
+
+    char *error = (char *)NULL;
+    EXPECT_FALSE(LLVMVerifyModule(irgen->module, LLVMPrintMessageAction, &error));
+    LLVMDisposeMessage(error);
+    return irgen;
+}
+
+TEST(OptimizeTest, ParseOptLevel) {
+    OptLevel level;
+    ASSERT_TRUE(ParseOptLevel((char *)"-O0", &level));
+    ASSERT_EQ(0, level.speed);
+    ASSERT_TRUE(ParseOptLevel((char *)"-O3", &level));
+    ASSERT_EQ(3, level.speed);
+    ASSERT_EQ(0, level.size);
+    ASSERT_TRUE(ParseOptLevel((char *)"-Os", &level));
+    ASSERT_EQ(2, level.speed);
+    ASSERT_EQ(1, level.size);
+
+    ASSERT_FALSE(ParseOptLevel((char *)"-O4", &level));
+    ASSERT_FALSE(ParseOptLevel((char *)"-O", &level));
+    ASSERT_FALSE(ParseOptLevel((char *)"-O22", &level));
+    ASSERT_FALSE(ParseOptLevel((char *)"-o", &level));
+}
+
+TEST(OptimizeTest, InlineThreshold) {
+    ASSERT_EQ(0, InlineThreshold((OptLevel){1, 0}));
+    ASSERT_EQ(225, InlineThreshold((OptLevel){2, 0}));
+    ASSERT_EQ(250, InlineThreshold((OptLevel){3, 0}));
+    ASSERT_EQ(75, InlineThreshold((OptLevel){2, 1}));
+}
+
+TEST(OptimizeTest, NoneLeavesModule) {
+    char *src = loadTest("bubblesort.acl");
+    Irgen *irgen = compileOptimized(src, "-O0");
+    int unoptimized = countInstructions(irgen->module);
+    ASSERT_GT(countOpcode(irgen->module, "sort", LLVMAlloca), 0);
+
+    irgen = compileOptimized(src, "-O1");
+    ASSERT_LT(countInstructions(irgen->module), unoptimized);
+    ASSERT_EQ(123, runLLVMModule(irgen));
+}
+
+TEST(OptimizeTest, PromotesAllocas) {
+    Irgen *irgen = compileOptimized(loadTest("gcd.acl"), "-O1");
+    for (LLVMValueRef f = LLVMGetFirstFunction(irgen->module); f != NULL; f = LLVMGetNextFunction(f)) {
+        EXPECT_EQ(0, countOpcode(irgen->module, LLVMGetValueName(f), LLVMAlloca));
+    }
+    ASSERT_EQ(139, runLLVMModule(irgen));
+}
+
+TEST(OptimizeTest, FoldsConstantLoops) {
+    // the loops only depend on constants so the whole function folds to its result
+    Irgen *irgen = compileOptimized(loadTest("nestedFor.acl"), "-O2");
+    ASSERT_EQ(1, countInstructions(irgen->module));
+    ASSERT_EQ(123, runLLVMModule(irgen));
+}
+
+TEST(OptimizeTest, InlinesCalls) {
+    Irgen *irgen = compileOptimized(loadTest("forwardCall.acl"), "-O2");
+    ASSERT_EQ(0, countOpcode(irgen->module, "main", LLVMCall));
+    ASSERT_EQ(123, runLLVMModule(irgen));
+}
+
+TEST(OptimizeTest, OptimizedPrograms) {
+    const char *levels[] = {"-O1", "-O2", "-O3", "-Os"};
+    for (int l = 0; l < sizeof(levels) / sizeof(char *); l++) {
+        for (int i = 0; i < test_program_count; i++) {
+            Irgen *irgen = compileOptimized(loadTest(test_programs[i].name), levels[l]);
+            EXPECT_EQ(test_programs[i].result, runLLVMModule(irgen)) << test_programs[i].name << " " << levels[l];
+        }
+    }
+}
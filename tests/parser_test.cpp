@@ -122,6 +122,25 @@ TEST(ParserTest, ParseRightAssociativeBinaryOperators) {
     ASSERT_EQ((int)binaryExp, (int)exp->binary.right->type);
 }
 
+TEST(ParserTest, ParseLogicalPrecedence) {
+    Exp *exp = parse_expression_from_string((char *)"a || b && c == d");
+
+    ASSERT_EQ((int)LOR, (int)exp->binary.op.type);
+    ASSERT_EQ((int)LAND, (int)exp->binary.right->binary.op.type);
+    ASSERT_EQ((int)EQL, (int)exp->binary.right->binary.right->binary.op.type);
+}
+
+TEST(ParserTest, ParseBitwisePrecedence) {
+    Exp *exp = parse_expression_from_string((char *)"a | b & c << d ^ e");
+
+    // | and ^ bind like +, & and << like *
+    ASSERT_EQ((int)XOR, (int)exp->binary.op.type);
+    ASSERT_EQ((int)OR, (int)exp->binary.left->binary.op.type);
+    Exp *shift = exp->binary.left->binary.right;
+    ASSERT_EQ((int)SHL, (int)shift->binary.op.type);
+    ASSERT_EQ((int)AND, (int)shift->binary.left->binary.op.type);
+}
+
 TEST(ParserTest, ParseUnaryExpression) {
     Exp *exp = parse_expression_from_string((char *)"!a");
     
@@ -150,6 +169,18 @@ TEST(ParserTest, ParseAddAssigmentOperator) {
     ASSERT_STREQ((char *)"b", smt->assignment.right->binary.right->ident.name);
 }
 
+TEST(ParserTest, ParseBitwiseAssignmentOperators) {
+    const char *srcs[] = {"a /= b", "a &= b", "a |= b", "a ^= b", "a <<= b", "a >>= b", "a &^= b"};
+    TokenType ops[] = {QUO, AND, OR, XOR, SHL, SHR, AND_NOT};
+    for (int i = 0; i < sizeof(ops) / sizeof(TokenType); i++) {
+        Smt *smt = parse_statement_from_string((char *)srcs[i]);
+
+        ASSERT_EQ((int)assignmentSmt, (int)smt->type) << srcs[i];
+        ASSERT_EQ((int)ops[i], (int)smt->assignment.right->binary.op.type) << srcs[i];
+        ASSERT_STREQ((char *)"a", smt->assignment.right->binary.left->ident.name);
+    }
+}
+
 TEST(ParserTest, ParseReturnStatment) {
     Smt *smt = parse_statement_from_string((char *)"return a");
 
@@ -267,14 +298,18 @@ TEST(ParserTest, ParseFunctionDefinition) {
     ASSERT_EQ(2, (int)dcl->function.argCount);
     ASSERT_EQ((int)identExp, (int)dcl->function.returnType->type);
 
-    Object *obja = parser_find_scope(p, (char *)"a");
-    Object *objb = parser_find_scope(p, (char *)"b");
+    // the arguments are bound in the body but dont leak out of the function
+    Exp *sum = dcl->function.body->block.smts[0].ret.result;
+    Object *obja = sum->binary.left->ident.obj;
+    Object *objb = sum->binary.right->ident.obj;
     
     ASSERT_NE(obja, NULL);
     ASSERT_NE(objb, NULL);
     ASSERT_NE(obja->node, objb->node);
     ASSERT_EQ(dcl->function.args, obja->node);
     ASSERT_EQ(dcl->function.args + 1, objb->node);
+    ASSERT_EQ(NULL, parser_find_scope(p, (char *)"a"));
+    ASSERT_EQ(NULL, parser_find_scope(p, (char *)"test"));
 }
 
 TEST(ParserTest, ParseEmptyCallExpression) {
@@ -346,6 +381,65 @@ TEST(ParserTest, ParseArrayExpression) {
     ASSERT_EQ(3, exp->array.valueCount);
 }
 
+TEST(ParserTest, ParseSwitch) {
+    Smt *smt = parse_statement_from_string((char *)"switch a {\ncase 1, 2:\n    b = 1\n    fallthrough\ncase 3:\ndefault:\n    b = 2\n}");
+
+    ASSERT_EQ((int)switchSmt, (int)smt->type);
+    ASSERT_EQ((int)identExp, (int)smt->switchs.tag->type);
+    ASSERT_EQ(3, smt->switchs.clauseCount);
+
+    Smt *clauses = smt->switchs.clauses;
+    ASSERT_EQ(2, clauses[0].cases.expCount);
+    ASSERT_EQ(1, clauses[0].cases.body->block.count);
+    ASSERT_TRUE(clauses[0].cases.fallthrough);
+    ASSERT_EQ(1, clauses[1].cases.expCount);
+    ASSERT_EQ(0, clauses[1].cases.body->block.count);
+    ASSERT_FALSE(clauses[1].cases.fallthrough);
+    ASSERT_EQ(0, clauses[2].cases.expCount);
+    ASSERT_EQ(1, clauses[2].cases.body->block.count);
+}
+
+TEST(ParserTest, ParseMisplacedFallthrough) {
+    parser *p = new_parser(Lex((char *)"switch a {\ncase 1:\n    fallthrough\n    b = 1\n}"));
+    Smt *smt = parse_statement(p);
+
+    ASSERT_EQ((int)switchSmt, (int)smt->type);
+    ASSERT_EQ(1, queue_size(p->error_queue));
+    parser_error *error = (parser_error *)queue_pop_front(p->error_queue);
+    ASSERT_EQ(parser_error_misplaced_fallthrough, error->type);
+    ASSERT_EQ(FALLTHROUGH, error->start->type);
+}
+
+TEST(ParserTest, ParseMissingCaseExpression) {
+    // a missing case value is reported and parsing continues with the next clause
+    const char *srcs[] = {
+        "switch a {\ncase :\n    b = 1\ncase 2:\n    b = 2\n}",
+        "switch a {\ncase 2, :\n    b = 1\ndefault:\n    b = 2\n}",
+    };
+    for (int i = 0; i < sizeof(srcs) / sizeof(char *); i++) {
+        parser *p = new_parser(Lex((char *)srcs[i]));
+        Smt *smt = parse_statement(p);
+
+        ASSERT_EQ((int)switchSmt, (int)smt->type) << srcs[i];
+        EXPECT_GT(queue_size(p->error_queue), 0) << srcs[i];
+        ASSERT_EQ(2, smt->switchs.clauseCount) << srcs[i];
+        EXPECT_EQ(1, smt->switchs.clauses[1].cases.body->block.count) << srcs[i];
+    }
+}
+
+TEST(ParserTest, ParseBreakContinue) {
+    Smt *smt = parse_statement_from_string((char *)"for i := 0; i < 10; i++ {\n    if i == 2 {\n        continue\n    }\n    break\n}");
+
+    ASSERT_EQ((int)forSmt, (int)smt->type);
+    Smt *body = smt->fors.body;
+    ASSERT_EQ(2, body->block.count);
+    Smt *cont = &body->block.smts[0].ifs.body->block.smts[0];
+    ASSERT_EQ((int)branchSmt, (int)cont->type);
+    ASSERT_EQ(CONTINUE, cont->branch.token.type);
+    ASSERT_EQ((int)branchSmt, (int)body->block.smts[1].type);
+    ASSERT_EQ(BREAK, body->block.smts[1].branch.token.type);
+}
+
 TEST(ParserTest, ParseFunctionDclWithoutProc) {
     parser *p = new_parser(Lex((char *)"add :: -> int {}"));
     Dcl *dcl = parse_function_dcl(p);
@@ -486,3 +580,97 @@ TEST(ParserTest, ParseVaribleDclWithoutValue) {
     ASSERT_EQ(parser_error_expect_prefix, error->type);
     ASSERT_EQ(1, error->length);
 }
+
+TEST(ParserTest, LineIndex) {
+    char *src = (char *)"first\nsecond line\r\n\nlast";
+    line_index *index = new_line_index(src);
+    ASSERT_EQ(4, index->count);
+
+    int length;
+    char *line = line_index_line(index, 2, &length);
+    ASSERT_EQ(11, length);
+    ASSERT_EQ(0, strncmp("second line", line, length));
+    line_index_line(index, 3, &length);
+    ASSERT_EQ(0, length);
+    line = line_index_line(index, 4, &length);
+    ASSERT_EQ(0, strncmp("last", line, length));
+    ASSERT_EQ(NULL, line_index_line(index, 5, &length));
+    line_index_destroy(index);
+}
+
+TEST(ParserTest, RenderErrors) {
+    char *src = (char *)"proc main :: -> int {\n    a := 1 +\n    return 123\n}";
+    parser *p = new_parser(Lex(src));
+    parse_file(p);
+    ASSERT_GT(queue_size(p->error_queue), 0);
+
+    int count;
+    string out = parser_render_errors(p, src, string_new(""), &count);
+    ASSERT_GT(count, 0);
+    ASSERT_EQ(0, queue_size(p->error_queue));
+    ASSERT_NE((char *)NULL, strstr(out, "ERROR:"));
+    ASSERT_NE((char *)NULL, strstr(out, "'return' can not start an expression"));
+    ASSERT_NE((char *)NULL, strstr(out, "    3|\e[0m     return 123\n"));
+    ASSERT_NE((char *)NULL, strstr(out, "\e[91m\e[1m    ^^^^^^\e[0m"));
+    string_free(out);
+}
+
+TEST(ParserTest, RenderErrorsUnderline) {
+    char *src = (char *)"proc main :: int a -> int {\n    return a\n}";
+    parser *p = new_parser(Lex(src));
+    parser_error *err = new_error_token(p, SEMI);
+    err->start = p->tokens + 4; // 'a'
+
+    int count;
+    string out = parser_render_errors(p, src, string_new(""), &count);
+    ASSERT_EQ(1, count);
+    ASSERT_NE((char *)NULL, strstr(out, "expected ';' but got 'a'"));
+    ASSERT_NE((char *)NULL, strstr(out, "\e[91m\e[1m                 ^\e[0m"));
+    string_free(out);
+}
+
+TEST(ParserTest, RenderErrorsStopsAtMaxErrors) {
+    char *src = (char *)"proc main :: -> int {\n    return 123\n}";
+    parser *p = new_parser(Lex(src));
+    for (int i = 0; i < MAX_ERRORS + 5; i++) {
+        new_error(p, parser_error_expect_expression, 1);
+    }
+
+    int count;
+    string out = parser_render_errors(p, src, string_new(""), &count);
+    ASSERT_EQ(MAX_ERRORS + 5, count);
+    ASSERT_EQ(0, queue_size(p->error_queue));
+
+    int rendered = 0;
+    for (char *c = strstr(out, "ERROR:"); c != NULL; c = strstr(c + 1, "ERROR:")) rendered++;
+    ASSERT_EQ(MAX_ERRORS, rendered);
+    ASSERT_NE((char *)NULL, strstr(out, "5 more errors not shown"));
+    string_free(out);
+}
+
+TEST(ParserTest, RenderErrorsJson) {
+    char *src = (char *)"proc main :: int a -> int {\n    return a\n}";
+    parser *p = new_parser(Lex(src));
+    parser_error *err = new_error_token(p, SEMI);
+    err->start = p->tokens + 4; // 'a'
+    err = new_error(p, parser_error_expect_expression, 2);
+    err->start = p->tokens + 6; // 'int {' on line 1
+
+    int count;
+    string out = parser_render_errors_json(p, string_new(""), &count);
+    ASSERT_EQ(2, count);
+    ASSERT_EQ(0, queue_size(p->error_queue));
+    ASSERT_STREQ(
+        "{\"kind\":\"expect_token\",\"token\":\"[ident]\",\"expected\":\";\",\"line\":1,\"column\":18,\"length\":1}\n"
+        "{\"kind\":\"expect_expression\",\"token\":\"[ident]\",\"line\":1,\"column\":23,\"length\":5}\n",
+        out);
+    string_free(out);
+}
+
+TEST(ParserTest, JsonStringEscapes) {
+    string out = diagnostic_json_string(string_new(""), (char *)"a\"b\\c\n");
+    ASSERT_STREQ("\"a\\\"b\\\\c\\u000a\"", out);
+    out = diagnostic_json_phase(string_clear(out), (char *)"lex", 0.5);
+    ASSERT_STREQ("{\"kind\":\"phase\",\"phase\":\"lex\",\"seconds\":0.500000}\n", out);
+    string_free(out);
+}
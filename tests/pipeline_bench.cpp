@@ -0,0 +1,37 @@
+#define PIPELINE_BENCH_PROCS 20000
+
+// pipeline_bench compares compiling a large file one stage after another with
+// the pipelined lexer, parser and irgen threads (irgen includes the semantic pass)
+void pipeline_bench() {
+    string src = slab_bench_source(PIPELINE_BENCH_PROCS);
+
+    // sequential, timing each stage
+    double start = bench_now();
+    Token *tokens = LexSlab(src, new_slab());
+    double lexed = bench_now();
+    parser *p = new_parser(tokens);
+    ast_unit *ast = parse_file(p);
+    double parsed = bench_now();
+    Irgen *irgen = NewIrgen();
+    CheckUnit(NewChecker(irgen->types), ast);
+    for (int i = 0; i < ast->dclCount; i++) {
+        CompileFunction(irgen, ast->dcls[i]);
+    }
+    double compiled = bench_now();
+    LLVMDisposeModule(irgen->module);
+
+    double lex = lexed - start, parse = parsed - lexed, gen = compiled - parsed;
+    double slowest = lex > parse ? lex : parse;
+    slowest = slowest > gen ? slowest : gen;
+
+    // pipelined
+    irgen = NewIrgen();
+    start = bench_now();
+    pipeline pl;
+    pipeline_compile(&pl, src, irgen, NewChecker(irgen->types), false);
+    double pipelined = bench_now() - start;
+    LLVMDisposeModule(irgen->module);
+
+    printf("%12s %12s %12s %12s %12s %12s\n", "lex (s)", "parse (s)", "irgen (s)", "sum (s)", "slowest (s)", "pipeline (s)");
+    printf("%12.4f %12.4f %12.4f %12.4f %12.4f %12.4f\n", lex, parse, gen, lex + parse + gen, slowest, pipelined);
+}
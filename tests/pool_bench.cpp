@@ -0,0 +1,56 @@
+#define POOL_BENCH_NODES 1000000
+
+// allocates nodes literal expressions from a thread owned ast unit
+void pool_bench_local(int nodes) {
+    ast_unit *ast = new_ast_unit();
+    Token lit = {INT, 0, 0, (char *)"1"};
+    for (int i = 0; i < nodes; i++) {
+        new_literal_exp(ast, lit);
+    }
+    pool_destroy(ast->dcl_pool);
+    pool_destroy(ast->smt_pool);
+    pool_destroy(ast->exp_pool);
+}
+
+// allocates nodes expressions from a single pool shared between threads behind a
+// mutex, the pool is adopted for each allocation and handed off before unlocking
+void pool_bench_shared(pool *shared, std::mutex *lock, int nodes) {
+    for (int i = 0; i < nodes; i++) {
+        lock->lock();
+        pool_adopt(shared);
+        Exp *e = (Exp *)pool_get(shared);
+        pool_handoff(shared);
+        lock->unlock();
+        e->type = literalExp;
+    }
+}
+
+// pool_bench allocates POOL_BENCH_NODES ast nodes on every thread, for 1 to 64 threads
+void pool_bench() {
+    printf("%8s %14s %14s %14s %14s\n", "threads", "local (s)", "local Mnode/s", "shared (s)", "shared Mnode/s");
+    for (int threads = 1; threads <= 64; threads *= 2) {
+        std::vector<std::thread> workers;
+
+        double start = bench_now();
+        for (int t = 0; t < threads; t++) {
+            workers.push_back(std::thread(pool_bench_local, POOL_BENCH_NODES));
+        }
+        for (auto &worker : workers) worker.join();
+        double local = bench_now() - start;
+        workers.clear();
+
+        pool *shared = new_pool(sizeof(Exp), 128);
+        pool_handoff(shared);
+        std::mutex lock;
+        start = bench_now();
+        for (int t = 0; t < threads; t++) {
+            workers.push_back(std::thread(pool_bench_shared, shared, &lock, POOL_BENCH_NODES));
+        }
+        for (auto &worker : workers) worker.join();
+        double locked = bench_now() - start;
+        pool_destroy(shared);
+
+        double total = (double)threads * POOL_BENCH_NODES / 1e6;
+        printf("%8d %14.4f %14.2f %14.4f %14.2f\n", threads, local, total / local, locked, total / locked);
+    }
+}
@@ -113,4 +113,125 @@ TEST(PoolTest, ReusePool) {
     ASSERT_EQ(1, *e1);
     ASSERT_EQ(2, *e2);
     ASSERT_EQ(4, *e4);
-}
\ No newline at end of file
+}
+
+TEST(PoolTest, ExtendKeepsElements) {
+    pool *int_pool = new_pool(sizeof(int), 2);
+    int *elements[100];
+    for (int i = 0; i < 100; i++) {
+        elements[i] = (int *)pool_get(int_pool);
+        *elements[i] = i;
+    }
+
+    // elements allocated before the pool grew must not have moved
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ(i, *elements[i]);
+    }
+    ASSERT_EQ(100, pool_count(int_pool));
+    pool_destroy(int_pool);
+}
+
+TEST(PoolTest, HandoffAdopt) {
+    pool *int_pool = new_pool(sizeof(int), 5);
+    int *e1 = (int *)pool_get(int_pool);
+    *e1 = 1;
+    pool_handoff(int_pool);
+
+    std::thread worker([&] {
+        pool_adopt(int_pool);
+        int *e2 = (int *)pool_get(int_pool);
+        *e2 = 2;
+        pool_handoff(int_pool);
+    });
+    worker.join();
+
+    pool_adopt(int_pool);
+    ASSERT_EQ(2, pool_count(int_pool));
+    ASSERT_EQ(1, *e1);
+    pool_destroy(int_pool);
+}
+
+// builds a left leaning sum of count literals in the workers own ast unit
+Exp *build_sum_exp(ast_unit *ast, int count) {
+    Token lit = {INT, 0, 0, (char *)"1"};
+    Token add = {ADD, 0, 0, (char *)"+"};
+    Exp *sum = new_literal_exp(ast, lit);
+    for (int i = 1; i < count; i++) {
+        sum = new_binary_exp(ast, sum, add, new_literal_exp(ast, lit));
+    }
+    return sum;
+}
+
+TEST(PoolTest, ThreadLocalAstStress) {
+    const int thread_count = 8;
+    const int node_count = 50000;
+    std::vector<std::thread> workers;
+    ast_unit *units[thread_count];
+    Exp *roots[thread_count];
+
+    // every worker owns its ast unit, so no locking is needed while allocating
+    for (int t = 0; t < thread_count; t++) {
+        workers.push_back(std::thread([&, t] {
+            units[t] = new_ast_unit();
+            roots[t] = build_sum_exp(units[t], node_count);
+            ast_unit_handoff(units[t]);
+        }));
+    }
+    for (auto &worker : workers) worker.join();
+
+    // take ownership of the finished asts and walk them
+    for (int t = 0; t < thread_count; t++) {
+        ast_unit_adopt(units[t]);
+        int leaves = 1;
+        Exp *e = roots[t];
+        while (e->type == binaryExp) {
+            ASSERT_EQ(literalExp, e->binary.right->type);
+            leaves++;
+            e = e->binary.left;
+        }
+        ASSERT_EQ(node_count, leaves);
+        ASSERT_EQ(node_count * 2 - 1, pool_count(units[t]->exp_pool));
+
+        pool_destroy(units[t]->dcl_pool);
+        pool_destroy(units[t]->smt_pool);
+        pool_destroy(units[t]->exp_pool);
+    }
+}
+
+TEST(PoolTest, ReleaseThenDrain) {
+    pool *int_pool = new_pool(sizeof(int), 2);
+    int *e1 = (int *)pool_get(int_pool);
+    pool_release(int_pool, e1);
+
+    // the released element is now the end of the free list
+    pool_get(int_pool);
+    pool_get(int_pool);
+    ASSERT_TRUE(pool_full(int_pool));
+    pool_get(int_pool);
+    ASSERT_EQ(3, pool_count(int_pool));
+    pool_destroy(int_pool);
+}
+
+TEST(PoolTest, HugePageChunks) {
+    pool_page_mode modes[] = { pool_pages_transparent, pool_pages_explicit };
+    for (int m = 0; m < 2; m++) {
+        pool_set_page_mode(modes[m]);
+        pool *big_pool = new_pool(sizeof(long), POOL_HUGE_PAGE_SIZE / sizeof(long));
+        pool *small_pool = new_pool(sizeof(long), 16);
+        pool_set_page_mode(pool_pages_default);
+
+        // large chunks are mapped on a huge page boundary, small chunks use malloc
+        ASSERT_GT(big_pool->chunks->mapped_size, 0);
+        ASSERT_EQ(0, (size_t)big_pool->chunks % POOL_HUGE_PAGE_SIZE);
+        ASSERT_EQ(0, small_pool->chunks->mapped_size);
+
+        for (int i = 0; i < 1000; i++) {
+            long *e = (long *)pool_get(big_pool);
+            *e = i;
+        }
+        ASSERT_EQ(1000, pool_count(big_pool));
+
+        pool_destroy(big_pool);
+        pool_destroy(small_pool);
+    }
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+// test_program is an example program in tests/tests and the value its main returns
+struct test_program {
+    const char *name;
+    int result;
+};
+
+// test_programs are the example programs that compile without errors, shared by
+// the tests and benchmarks that run all of them
+const test_program test_programs[] = {
+    {"literal.acl", 123}, {"binaryInt.acl", 123}, {"binaryFloat.acl", 123},
+    {"longVar.acl", 123}, {"shortVar.acl", 123}, {"if.acl", 123}, {"ifElse.acl", 123},
+    {"ifElseIfElse.acl", 123}, {"ifElseIfElseIfElse.acl", 123}, {"for.acl", 123},
+    {"arrayInit.acl", 123}, {"add.acl", 123}, {"unary.acl", 123}, {"reassignArg.acl", 123},
+    {"arraySum.acl", 123}, {"nestedFor.acl", 123}, {"bubblesort.acl", 123},
+    {"forwardCall.acl", 123}, {"gcd.acl", 139}, {"fibbonanci.acl", 144},
+};
+const int test_program_count = sizeof(test_programs) / sizeof(test_program);
@@ -0,0 +1,61 @@
+#define QUEUE_BENCH_ITEMS 1000000
+#define QUEUE_BENCH_DEPTH 64
+
+// malloc_queue_item is a heap allocated node, how the queue used to allocate items
+struct malloc_queue_item {
+    malloc_queue_item *next;
+    int value;
+};
+
+// queue_bench_malloc pushes and pops items allocating every node with malloc
+void queue_bench_malloc(int items) {
+    malloc_queue_item *first = NULL, *last = NULL;
+    for (int i = 0; i < items; i++) {
+        malloc_queue_item *item = (malloc_queue_item *)malloc(sizeof(malloc_queue_item));
+        item->next = NULL;
+        item->value = i;
+        if (last == NULL) first = item; else last->next = item;
+        last = item;
+
+        if (i % QUEUE_BENCH_DEPTH == QUEUE_BENCH_DEPTH - 1) {
+            while (first != NULL) {
+                malloc_queue_item *next = first->next;
+                free(first);
+                first = next;
+            }
+            last = NULL;
+        }
+    }
+}
+
+// queue_bench_pooled pushes and pops items through a queue, reusing the freed items
+void queue_bench_pooled(int items) {
+    queue *q = new_queue(sizeof(int));
+    for (int i = 0; i < items; i++) {
+        *(int *)queue_push_back(q) = i;
+
+        if (i % QUEUE_BENCH_DEPTH == QUEUE_BENCH_DEPTH - 1) {
+            void *item;
+            while ((item = queue_pop_front(q)) != NULL) queue_free_item(item);
+        }
+    }
+    queue_destroy(q);
+    free(q);
+}
+
+// queue_bench compares the pooled queue with a malloc per item queue, draining
+// every QUEUE_BENCH_DEPTH items like the parser error queue
+void queue_bench() {
+    double start = bench_now();
+    queue_bench_malloc(QUEUE_BENCH_ITEMS);
+    double heap = bench_now() - start;
+
+    start = bench_now();
+    queue_bench_pooled(QUEUE_BENCH_ITEMS);
+    double pooled = bench_now() - start;
+
+    double total = QUEUE_BENCH_ITEMS / 1e6;
+    printf("%10s %14s %14s\n", "queue", "time (s)", "Mitem/s");
+    printf("%10s %14.4f %14.2f\n", "malloc", heap, total / heap);
+    printf("%10s %14.4f %14.2f\n", "pooled", pooled, total / pooled);
+}
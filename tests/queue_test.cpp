@@ -62,4 +62,48 @@ TEST(QueueTest, PushPopManyBack) {
         ASSERT_EQ(i, *out);
         queue_free_item(out);
     }
-}
\ No newline at end of file
+}
+
+TEST(QueueTest, FreedItemsReused) {
+    queue *q = new_queue(sizeof(int));
+    for (int round = 0; round < 10; round++) {
+        for (int i = 0; i < 100; i++) {
+            int *in = (int *)queue_push_back(q);
+            *in = i;
+        }
+        for (int i = 0; i < 100; i++) {
+            int *out = (int *)queue_pop_front(q);
+            ASSERT_EQ(i, *out);
+            queue_free_item(out);
+        }
+    }
+
+    // items are recycled so the pool only grows to the high water mark
+    ASSERT_EQ(0, queue_size(q));
+    ASSERT_EQ(128, pool_size(q->item_pool));
+    queue_destroy(q);
+}
+
+TEST(QueueTest, PopBothEnds) {
+    queue *q = new_queue(sizeof(int));
+    for (int i = 0; i < 4; i++) {
+        int *in = (int *)queue_push_back(q);
+        *in = i;
+    }
+
+    int *front = (int *)queue_pop_front(q);
+    queue_free_item(front);
+    int *back = (int *)queue_pop_back(q);
+    queue_free_item(back);
+
+    // reuse the freed items, the remaining links must not point at them
+    *(int *)queue_push_front(q) = 10;
+    *(int *)queue_push_back(q) = 13;
+
+    int expected[] = {10, 1, 2, 13};
+    for (int i = 0; i < 4; i++) {
+        ASSERT_EQ(expected[i], *(int *)queue_pop_front(q));
+    }
+    ASSERT_EQ(NULL, queue_pop_back(q));
+    queue_destroy(q);
+}
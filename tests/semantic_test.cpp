@@ -0,0 +1,281 @@
+// checkSource parses and type checks src, returning the checker with any errors
+Checker *checkSource(const char *src, ast_unit **ast) {
+    parser *p = new_parser(Lex((char *)src));
+    *ast = parse_file(p);
+    EXPECT_EQ(0, queue_size(p->error_queue));
+
+    Checker *c = NewChecker(NewTypeTable());
+    CheckUnit(c, *ast);
+    return c;
+}
+
+// expects src to have a single type error whose message contains expected
+void TEST_CHECK_ERROR(const char *src, const char *expected) {
+    ast_unit *ast;
+    Checker *c = checkSource(src, &ast);
+    ASSERT_EQ(1, queue_size(c->errors));
+    CheckError *error = (CheckError *)queue_pop_front(c->errors);
+    EXPECT_TRUE(strstr(error->message, expected) != NULL) << error->message;
+}
+
+TEST(SemanticTest, AnnotatesExpressions) {
+    ast_unit *ast;
+    Checker *c = checkSource(
+        "proc f :: i32 a, i32 b -> bool {\n"
+        "    return a + b * 2 < 10\n"
+        "}", &ast);
+    ASSERT_EQ(0, queue_size(c->errors));
+
+    Exp *cmp = ast->dcls[0]->function.body->block.smts[0].ret.result;
+    ASSERT_EQ(c->types->boolean, cmp->resolvedType);
+
+    // the literal takes the type of the other operand, it is never widened
+    Type *i32 = LookupNamedType(c->types, (char *)"i32");
+    Exp *sum = cmp->binary.left;
+    ASSERT_EQ(i32, sum->resolvedType);
+    ASSERT_EQ(i32, sum->binary.right->resolvedType);
+    ASSERT_EQ(c->types->untypedInt, sum->binary.right->binary.right->resolvedType);
+    ASSERT_EQ(c->types->untypedInt, cmp->binary.right->resolvedType);
+}
+
+TEST(SemanticTest, UnifiesToNarrowestType) {
+    TypeTable *t = NewTypeTable();
+    Type *i8 = LookupNamedType(t, (char *)"i8");
+    Type *i32 = LookupNamedType(t, (char *)"i32");
+    Type *f32 = LookupNamedType(t, (char *)"f32");
+    Type *f64 = LookupNamedType(t, (char *)"f64");
+
+    ASSERT_EQ(i32, UnifyTypes(t, i8, i32));
+    ASSERT_EQ(i8, UnifyTypes(t, i8, t->untypedInt));
+    ASSERT_EQ(f32, UnifyTypes(t, LookupNamedType(t, (char *)"i16"), f32));
+    ASSERT_EQ(f64, UnifyTypes(t, i32, f32));
+    ASSERT_EQ(f64, UnifyTypes(t, f32, LookupNamedType(t, (char *)"i64")));
+    ASSERT_EQ(f64, UnifyTypes(t, f32, f64));
+    ASSERT_EQ(f32, UnifyTypes(t, f32, t->untypedFloat));
+    ASSERT_EQ(LookupNamedType(t, (char *)"float"), UnifyTypes(t, LookupNamedType(t, (char *)"i16"), t->untypedFloat));
+    ASSERT_EQ(f64, UnifyTypes(t, t->untypedFloat, i32));
+    ASSERT_EQ(t->untypedFloat, UnifyTypes(t, t->untypedInt, t->untypedFloat));
+    ASSERT_EQ(i8, UnifyTypes(t, t->boolean, i8));
+    ASSERT_EQ(NULL, UnifyTypes(t, InternArrayType(t, i8, 2), i8));
+}
+
+TEST(SemanticTest, ArrayLiteralTakesDeclaredType) {
+    ast_unit *ast;
+    Checker *c = checkSource("proc main :: -> int {\n    var i8[3] a = [1, 2, 3]\n    return a[0]\n}", &ast);
+    ASSERT_EQ(0, queue_size(c->errors));
+
+    Exp *value = ast->dcls[0]->function.body->block.smts[0].declare->varible.value;
+    Type *i8 = LookupNamedType(c->types, (char *)"i8");
+    ASSERT_EQ(InternArrayType(c->types, i8, 3), value->resolvedType);
+}
+
+TEST(SemanticTest, ResolvesForwardReferences) {
+    ast_unit *ast;
+    Checker *c = checkSource(
+        "proc main :: -> int {\n    return f(1)\n}\n"
+        "proc f :: int n -> int {\n    return n + g\n}\n"
+        "g := 2", &ast);
+    ASSERT_EQ(0, queue_size(c->errors));
+
+    Exp *call = ast->dcls[0]->function.body->block.smts[0].ret.result;
+    ASSERT_EQ(LookupGlobal(c, (char *)"f"), call->call.function->ident.obj);
+    ASSERT_EQ(ast->dcls[1], call->call.function->ident.obj->node);
+
+    Exp *sum = ast->dcls[1]->function.body->block.smts[0].ret.result;
+    ASSERT_EQ(ast->dcls[1]->function.args, sum->binary.left->ident.obj->node);
+    ASSERT_EQ(ast->dcls[2], sum->binary.right->ident.obj->node);
+}
+
+TEST(SemanticTest, ResolveWaitsForDeclarations) {
+    parser *p = new_parser(Lex((char *)"proc main :: -> int {\n    return f()\n}\nproc f :: -> int {\n    return 1\n}"));
+    ast_unit *ast = parse_file(p);
+    Checker *c = NewChecker(NewTypeTable());
+
+    // f is unknown until its declaration is added
+    DeclareGlobal(c, ast->dcls[0]);
+    ASSERT_EQ(1, ResolveDcl(c, ast->dcls[0], false));
+    ASSERT_EQ(0, queue_size(c->errors));
+    DeclareGlobal(c, ast->dcls[1]);
+    ASSERT_EQ(0, ResolveDcl(c, ast->dcls[0], false));
+}
+
+TEST(SemanticTest, ErrorUndeclaredName) {
+    TEST_CHECK_ERROR("proc main :: -> int {\n    return missing(1)\n}", "undeclared name 'missing'");
+}
+
+TEST(SemanticTest, ErrorRedeclared) {
+    TEST_CHECK_ERROR("proc f :: -> int {\n    return 1\n}\nproc f :: -> int {\n    return 2\n}", "'f' redeclared");
+}
+
+TEST(SemanticTest, ErrorMismatchedTypes) {
+    TEST_CHECK_ERROR("proc main :: -> int {\n    a := [1, 2]\n    return a + 1\n}",
+        "mismatched types int[2] and untyped int for '+'");
+}
+
+TEST(SemanticTest, ErrorCondition) {
+    TEST_CHECK_ERROR("proc main :: -> int {\n    if 1 {\n        return 1\n    }\n    return 0\n}",
+        "condition must be a bool but got untyped int");
+}
+
+TEST(SemanticTest, ErrorConversion) {
+    TEST_CHECK_ERROR("proc main :: -> int {\n    var bool b = 1\n    return 0\n}", "cannot use untyped int as bool");
+}
+
+TEST(SemanticTest, ErrorUnknownType) {
+    TEST_CHECK_ERROR("proc main :: -> int {\n    var string s = 1\n    return 0\n}", "unknown type 'string'");
+}
+
+TEST(SemanticTest, ErrorIndexNonArray) {
+    TEST_CHECK_ERROR("proc main :: -> int {\n    a := 1\n    return a[0]\n}", "cannot index int");
+}
+
+TEST(SemanticTest, ErrorLogicalOperands) {
+    TEST_CHECK_ERROR("proc main :: -> int {\n    if 1 == 1 && 2 {\n        return 1\n    }\n    return 0\n}",
+        "operator '&&' is not defined on int");
+}
+
+TEST(SemanticTest, ErrorBitwiseFloat) {
+    TEST_CHECK_ERROR("proc main :: float x -> int {\n    return x & 1\n}", "operator '&' is not defined on float");
+    TEST_CHECK_ERROR("proc main :: int x -> int {\n    return x << 1.5\n}", "operator '<<' is not defined on untyped float");
+}
+
+TEST(SemanticTest, ErrorSwitch) {
+    TEST_CHECK_ERROR("proc main :: float x -> int {\n    switch x {\n    case 1:\n    }\n    return 0\n}",
+        "switch tag must be an int but got float");
+    TEST_CHECK_ERROR("proc main :: int x -> int {\n    switch x {\n    case x:\n    }\n    return 0\n}",
+        "case must be an int constant but got int");
+    TEST_CHECK_ERROR("proc main :: int x -> int {\n    switch x {\n    default:\n    default:\n    }\n    return 0\n}",
+        "multiple defaults in switch");
+    TEST_CHECK_ERROR("proc main :: int x -> int {\n    switch x {\n    case 1:\n        fallthrough\n    }\n    return 0\n}",
+        "cannot fallthrough the last case in switch");
+    TEST_CHECK_ERROR("proc main :: i8 x -> int {\n    switch x {\n    case 1, 300:\n    }\n    return 0\n}",
+        "case 300 overflows i8");
+    TEST_CHECK_ERROR("proc main :: i8 x -> int {\n    switch x {\n    case -129:\n    }\n    return 0\n}",
+        "case -129 overflows i8");
+    TEST_CHECK_ERROR("proc main :: int x -> int {\n    switch x {\n    case 4, 5:\n    case 2 + 3:\n    }\n    return 0\n}",
+        "duplicate case 5 in switch");
+    TEST_CHECK_ERROR("proc main :: i16 x -> int {\n    switch x {\n    case 0x10, 1 << 4:\n    }\n    return 0\n}",
+        "duplicate case 16 in switch");
+    TEST_CHECK_ERROR("proc main :: int x -> int {\n    switch x {\n    case 1 / 0:\n    }\n    return 0\n}",
+        "case value is not a constant integer");
+    TEST_CHECK_ERROR("proc main :: int x -> int {\n    switch x {\n    case 2 % 0:\n    }\n    return 0\n}",
+        "case value is not a constant integer");
+    TEST_CHECK_ERROR("proc main :: int x -> int {\n    switch x {\n    case 1 << 70:\n    }\n    return 0\n}",
+        "case value is not a constant integer");
+    TEST_CHECK_ERROR("proc main :: int x -> int {\n    switch x {\n    case 1 << 64:\n    }\n    return 0\n}",
+        "case value is not a constant integer");
+
+    // the bounds of the tag type and distinct values are fine
+    ast_unit *ast;
+    Checker *c = checkSource("proc main :: i8 x -> int {\n    switch x {\n    case -128, 127:\n    case 7 / 2:\n"
+        "    case 010:\n    }\n    return 0\n}", &ast);
+    ASSERT_EQ(0, queue_size(c->errors));
+}
+
+TEST(SemanticTest, ErrorBranchOutsideLoop) {
+    TEST_CHECK_ERROR("proc main :: -> int {\n    break\n    return 0\n}", "break is not in a loop or switch");
+    TEST_CHECK_ERROR("proc main :: int x -> int {\n    switch x {\n    case 1:\n        continue\n    }\n    return 0\n}",
+        "continue is not in a loop");
+
+    ast_unit *ast;
+    Checker *c = checkSource("proc main :: int x -> int {\n    for i := 0; i < x; i++ {\n"
+        "        switch i {\n        case 1:\n            break\n        case 2:\n            continue\n        }\n    }\n"
+        "    return 0\n}", &ast);
+    ASSERT_EQ(0, queue_size(c->errors));
+}
+
+TEST(SemanticTest, ShiftTakesLeftType) {
+    ast_unit *ast;
+    Checker *c = checkSource("proc f :: i8 x, int n -> int {\n    return x << n >> 1\n}", &ast);
+    ASSERT_EQ(0, queue_size(c->errors));
+
+    Exp *shift = ast->dcls[0]->function.body->block.smts[0].ret.result;
+    Type *i8 = LookupNamedType(c->types, (char *)"i8");
+    ASSERT_EQ(i8, shift->resolvedType);
+    ASSERT_EQ(i8, shift->binary.left->resolvedType);
+}
+
+TEST(SemanticTest, ErrorArgumentCount) {
+    TEST_CHECK_ERROR("proc f :: int n -> int {\n    return n\n}\nproc main :: -> int {\n    return f(1, 2)\n}",
+        "'f' expects 1 arguments but got 2");
+}
+
+TEST(SemanticTest, RenderErrors) {
+    const char *src = "proc main :: -> int {\n    a := [1, 2]\n    return a * 2\n}";
+    ast_unit *ast;
+    Checker *c = checkSource(src, &ast);
+
+    int count;
+    string out = RenderCheckErrors(c, (char *)src, string_new(""), &count);
+    ASSERT_EQ(1, count);
+    ASSERT_EQ(0, queue_size(c->errors));
+    ASSERT_TRUE(strstr(out, "mismatched types int[2] and untyped int for '*'") != NULL);
+    ASSERT_TRUE(strstr(out, "    3|\e[0m     return a * 2\n") != NULL);
+    ASSERT_TRUE(strstr(out, "\e[1m" "             ^\e[0m") != NULL);
+}
+
+TEST(SemanticTest, ErrorLocations) {
+    // errors about names are located at the identifier or the declarations name
+    const char *srcs[] = {
+        "proc main :: int a -> int {\n    return a + b\n}",
+        "proc main :: -> int {\n    var foo x = 1\n    return 0\n}",
+        "proc f :: -> int {\n    return 1\n}\nproc f :: -> int {\n    return 2\n}",
+        "proc main :: -> int {\n    break\n    return 0\n}",
+    };
+    int lines[] = {2, 2, 4, 2};
+    int columns[] = {16, 9, 6, 5};
+    int lengths[] = {1, 3, 1, 5};
+    for (int i = 0; i < sizeof(lines) / sizeof(int); i++) {
+        ast_unit *ast;
+        Checker *c = checkSource(srcs[i], &ast);
+        ASSERT_EQ(1, queue_size(c->errors)) << srcs[i];
+        CheckError *error = (CheckError *)queue_pop_front(c->errors);
+        EXPECT_EQ(lines[i], error->line) << error->message;
+        EXPECT_EQ(columns[i], error->column) << error->message;
+        EXPECT_EQ(lengths[i], error->length) << error->message;
+    }
+}
+
+TEST(SemanticTest, RenderErrorsJson) {
+    ast_unit *ast;
+    Checker *c = checkSource("proc main :: -> int {\n    return [1] < 2\n}", &ast);
+
+    int count;
+    string out = RenderCheckErrorsJson(c, string_new(""), &count);
+    ASSERT_EQ(1, count);
+    ASSERT_STREQ("{\"kind\":\"type\",\"message\":\"mismatched types int[1] and untyped int for '<'\",\"line\":2,\"column\":16,\"length\":1}\n", out);
+}
+
+TEST(SemanticTest, ExactWidthOperations) {
+    const char *src =
+        "proc f :: i32 a, i32 b -> i32 {\n"
+        "    return a + b * 2 - 1\n"
+        "}\n"
+        "proc g :: float x -> float {\n"
+        "    return x * 2.5 + 1\n"
+        "}\n"
+        "proc main :: -> int {\n"
+        "    var i8 c = 3\n"
+        "    return f(91, 12) + c + g(2.0)\n"
+        "}";
+    parser *p = new_parser(Lex((char *)src));
+    ast_unit *ast = parse_file(p);
+    Irgen *irgen = NewIrgen();
+    ASSERT_EQ(0, CheckUnit(NewChecker(irgen->types), ast));
+    for (int i = 0; i < ast->dclCount; i++) {
+        CompileFunction(irgen, ast->dcls[i]);
+    }
+
+    // i32 and float arithmetic stays at its own width
+    for (int op = LLVMTrunc; op <= LLVMFPExt; op++) {
+        EXPECT_EQ(0, countOpcode(irgen->module, "f", (LLVMOpcode)op));
+        EXPECT_EQ(0, countOpcode(irgen->module, "g", (LLVMOpcode)op));
+    }
+    EXPECT_EQ(2, countOpcode(irgen->module, "f", LLVMAdd) + countOpcode(irgen->module, "f", LLVMSub));
+    EXPECT_EQ(1, countOpcode(irgen->module, "g", LLVMFMul));
+
+    char *error = (char *)NULL;
+    EXPECT_FALSE(LLVMVerifyModule(irgen->module, LLVMPrintMessageAction, &error));
+    LLVMDisposeMessage(error);
+    EXPECT_EQ(123, runLLVMModule(irgen));
+}
@@ -0,0 +1,81 @@
+#define SLAB_BENCH_PROCS 20000
+#define SLAB_BENCH_ROUNDS 200000
+
+// slab_bench_source generates a large source file with many small payloads
+// (arguments, call arguments, array elements and identifiers)
+string slab_bench_source(int procs) {
+    string src = string_new("");
+    char line[256];
+    for (int i = 0; i < procs; i++) {
+        sprintf(line, "proc f%d :: int a, int b, int c -> int {\n", i);
+        src = string_append_cstring(src, line);
+        src = string_append_cstring(src, (char *)"    values := [a, b, c, 1, 2, 3]\n");
+        sprintf(line, "    total := f%d(a, b, c) + values[0]\n", i);
+        src = string_append_cstring(src, line);
+        src = string_append_cstring(src, (char *)"    return total\n}");
+        if (i < procs - 1) src = string_append_cstring(src, (char *)"\n\n");
+    }
+    return src;
+}
+
+// replays the parsers allocation pattern (growing arrays, objects and identifiers) with malloc
+void slab_bench_replay_malloc(int rounds) {
+    for (int r = 0; r < rounds; r++) {
+        Exp *values = (Exp *)malloc(0);
+        for (int i = 0; i < 6; i++) {
+            values = (Exp *)realloc(values, (i + 1) * sizeof(Exp));
+        }
+        Object *obj = (Object *)malloc(sizeof(Object));
+        char *ident = (char *)malloc(8);
+        free(values);
+        free(obj);
+        free(ident);
+    }
+}
+
+// replays the same allocation pattern with a slab
+void slab_bench_replay_slab(int rounds) {
+    slab *s = new_slab();
+    for (int r = 0; r < rounds; r++) {
+        Exp *values = NULL;
+        for (int i = 0; i < 6; i++) {
+            values = (Exp *)slab_realloc(s, values, i * sizeof(Exp), (i + 1) * sizeof(Exp));
+        }
+        Object *obj = (Object *)slab_alloc(s, sizeof(Object));
+        char *ident = (char *)slab_alloc(s, 8);
+        slab_free(s, values, 6 * sizeof(Exp));
+        slab_free(s, obj, sizeof(Object));
+        slab_free(s, ident, 8);
+    }
+    slab_destroy(s);
+}
+
+void slab_bench() {
+    // front end on a large input
+    string src = slab_bench_source(SLAB_BENCH_PROCS);
+    double start = bench_now();
+    slab *token_slab = new_slab();
+    parser *p = new_parser(LexSlab(src, token_slab));
+    parse_file(p);
+    double parse = bench_now() - start;
+
+    slab *ast_slab = p->ast->slab;
+    int requests = token_slab->alloc_count + ast_slab->alloc_count;
+    int system = slab_chunk_count(token_slab) + token_slab->large_count +
+        slab_chunk_count(ast_slab) + ast_slab->large_count;
+    printf("lex + parse %d procs (%d bytes): %.4f s\n", SLAB_BENCH_PROCS, string_length(src), parse);
+    printf("payload allocations: %d requested, %d reached malloc\n", requests, system);
+
+    // allocator comparison on the same allocation pattern
+    start = bench_now();
+    slab_bench_replay_malloc(SLAB_BENCH_ROUNDS);
+    double with_malloc = bench_now() - start;
+
+    start = bench_now();
+    slab_bench_replay_slab(SLAB_BENCH_ROUNDS);
+    double with_slab = bench_now() - start;
+
+    printf("%10s %12s\n", "allocator", "replay (s)");
+    printf("%10s %12.4f\n", "malloc", with_malloc);
+    printf("%10s %12.4f\n", "slab", with_slab);
+}
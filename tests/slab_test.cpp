@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+
+TEST(SlabTest, NewSlab) {
+    slab *s = new_slab();
+    ASSERT_EQ(0, s->alloc_count);
+    ASSERT_EQ(0, s->large_count);
+    ASSERT_EQ(SLAB_CLASS_COUNT, slab_chunk_count(s));
+    slab_destroy(s);
+}
+
+TEST(SlabTest, SizeClasses) {
+    slab *s = new_slab();
+    slab_alloc(s, 1);
+    slab_alloc(s, 16);
+    slab_alloc(s, 17);
+    slab_alloc(s, 256);
+    ASSERT_EQ(2, pool_count(s->classes[0]));
+    ASSERT_EQ(1, pool_count(s->classes[1]));
+    ASSERT_EQ(1, pool_count(s->classes[4]));
+    ASSERT_EQ(0, s->large_count);
+    slab_destroy(s);
+}
+
+TEST(SlabTest, LargeAlloc) {
+    slab *s = new_slab();
+    char *large = (char *)slab_alloc(s, 1000);
+    memset(large, 'a', 1000);
+    char *other = (char *)slab_alloc(s, 2000);
+    ASSERT_EQ(2, s->large_count);
+    slab_free(s, large, 1000);
+    ASSERT_EQ(other, (char *)(s->large + 1));
+    slab_destroy(s);
+}
+
+TEST(SlabTest, ReallocSameClass) {
+    slab *s = new_slab();
+    int *values = (int *)slab_alloc(s, 3 * sizeof(int));
+    int *grown = (int *)slab_realloc(s, values, 3 * sizeof(int), 4 * sizeof(int));
+    ASSERT_EQ(values, grown);
+    slab_destroy(s);
+}
+
+TEST(SlabTest, ReallocGrow) {
+    slab *s = new_slab();
+    int *values = NULL;
+    for (int i = 0; i < 1000; i++) {
+        values = (int *)slab_realloc(s, values, i * sizeof(int), (i + 1) * sizeof(int));
+        values[i] = i;
+    }
+
+    for (int i = 0; i < 1000; i++) {
+        ASSERT_EQ(i, values[i]);
+    }
+
+    // only the final large block is left, smaller blocks were returned to their class
+    ASSERT_TRUE(s->large != NULL);
+    ASSERT_TRUE(s->large->next == NULL);
+    for (int i = 0; i < SLAB_CLASS_COUNT; i++) {
+        ASSERT_EQ(0, pool_count(s->classes[i]));
+    }
+    slab_destroy(s);
+}
+
+TEST(SlabTest, StrnDup) {
+    slab *s = new_slab();
+    char *str = slab_strndup(s, (char *)"hello world", 5);
+    ASSERT_STREQ("hello", str);
+    slab_destroy(s);
+}
+
+TEST(SlabTest, LexIdentifiers) {
+    slab *s = new_slab();
+    Token *tokens = LexSlab((char *)"foo := bar123 + 42", s);
+    ASSERT_STREQ("foo", tokens[0].value);
+    ASSERT_STREQ("bar123", tokens[2].value);
+    ASSERT_STREQ("42", tokens[4].value);
+    ASSERT_EQ(3, s->alloc_count);
+    slab_destroy(s);
+}
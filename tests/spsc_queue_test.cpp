@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+
+TEST(SpscQueueTest, NewQueue) {
+    spsc_queue *q = new_spsc_queue(sizeof(int), 100);
+    ASSERT_EQ(128, spsc_queue_capacity(q));
+    ASSERT_EQ(0, (size_t)&q->tail % SPSC_CACHE_LINE);
+    ASSERT_EQ(0, (size_t)&q->head % SPSC_CACHE_LINE);
+    spsc_queue_destroy(q);
+}
+
+TEST(SpscQueueTest, FullAndEmpty) {
+    spsc_queue *q = new_spsc_queue(sizeof(int), 4);
+    int value = 0;
+    ASSERT_FALSE(spsc_queue_try_pop(q, &value));
+    for (int i = 0; i < 4; i++) {
+        ASSERT_TRUE(spsc_queue_try_push(q, &i));
+    }
+    ASSERT_FALSE(spsc_queue_try_push(q, &value));
+
+    for (int i = 0; i < 4; i++) {
+        ASSERT_TRUE(spsc_queue_try_pop(q, &value));
+        ASSERT_EQ(i, value);
+    }
+    ASSERT_FALSE(spsc_queue_try_pop(q, &value));
+    spsc_queue_destroy(q);
+}
+
+void spsc_test_produce(spsc_queue *q, int count) {
+    for (int i = 0; i < count; i++) spsc_queue_push(q, &i);
+    spsc_queue_close(q);
+}
+
+TEST(SpscQueueTest, StreamBetweenThreads) {
+    // small ring so the producer wraps many times
+    spsc_queue *q = new_spsc_queue(sizeof(int), 8);
+    std::thread producer(spsc_test_produce, q, 100000);
+
+    int expected = 0, value;
+    while (spsc_queue_pop(q, &value)) {
+        ASSERT_EQ(expected, value);
+        expected++;
+    }
+    producer.join();
+    ASSERT_EQ(100000, expected);
+    spsc_queue_destroy(q);
+}
+
+TEST(SpscQueueTest, LexQueueMatchesLex) {
+    char *src = (char *)"proc main :: -> int {\n    a := 100\n    return a + 23\n}";
+    Token *tokens = Lex(src);
+    spsc_queue *q = new_spsc_queue(sizeof(Token), 4);
+    std::thread lexer(LexQueue, src, (slab *)NULL, q);
+
+    Token token;
+    int i = 0;
+    while (spsc_queue_pop(q, &token)) {
+        ASSERT_EQ(tokens[i].type, token.type);
+        ASSERT_EQ(tokens[i].line, token.line);
+        ASSERT_EQ(tokens[i].column, token.column);
+        ASSERT_STREQ(tokens[i].value, token.value);
+        i++;
+    }
+    lexer.join();
+    ASSERT_EQ(END, tokens[i - 1].type);
+    spsc_queue_destroy(q);
+}
@@ -0,0 +1,68 @@
+#define SSA_BENCH_VARS 10
+#define SSA_BENCH_FUNCTIONS 500
+
+// ssa_bench_source generates functions with many scalar variables updated in a
+// loop under branches, the shape that produces the most loads, stores and phis
+string ssa_bench_source(int functions, int vars) {
+    string src = string_new("");
+    char line[256];
+    for (int f = 0; f < functions; f++) {
+        sprintf(line, "proc f%d :: int n -> int {\n", f);
+        src = string_append_cstring(src, line);
+        for (int v = 0; v < vars; v++) {
+            sprintf(line, "    s%d := %d\n", v, v);
+            src = string_append_cstring(src, line);
+        }
+        src = string_append_cstring(src, (char *)"    for i := 0; i < n; i++ {\n");
+        for (int v = 0; v < vars; v++) {
+            sprintf(line, "        if i > %d {\n            s%d = s%d + i\n        }\n", v, v, (v + 1) % vars);
+            src = string_append_cstring(src, line);
+        }
+        src = string_append_cstring(src, (char *)"    }\n    return s0");
+        for (int v = 1; v < vars; v++) {
+            sprintf(line, " + s%d", v);
+            src = string_append_cstring(src, line);
+        }
+        src = string_append_cstring(src, (char *)"\n}\n");
+    }
+    return src;
+}
+
+// ssa_bench_run compiles ast with or without direct ssa and optimizes it at -O2
+void ssa_bench_run(const char *name, ast_unit *ast, bool direct_ssa) {
+    Irgen *irgen = NewIrgen();
+    irgen->direct_ssa = direct_ssa;
+    CheckUnit(NewChecker(irgen->types), ast);
+
+    double start = bench_now();
+    for (int i = 0; i < ast->dclCount; i++) {
+        CompileFunction(irgen, ast->dcls[i]);
+    }
+    double compiled = bench_now();
+
+    int instructions = 0;
+    for (LLVMValueRef f = LLVMGetFirstFunction(irgen->module); f != NULL; f = LLVMGetNextFunction(f)) {
+        for (LLVMBasicBlockRef b = LLVMGetFirstBasicBlock(f); b != NULL; b = LLVMGetNextBasicBlock(b)) {
+            for (LLVMValueRef i = LLVMGetFirstInstruction(b); i != NULL; i = LLVMGetNextInstruction(i)) {
+                instructions++;
+            }
+        }
+    }
+
+    OptLevel level = {2, 0};
+    double optimizeStart = bench_now();
+    OptimizeModule(irgen->module, level);
+    double optimized = bench_now();
+    LLVMDisposeModule(irgen->module);
+
+    printf("%-12s %14d %12.4f %12.4f\n", name, instructions, compiled - start, optimized - optimizeStart);
+}
+
+// ssa_bench compares building allocas for mem2reg to promote with building ssa directly
+void ssa_bench() {
+    string src = ssa_bench_source(SSA_BENCH_FUNCTIONS, SSA_BENCH_VARS);
+
+    printf("%-12s %14s %12s %12s\n", "mode", "instructions", "irgen (s)", "-O2 (s)");
+    ssa_bench_run("allocas", parse_file(new_parser(Lex(src))), false);
+    ssa_bench_run("direct ssa", parse_file(new_parser(Lex(src))), true);
+}
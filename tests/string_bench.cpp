@@ -0,0 +1,104 @@
+#define STRING_BENCH_ROUNDS 1000000
+#define STRING_BENCH_IDENTS 1024
+#define STRING_BENCH_COMPARES 20000000
+
+// string_bench_heap builds the drivers file names and commands with heap strings
+void string_bench_heap(const char *in) {
+    string in_file = string_new(in);
+    string out_file = string_new("");
+    out_file = string_append_length(out_file, in_file, string_length(in_file) - 4);
+    out_file = string_append_cstring(out_file, (char *)".ll");
+    string llc_file = string_copy(out_file);
+    llc_file = string_slice(llc_file, 0, string_length(llc_file) - 3);
+    llc_file = string_append_cstring(llc_file, (char *)".s");
+    string command = string_append_format(string_new(""), "rm %s %s", out_file, llc_file);
+
+    string_free(in_file);
+    string_free(out_file);
+    string_free(llc_file);
+    string_free(command);
+}
+
+// string_bench_small builds the drivers file names and commands with small strings
+void string_bench_small(const char *in) {
+    small_string in_file = small_string_new(in);
+    small_string out_file = small_string_new("");
+    small_string_append_length(&out_file, small_string_cstring(&in_file), small_string_length(&in_file) - 4);
+    small_string_append_cstring(&out_file, ".ll");
+    small_string llc_file = small_string_copy(&out_file);
+    small_string_slice(&llc_file, 0, small_string_length(&llc_file) - 3);
+    small_string_append_cstring(&llc_file, ".s");
+    small_string command = small_string_new("");
+    small_string_append_format(&command, "rm %s %s", small_string_cstring(&out_file), small_string_cstring(&llc_file));
+
+    small_string_free(&in_file);
+    small_string_free(&out_file);
+    small_string_free(&llc_file);
+    small_string_free(&command);
+}
+
+// string_bench_equals_bytes is the byte by byte comparison string_equals used to do
+bool string_bench_equals_bytes(string s1, string s2) {
+    int length = string_length(s1);
+    if (length != string_length(s2)) return false;
+    for (int i = 0; i < length; i++) {
+        if (s1[i] != s2[i]) return false;
+    }
+    return true;
+}
+
+// string_bench_equals compares long identifiers which share a prefix and differ
+// near the end, the worst case for rejecting unequal strings
+void string_bench_equals() {
+    string idents[STRING_BENCH_IDENTS];
+    string copies[STRING_BENCH_IDENTS];
+    for (int i = 0; i < STRING_BENCH_IDENTS; i++) {
+        idents[i] = string_append_format(string_new(""), "compiler_generated_temporary_identifier_%06d", i);
+        copies[i] = string_copy(idents[i]);
+    }
+
+    printf("%10s %12s %14s\n", "equals", "time (s)", "Mcompare/s");
+    const char *names[] = {"bytes", "memcmp", "hashed"};
+    for (int r = 0; r < 3; r++) {
+        if (r == 2) {
+            for (int i = 0; i < STRING_BENCH_IDENTS; i++) {
+                string_hash(idents[i]);
+                string_hash(copies[i]);
+            }
+        }
+
+        int equal = 0;
+        double start = bench_now();
+        for (int i = 0; i < STRING_BENCH_COMPARES; i++) {
+            // mostly unequal pairs, one in STRING_BENCH_IDENTS is equal
+            string s1 = idents[i % STRING_BENCH_IDENTS];
+            string s2 = copies[(i * 7) % STRING_BENCH_IDENTS];
+            equal += r == 0 ? string_bench_equals_bytes(s1, s2) : string_equals(s1, s2);
+        }
+        double time = bench_now() - start;
+        printf("%10s %12.4f %14.2f (%d equal)\n", names[r], time, STRING_BENCH_COMPARES / 1e6 / time, equal);
+    }
+
+    for (int i = 0; i < STRING_BENCH_IDENTS; i++) {
+        string_free(idents[i]);
+        string_free(copies[i]);
+    }
+}
+
+// string_bench compares heap and small strings on the drivers string handling
+void string_bench() {
+    printf("%10s %12s %14s %14s\n", "strings", "time (s)", "Mround/s", "allocs/round");
+    void (*runs[])(const char *) = {string_bench_heap, string_bench_small};
+    const char *names[] = {"heap", "small"};
+    for (int r = 0; r < 2; r++) {
+        int allocations = string_allocation_count();
+        double start = bench_now();
+        for (int i = 0; i < STRING_BENCH_ROUNDS; i++) runs[r]("bubblesort.acl");
+        double time = bench_now() - start;
+        double per_round = (double)(string_allocation_count() - allocations) / STRING_BENCH_ROUNDS;
+        printf("%10s %12.4f %14.2f %14.2f\n", names[r], time, STRING_BENCH_ROUNDS / 1e6 / time, per_round);
+    }
+
+    printf("\n");
+    string_bench_equals();
+}
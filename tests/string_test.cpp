@@ -88,7 +88,7 @@ TEST(StringTest, StringAppendCString) {
 TEST(StringTest, StringMultipleAppendWithMalloc) {
     string s1 = string_new("hello");
     s1 = string_append_cstring(s1, (char *)" world");
-    malloc(10);
+    void *gap = malloc(10); // keeps realloc from growing s1 in place
     s1 = string_append_cstring(s1, (char *)" of");
     s1 = string_append_cstring(s1, (char *)" ours");
 
@@ -123,4 +123,174 @@ TEST(StringTest, StringNotEquals) {
     string s1 = string_new("foo bar");
     string s2 = string_new("foo bat");
     ASSERT_EQ(false, string_equals(s1, s2));
-}
\ No newline at end of file
+}
+TEST(StringTest, StringNewCapacity) {
+    string s = string_new_capacity(64);
+    ASSERT_EQ(0, string_length(s));
+    ASSERT_EQ(64, string_capacity(s));
+    ASSERT_EQ(0, strcmp(s, ""));
+    string_free(s);
+}
+
+TEST(StringTest, StringAppendGrowsGeometrically) {
+    string s = string_new("");
+    int reallocs = 0;
+    int capacity = string_capacity(s);
+    for (int i = 0; i < 10000; i++) {
+        s = string_append_cstring(s, (char *)"x");
+        if (string_capacity(s) != capacity) {
+            reallocs++;
+            capacity = string_capacity(s);
+        }
+    }
+    ASSERT_EQ(10000, string_length(s));
+    ASSERT_LE(reallocs, 12);
+    string_free(s);
+}
+
+TEST(StringTest, StringReserve) {
+    string s = string_new("test");
+    s = string_reserve(s, 100);
+    ASSERT_GE(string_capacity(s), 100);
+    ASSERT_EQ(0, strcmp(s, "test"));
+
+    // reserving less than the capacity does nothing
+    int capacity = string_capacity(s);
+    s = string_reserve(s, 50);
+    ASSERT_EQ(capacity, string_capacity(s));
+    string_free(s);
+}
+
+TEST(StringTest, StringAppendChar) {
+    string s = string_new("ab");
+    s = string_append_char(s, 'c');
+    ASSERT_EQ(3, string_length(s));
+    ASSERT_EQ(0, strcmp(s, "abc"));
+    string_free(s);
+}
+
+TEST(StringTest, StringAppendFormat) {
+    string s = string_new("x = ");
+    s = string_append_format(s, "%d, y = %s", 42, "foo");
+    ASSERT_EQ(0, strcmp(s, "x = 42, y = foo"));
+    ASSERT_EQ(15, string_length(s));
+
+    // output longer than the available space
+    string long_s = string_new("");
+    for (int i = 0; i < 100; i++) {
+        long_s = string_append_format(long_s, "%04d", i);
+    }
+    ASSERT_EQ(400, string_length(long_s));
+    ASSERT_EQ(0, strncmp(long_s, "000000010002", 12));
+    ASSERT_EQ(0, strcmp(long_s + 396, "0099"));
+    string_free(s);
+    string_free(long_s);
+}
+
+TEST(StringTest, SmallStringSize) {
+    ASSERT_EQ(24, sizeof(small_string));
+}
+
+TEST(StringTest, SmallStringInline) {
+    int allocations = string_allocation_count();
+    small_string s = small_string_new("test.acl");
+    ASSERT_TRUE(small_string_is_inline(&s));
+    ASSERT_EQ(8, small_string_length(&s));
+    ASSERT_EQ(0, strcmp("test.acl", small_string_cstring(&s)));
+
+    small_string_slice(&s, 0, 4);
+    small_string_append_cstring(&s, ".ll");
+    ASSERT_EQ(0, strcmp("test.ll", small_string_cstring(&s)));
+    ASSERT_EQ(allocations, string_allocation_count());
+    small_string_free(&s);
+}
+
+TEST(StringTest, SmallStringMaxInline) {
+    small_string s = small_string_new("0123456789012345678901");
+    ASSERT_TRUE(small_string_is_inline(&s));
+    ASSERT_EQ(SMALL_STRING_INLINE, small_string_length(&s));
+
+    // one more character moves it to the heap
+    small_string_append_cstring(&s, "2");
+    ASSERT_FALSE(small_string_is_inline(&s));
+    ASSERT_EQ(0, strcmp("01234567890123456789012", small_string_cstring(&s)));
+    small_string_free(&s);
+}
+
+TEST(StringTest, SmallStringHeap) {
+    small_string s = small_string_new("a string that is too long to be inline");
+    ASSERT_FALSE(small_string_is_inline(&s));
+    small_string_append_cstring(&s, " and more");
+    ASSERT_EQ(0, strcmp("a string that is too long to be inline and more", small_string_cstring(&s)));
+
+    small_string_slice(&s, 2, 8);
+    ASSERT_EQ(0, strcmp("string", small_string_cstring(&s)));
+
+    small_string copy = small_string_copy(&s);
+    ASSERT_TRUE(small_string_is_inline(&copy));
+    ASSERT_TRUE(small_string_equals(&s, &copy));
+    small_string_free(&s);
+    small_string_free(&copy);
+}
+
+TEST(StringTest, SmallStringAppendFormat) {
+    small_string s = small_string_new("llc ");
+    small_string_append_format(&s, "%s.ll", "out");
+    ASSERT_TRUE(small_string_is_inline(&s));
+    ASSERT_EQ(0, strcmp("llc out.ll", small_string_cstring(&s)));
+
+    // output which does not fit inline
+    small_string_append_format(&s, " %s %d", "a longer argument", 12345);
+    ASSERT_FALSE(small_string_is_inline(&s));
+    ASSERT_EQ(0, strcmp("llc out.ll a longer argument 12345", small_string_cstring(&s)));
+    ASSERT_EQ(34, small_string_length(&s));
+    small_string_free(&s);
+}
+
+TEST(StringTest, SmallStringToString) {
+    small_string s = small_string_new("short");
+    string str = small_string_to_string(&s);
+    ASSERT_EQ(5, string_length(str));
+    ASSERT_EQ(0, strcmp("short", str));
+    string_free(str);
+}
+
+TEST(StringTest, StringHashCached) {
+    string s = string_new("identifier");
+    ASSERT_EQ(0, STRING_HEADER(s)->hash);
+    uint64_t h = string_hash(s);
+    ASSERT_NE(0, h);
+    ASSERT_EQ(h, STRING_HEADER(s)->hash);
+    ASSERT_EQ(h, string_hash_bytes("identifier", 10));
+
+    // changing the characters resets the cached hash
+    s = string_append_cstring(s, (char *)"2");
+    ASSERT_EQ(0, STRING_HEADER(s)->hash);
+    ASSERT_NE(h, string_hash(s));
+    s = string_slice(s, 0, 10);
+    ASSERT_EQ(h, string_hash(s));
+    string_free(s);
+}
+
+TEST(StringTest, StringEqualsWithHashes) {
+    string s1 = string_new("a_long_identifier_name_0001");
+    string s2 = string_new("a_long_identifier_name_0001");
+    string s3 = string_new("a_long_identifier_name_0002");
+    string_hash(s1);
+    string_hash(s3);
+
+    // only one side hashed, or both hashed
+    ASSERT_TRUE(string_equals(s1, s2));
+    string_hash(s2);
+    ASSERT_TRUE(string_equals(s1, s2));
+    ASSERT_FALSE(string_equals(s1, s3));
+}
+
+TEST(StringTest, SmallStringHash) {
+    small_string s1 = small_string_new("short");
+    small_string s2 = small_string_new("a string long enough to be on the heap");
+    ASSERT_EQ(string_hash_bytes("short", 5), small_string_hash(&s1));
+    ASSERT_EQ(string_hash_bytes("a string long enough to be on the heap", 38), small_string_hash(&s2));
+    small_string_free(&s1);
+    small_string_free(&s2);
+}
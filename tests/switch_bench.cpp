@@ -0,0 +1,71 @@
+#define SWITCH_BENCH_OPCODES 256
+#define SWITCH_BENCH_STEPS 10000000
+
+// switch_bench_source generates an interpreter step dispatching on opcodes, with
+// a switch when chain is false and with an if else chain when it is true
+string switch_bench_source(int opcodes, bool chain) {
+    string src = string_new("proc step :: int op, int acc -> int {\n");
+    if (!chain) src = string_append_cstring(src, (char *)"    switch op {\n");
+    char line[128];
+    for (int op = 0; op < opcodes; op++) {
+        if (chain) {
+            sprintf(line, "    if op == %d {\n        return acc ^ %d\n    }\n", op, op * 7919 % 65536);
+        } else {
+            sprintf(line, "    case %d:\n        return acc ^ %d\n", op, op * 7919 % 65536);
+        }
+        src = string_append_cstring(src, line);
+    }
+    if (!chain) src = string_append_cstring(src, (char *)"    }\n");
+    src = string_append_cstring(src, (char *)"    return acc\n}\n");
+
+    sprintf(line, "    for i := 0; i < %d; i++ {\n", SWITCH_BENCH_STEPS);
+    src = string_append_cstring(src, (char *)"proc main :: -> int {\n    acc := 0\n");
+    src = string_append_cstring(src, line);
+    sprintf(line, "        acc = step(i & %d, acc)\n", opcodes - 1);
+    src = string_append_cstring(src, line);
+    return string_append_cstring(src, (char *)"    }\n    return acc\n}\n");
+}
+
+// switch_bench_run compiles the dispatch at level, jits it and times running main
+double switch_bench_run(bool chain, const char *flag) {
+    ast_unit *ast = parse_file(new_parser(Lex(switch_bench_source(SWITCH_BENCH_OPCODES, chain))));
+    Irgen *irgen = NewIrgen();
+    CheckUnit(NewChecker(irgen->types), ast);
+    for (int i = 0; i < ast->dclCount; i++) {
+        CompileFunction(irgen, ast->dcls[i]);
+    }
+
+    OptLevel level;
+    ParseOptLevel((char *)flag, &level);
+    OptimizeModule(irgen->module, level);
+
+    LLVMExecutionEngineRef engine;
+    struct LLVMMCJITCompilerOptions options;
+    LLVMInitializeMCJITCompilerOptions(&options, sizeof(options));
+    options.OptLevel = 2;
+    char *error = NULL;
+    LLVMCreateMCJITCompilerForModule(&engine, irgen->module, &options, sizeof(options), &error);
+    long (*main)() = (long (*)())LLVMGetFunctionAddress(engine, "main");
+
+    double start = bench_now();
+    volatile long result = main();
+    double elapsed = bench_now() - start;
+    (void)result;
+
+    LLVMDisposeExecutionEngine(engine);
+    return elapsed;
+}
+
+// switch_bench compares dispatching on every opcode through a switch with an if
+// else chain. Without optimization the chain compares against each opcode in turn,
+// simplifycfg turns it into a switch from -O1 so both run the same there
+void switch_bench() {
+    LLVMLinkInMCJIT();
+    LLVMInitializeNativeTarget();
+    LLVMInitializeNativeAsmPrinter();
+
+    const char *levels[] = {"-O0", "-O2"};
+    printf("%-12s %10s %10s\n", "dispatch (s)", levels[0], levels[1]);
+    printf("%-12s %10.4f %10.4f\n", "switch", switch_bench_run(false, levels[0]), switch_bench_run(false, levels[1]));
+    printf("%-12s %10.4f %10.4f\n", "if chain", switch_bench_run(true, levels[0]), switch_bench_run(true, levels[1]));
+}
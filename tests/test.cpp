@@ -2,6 +2,8 @@
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <thread>
+#include <vector>
 
 // src project
 extern "C" {
@@ -11,18 +13,32 @@ extern "C" {
     #include "../src/includes/parser.h"
     #include "../src/includes/irgen.h"
     #include "../src/includes/pool.h"
+    #include "../src/includes/slab.h"
     #include "../src/includes/queue.h"
+    #include "../src/includes/mpmc_queue.h"
+    #include "../src/includes/spsc_queue.h"
+    #include "../src/includes/semantic.h"
+    #include "../src/includes/optimize.h"
+    #include "../src/includes/pipeline.h"
     #include "../src/includes/string.h"
 }
 
+// example programs shared by tests and benchmarks
+#include "programs.h"
+
 // test files
 #include "pool_test.cpp"
+#include "slab_test.cpp"
 #include "queue_test.cpp"
+#include "mpmc_queue_test.cpp"
+#include "spsc_queue_test.cpp"
 #include "string_test.cpp"
 #include "lexer_test.cpp"
 #include "parser_test.cpp"
 #include "irgen_test.cpp"
 #include "integration_test.cpp"
+#include "semantic_test.cpp"
+#include "optimize_test.cpp"
 
 int main(int argc, char **argv) {
     testing::InitGoogleTest(&argc, argv);